@@ -9,4 +9,12 @@ C:\Programs\VulkanSDK_1_4_304\Bin\glslc.exe %%i -o assets\SPIRV\%%~nxi.spv
 for %%i in (%*) do echo Compiling %%i to assets\SPIRV\%%~nxi.spv & ^
 C:\Programs\VulkanSDK_1_4_304\Bin\glslc.exe shaders\%%i -o assets\SPIRV\%%~nxi.spv
 )
+@REM bundle everything for the shader registry once the pack tool is built.
+@REM the registry prefers the bundle over loose files, so without the pack tool
+@REM an old bundle is removed instead of shadowing the shaders compiled above
+IF EXIST build\packer.exe (
+build\packer -shaders
+) ELSE IF EXIST assets\shaders.bundle (
+echo Pack tool not built, removing stale assets\shaders.bundle & del assets\shaders.bundle
+)
 echo Finished
\ No newline at end of file
@@ -30,7 +30,7 @@ SDL_AppResult setupSDL(AppState& state) {
   SDL_SetWindowMinimumSize(state.window, 400, 300);
 
   // load icon
-  state.winIcon = IMG_Load("assets/icon.png");
+  state.winIcon = IMG_Load_IO(openAsset("assets/icon.png"), true);
   SDL_SetWindowIcon(state.window, state.winIcon);
 
   // can add other shader formats: SDL_GPU_SHADERFORMAT_DXIL | SDL_GPU_SHADERFORMAT_MSL
@@ -60,59 +60,60 @@ SDL_AppResult setupSDL(AppState& state) {
   }
   SDL_Log("Started text engine");
 
-  // maintain a lower poll rate
-  SDL_SetHint(SDL_HINT_MAIN_CALLBACK_RATE, "10000");
-
   return SDL_APP_CONTINUE;
 }
 
-// asset helper
-struct AssetMeta {
-  Uint16 id = 0;
-  Sint64 size = -1;
-};
-
-void unpackAssets(AppState& state) {
-  SDL_IOStream *assets = SDL_IOFromFile("build/assets.pak", "rb");
-  if (assets == NULL) {
-    SDL_Log("Could not read metadata for assets\n%s", SDL_GetError());
-    return;
-  }
-  SDL_Log("Opened assets file: %d", SDL_GetIOSize(assets));
-  AssetMeta assetMetas[2];
-  size_t metaSize = SDL_ReadIO(assets, &assetMetas, sizeof(assetMetas));
-  if (metaSize != sizeof(assetMetas)) {
-    SDL_Log("Could not read metadata for assets\n%s", SDL_GetError());
-    SDL_CloseIO(assets);
-    return;
-  } else {
-    SDL_Log("Opened assets.pak");
-    SDL_Log("Asset %d size - %d", assetMetas[0].id, assetMetas[0].size);
-    SDL_Log("Asset %d size - %d", assetMetas[1].id, assetMetas[1].size);
-  }
-  // signal error??
+// overlay strings only rebuild their geometry, the atlas stays the same
+static void applyTextScale(AppState &state) {
+  for (StringObject *str : state.overlayStrs) str->scale = state.textScale;
+  state.profileOverlay->origin = glm::vec3(0.0f, (float)TTF_GetFontHeight(state.font) * state.textScale, 0.0f);
 }
 
 // initialization of app
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
   *appstate = new AppState;
+  setProfileThreadName("main");
   AppState& state = *static_cast<AppState*>(*appstate);
   state.sys.kbStates = SDL_GetKeyboardState(NULL);
 
+  // packed assets are optional, anything missing is read from assets/
+  mountAssetPak("build/assets.pak");
+  getShaderRegistry()->loadBundle("assets/shaders.bundle");
+  // --headless [frames] checks every scene's command stream without a gpu and exits
+  for (int i=1; i < argc; i++) {
+    if (SDL_strcmp(argv[i], "--headless") != 0) continue;
+    state.headless = true;
+    Uint32 frames = i + 1 < argc ? (Uint32)SDL_atoi(argv[i + 1]) : 120;
+    return runHeadlessBench(frames) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+  }
   SDL_AppResult setupRes = setupSDL(state);
   if (setupRes != SDL_APP_CONTINUE) return setupRes;
-
-  SDL_GPUTextureFormat scFormat = SDL_GetGPUSwapchainTextureFormat(state.gpu, state.window);
-  state.overlayp = new TextPipeline(scFormat, state.gpu);
-  state.font = TTF_OpenFont("assets/Helvetica.ttf", 18);
+  state.pacer = new FramePacer(state.gpu, state.window);
+
+  SDL_GPUTextureFormat scFormat = getGPUBackend()->getSwapchainTextureFormat(state.gpu, state.window);
+  // one sdf atlas at 24pt covers every overlay size
+  state.overlayp = new TextPipeline(scFormat, state.gpu, TM_SDF);
+  state.overlayp->sdfStyle.outlineColor = rgba(0, 0, 0, 200);
+  state.overlayp->sdfStyle.outlineWidth = 0.1f;
+  state.font = TTF_OpenFontIO(openAsset("assets/Helvetica.ttf"), true, 24);
+  TTF_SetFontSDF(state.font, true);
   state.fpsOverlay = new StringObject(state.textEngine, state.font, "FPS: 9999.00");
+  state.profileOverlay = new StringObject(state.textEngine, state.font, "Profiler");
+  state.profileOverlay->visible = false;
+  state.overlayStrs = { state.fpsOverlay, state.profileOverlay };
+  applyTextScale(state);
 
   // pre-initialize scenes
   // --> could also initialize scenes dynamically
   SdfScene *sdfscn = new SdfScene(state.gpu, scFormat);
   ObjScene *objscn = new ObjScene(state.gpu, scFormat);
+  StressScene *stressscn = new StressScene(state.gpu, scFormat);
   state.scenes.push_back(sdfscn);
   state.scenes.push_back(objscn);
+  state.scenes.push_back(stressscn);
+  getShaderRegistry()->logStats();
+  getMeshFactory()->logStats();
+  getGPUResources(state.gpu)->logStats();
 
   return SDL_APP_CONTINUE;
 }
@@ -132,12 +133,29 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
       if (event->key.scancode == SDL_SCANCODE_F1) {
         state.fpsOverlay->visible = true;
       }
+      if (event->key.scancode == SDL_SCANCODE_F3 && !event->key.repeat) {
+        state.pacer->cycleMode();
+      }
+      if (event->key.scancode == SDL_SCANCODE_F4 && !event->key.repeat) {
+        state.profileOverlay->visible = !state.profileOverlay->visible;
+      }
+      if (event->key.scancode == SDL_SCANCODE_F5 && !event->key.repeat) {
+        getProfiler()->dumpChromeTrace("profile.json");
+      }
+      if (event->key.scancode == SDL_SCANCODE_PAGEUP || event->key.scancode == SDL_SCANCODE_PAGEDOWN) {
+        float step = event->key.scancode == SDL_SCANCODE_PAGEUP ? 1.25f : 0.8f;
+        state.textScale = SDL_clamp(state.textScale * step, 0.5f, 4.0f);
+        applyTextScale(state);
+      }
       if (event->key.scancode == SDL_SCANCODE_1) {
         state.currentScene = 0;
       }
       if (event->key.scancode == SDL_SCANCODE_2) {
         state.currentScene = 1;
       }
+      if (event->key.scancode == SDL_SCANCODE_3) {
+        state.currentScene = 2;
+      }
       break;
     case SDL_EVENT_KEY_UP:
       if (event->key.scancode == SDL_SCANCODE_F1) {
@@ -159,66 +177,107 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
 SDL_AppResult SDL_AppIterate(void *appstate) {
   AppState& state = *static_cast<AppState*>(appstate);
 
-  // calculate FPS
-  Uint64 newTime = SDL_GetTicksNS();
-  Uint64 delta = newTime - state.sys.lifetime;
-  if (delta < 100001) return SDL_APP_CONTINUE;
-  state.sys.lifetime = newTime;
+  // sleeps until the frame is due in the capped modes, then calculate FPS
+  Uint64 delta = state.pacer->beginFrame();
+  state.sys.lifetime = SDL_GetTicksNS();
   state.sys.deltaTime = (float)delta / (float)SDL_NS_PER_SECOND;
   if (state.timeSinceLastFps > (SDL_NS_PER_SECOND / 5)) {
     state.timeSinceLastFps = 0;
     float fps = 0.0f;
     if (delta != 0) fps = SDL_NS_PER_SECOND / delta;
-    char str[100];
-    SDL_snprintf(str, sizeof(str), "FPS: %.2f (Scene %d)", fps, state.currentScene + 1);
+    char str[512];
+    StagingStats const &upload = getStagingRing(state.gpu)->frameStats();
+    FrameArenaStats const &arena = getFrameArena()->frameStats();
+    std::string sceneInfo;
+    if (state.scenes.size() > 0 && state.currentScene > -1) {
+      sceneInfo = state.scenes.at(state.currentScene)->debugInfo();
+    }
+    std::string jobInfo = getJobSystem()->utilizationInfo();
+    SDL_snprintf(
+      str, sizeof(str), "FPS: %.2f (Scene %d) | %s | Upload: %.1f KB, %d stalls | Arena: %.1f KB, %d heap allocs%s%s%s%s",
+      fps, state.currentScene + 1, state.pacer->info().c_str(),
+      (float)upload.bytesStaged / 1024.0f, upload.stalls,
+      (float)arena.bytesUsed / 1024.0f, arena.heapAllocations,
+      jobInfo.empty() ? "" : " | ", jobInfo.c_str(),
+      sceneInfo.empty() ? "" : " | ", sceneInfo.c_str()
+    );
     state.fpsOverlay->updateText(str);
+    if (state.profileOverlay->visible) state.profileOverlay->updateText(getProfiler()->breakdown());
   } else {
     state.timeSinceLastFps += delta;
   }
 
   // update objects
   if (state.scenes.size() > 0 && state.currentScene > -1) {
+    PROFILE_ZONE("scene update");
     state.sys.mFlags = SDL_GetMouseState(NULL, NULL);
     SDL_AppResult res = state.scenes.at(state.currentScene)->update(state.sys);
     if (res != SDL_APP_CONTINUE) return res;
   }
+  // frame sync point, jobs queued during the update finish before anything is drawn
+  JobSystem *jobs = getJobSystem();
+  jobs->sync();
+
+  // build overlay geometry
+  state.overlayp->prepare(state.overlayStrs);
 
   // acquire command buffer
-	SDL_GPUCommandBuffer *cmdBuf = SDL_AcquireGPUCommandBuffer(state.gpu);
-  SDL_InsertGPUDebugLabel(cmdBuf, "Screen Render");
+	SDL_GPUCommandBuffer *cmdBuf = getGPUBackend()->acquireCommandBuffer(state.gpu);
+  getGPUBackend()->insertDebugLabel(cmdBuf, "Screen Render");
 	// acquire swapchain
 	SDL_GPUTexture* swapchain = NULL;
-	SDL_AcquireGPUSwapchainTexture(cmdBuf, state.window, &swapchain, NULL, NULL);
-	if (swapchain == NULL) {
-		// if swapchain == NULL, its not ready yet - skip render
-		SDL_CancelGPUCommandBuffer(cmdBuf);
+	if (!state.pacer->acquireSwapchain(cmdBuf, &swapchain)) {
+		// if swapchain == NULL, its not ready yet (minimized) - skip render
+		getGPUBackend()->cancelCommandBuffer(cmdBuf);
+		state.pacer->skipFrame();
+		// staged copies wait for the next frame that gets a swapchain. the
+		// gpu resource registry only counts submitted frames, so a release
+		// can't outrun a frame that is still in flight
+		jobs->endFrame();
+		getFrameArena()->endFrame();
+		getProfiler()->endFrame();
 		return SDL_APP_CONTINUE;
 	}
 
+  // copy everything staged this frame in a single pass
+  StagingRing *staging = getStagingRing(state.gpu);
+  staging->flush(cmdBuf);
+
   // clear swapchain
-  SDL_GPURenderPass *pass = SDL_BeginGPURenderPass(cmdBuf, new SDL_GPUColorTargetInfo {
+  SDL_GPURenderPass *pass = getGPUBackend()->beginRenderPass(cmdBuf, getFrameArena()->make(SDL_GPUColorTargetInfo {
 		.texture = swapchain,
 		.clear_color = SDL_FColor{ 0.02f, 0.02f, 0.08f, 1.0f },
 		.load_op = SDL_GPU_LOADOP_CLEAR,
 		.store_op = SDL_GPU_STOREOP_STORE,
-	}, 1, NULL);
-  SDL_EndGPURenderPass(pass);
+	}), 1, NULL);
+  getGPUBackend()->endRenderPass(pass);
 
   // render scene
   if (state.scenes.size() > 0 && state.currentScene > -1) {
+    PROFILE_ZONE("scene render");
     SDL_AppResult res = state.scenes.at(state.currentScene)->render(cmdBuf, swapchain);
     if (res != SDL_APP_CONTINUE) {
-      SDL_CancelGPUCommandBuffer(cmdBuf);
+      staging->cancel();
+      getGPUBackend()->cancelCommandBuffer(cmdBuf);
       return res;
     }
   }
 
 	// overlay render
-  std::vector<StringObject> overlayStrs = { *state.fpsOverlay };
-  state.overlayp->render(cmdBuf, NULL, swapchain, state.sys.winSize, overlayStrs);
+  state.overlayp->render(cmdBuf, NULL, swapchain, state.sys.winSize, state.overlayStrs);
 
   // end render chain
-	if (!SDL_SubmitGPUCommandBuffer(cmdBuf)) {
+  SDL_GPUFence *fence = NULL;
+  {
+    PROFILE_ZONE("submit");
+    fence = getGPUBackend()->submitCommandBufferAndAcquireFence(cmdBuf);
+  }
+  staging->endFrame(fence);
+  getGPUResources(state.gpu)->endFrame();
+  jobs->endFrame();
+  getFrameArena()->endFrame();
+  getProfiler()->endFrame();
+	if (fence == NULL) {
 		SDL_Log("Failed to submit GPU command %s", SDL_GetError());
 		return SDL_APP_FAILURE;
 	};
@@ -230,6 +289,16 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
 void SDL_AppQuit(void *appstate, SDL_AppResult result) {
   AppState& state = *static_cast<AppState*>(appstate);
   SDL_Log("Closing SDL3");
+  destroyJobSystem();
+  if (state.headless) {
+    destroyMeshFactory();
+    destroyShaderRegistry();
+    destroyFrameArena();
+    unmountAssetPak();
+    destroyProfiler();
+    SDL_Quit();
+    return;
+  }
   for (Scene* &scene : state.scenes) {
     scene->destroy();
     delete scene;
@@ -238,6 +307,8 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
 
   TTF_DestroyText(state.fpsOverlay->ttfText);
   delete state.fpsOverlay;
+  TTF_DestroyText(state.profileOverlay->ttfText);
+  delete state.profileOverlay;
   state.overlayp->destroy();
   delete state.overlayp;
 
@@ -245,10 +316,18 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
   TTF_DestroyGPUTextEngine(state.textEngine);
   TTF_Quit();
 
+  destroyGPUResources(state.gpu);
+  destroyStagingRing(state.gpu);
   SDL_ReleaseWindowFromGPUDevice(state.gpu, state.window);
   SDL_DestroyGPUDevice(state.gpu);
+  delete state.pacer;
   SDL_DestroySurface(state.winIcon);
   SDL_DestroyWindow(state.window);
+  destroyMeshFactory();
+  destroyShaderRegistry();
+  destroyFrameArena();
+  unmountAssetPak();
+  destroyProfiler();
 
   SDL_Quit();
 }
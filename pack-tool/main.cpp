@@ -1,45 +1,427 @@
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <SDL3/SDL.h>
-#include <SDL3_ttf/SDL_ttf.h>
+#include "../src/pakFormat.hpp"
+#include "../src/blockCodec.hpp"
 
-struct MetaData {
-  Uint16 id = 0;
-  Sint64 size = -1;
+using namespace App;
+
+struct InputFile {
+  std::string name;
+  Uint8 *data = NULL;
+  // compressed payload, empty if the file is stored as is
+  std::vector<Uint8> packed;
+  PakEntry entry;
 };
 
-void closeFiles(std::vector<SDL_IOStream*> input) {
-  for (SDL_IOStream *fn : input) {
-    SDL_CloseIO(fn);
+void closeFiles(std::vector<InputFile> &inputs) {
+  for (InputFile &in : inputs) {
+    SDL_free(in.data);
+    in.data = NULL;
   }
 }
 
-int main(int argc, char* argv[]) {
-  SDL_Log("Opening files");
+Uint64 alignUp(Uint64 value, Uint64 alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
 
+// pad the output with zeros up to offset
+bool padTo(SDL_IOStream *output, Uint64 offset) {
+  static const char zeros[PAK_ALIGNMENT] = {};
+  Sint64 pos = SDL_TellIO(output);
+  while (pos >= 0 && (Uint64)pos < offset) {
+    size_t n = (size_t)SDL_min(offset - pos, (Uint64)sizeof(zeros));
+    if (SDL_WriteIO(output, zeros, n) != n) return false;
+    pos += n;
+  }
+  return pos >= 0;
+}
+
+// copy data 10kb at a time to bypass SDL_WriteIO size limitations
+Uint64 writeAll(SDL_IOStream *output, Uint8 const *data, Uint64 size) {
+  Uint64 written = 0;
+  while (written < size) {
+    size_t n = (size_t)SDL_min(size - written, (Uint64)10240);
+    size_t bytesWritten = SDL_WriteIO(output, data + written, n);
+    written += bytesWritten;
+    if (bytesWritten != n) break;
+  }
+  return written;
+}
+
+// shaders go in through the bundle when one was built
+std::vector<std::string> defaultFiles() {
   std::vector<std::string> files = { "assets/icon.png", "assets/Helvetica.ttf" };
-  MetaData meta[files.size()];
-  std::vector<SDL_IOStream*> inputs;
+  if (SDL_GetPathInfo("assets/shaders.bundle", NULL)) {
+    files.push_back("assets/shaders.bundle");
+    return files;
+  }
+  int count = 0;
+  char **shaders = SDL_GlobDirectory("assets/SPIRV", "*.spv", 0, &count);
+  for (int i=0; i < count; i++) files.push_back(std::string("assets/SPIRV/") + shaders[i]);
+  SDL_free(shaders);
+  return files;
+}
+
+double secondsSince(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+struct BenchTotals {
+  Uint64 raw = 0;
+  Uint64 stored = 0;
+  double compressSec = 0.0;
+  double decodeSec = 0.0;
+  double parallelSec = 0.0;
+};
+
+// decode threads started once, so timings don't include thread creation.
+// each run hands one reader's chunks out through a shared counter and the
+// calling thread decodes alongside the workers
+class DecodePool {
+public:
+  DecodePool(int workerThreads) {
+    lock = SDL_CreateMutex();
+    start = SDL_CreateCondition();
+    finished = SDL_CreateCondition();
+    SDL_SetAtomicInt(&next, 0);
+    SDL_SetAtomicInt(&failed, 0);
+    for (int i=0; i < workerThreads; i++) {
+      SDL_Thread *thread = SDL_CreateThread(workerMain, "pak decode", this);
+      // fewer workers is fine, the caller decodes whatever is left
+      if (thread == NULL) break;
+      threads.push_back(thread);
+    }
+  }
+  ~DecodePool() {
+    SDL_LockMutex(lock);
+    quit = true;
+    SDL_BroadcastCondition(start);
+    SDL_UnlockMutex(lock);
+    for (SDL_Thread *thread : threads) SDL_WaitThread(thread, NULL);
+    SDL_DestroyCondition(finished);
+    SDL_DestroyCondition(start);
+    SDL_DestroyMutex(lock);
+  }
+  int threadCount() const { return (int)threads.size() + 1; }
+  bool decodeAll(ChunkReader const &chunks, Uint8 *out) {
+    SDL_LockMutex(lock);
+    reader = &chunks;
+    dst = out;
+    SDL_SetAtomicInt(&next, 0);
+    SDL_SetAtomicInt(&failed, 0);
+    busy = (int)threads.size();
+    generation++;
+    SDL_BroadcastCondition(start);
+    SDL_UnlockMutex(lock);
+    decodeChunks();
+    SDL_LockMutex(lock);
+    while (busy > 0) SDL_WaitCondition(finished, lock);
+    SDL_UnlockMutex(lock);
+    return SDL_GetAtomicInt(&failed) == 0;
+  }
+private:
+  static int workerMain(void *data) {
+    DecodePool *pool = static_cast<DecodePool*>(data);
+    Uint32 seen = 0;
+    SDL_LockMutex(pool->lock);
+    for (;;) {
+      while (!pool->quit && pool->generation == seen) SDL_WaitCondition(pool->start, pool->lock);
+      if (pool->quit) break;
+      seen = pool->generation;
+      SDL_UnlockMutex(pool->lock);
+      pool->decodeChunks();
+      SDL_LockMutex(pool->lock);
+      if (--pool->busy == 0) SDL_SignalCondition(pool->finished);
+    }
+    SDL_UnlockMutex(pool->lock);
+    return 0;
+  }
+  void decodeChunks() {
+    for (;;) {
+      int chunk = SDL_AddAtomicInt(&next, 1);
+      if (chunk >= (int)reader->count()) break;
+      if (!reader->decode(chunk, dst)) SDL_SetAtomicInt(&failed, 1);
+    }
+  }
+  std::vector<SDL_Thread*> threads;
+  SDL_Mutex *lock = NULL;
+  SDL_Condition *start = NULL;
+  SDL_Condition *finished = NULL;
+  // guarded by lock
+  ChunkReader const *reader = NULL;
+  Uint8 *dst = NULL;
+  Uint32 generation = 0;
+  int busy = 0;
+  bool quit = false;
+  SDL_AtomicInt next;
+  SDL_AtomicInt failed;
+};
+
+// decode repeatedly until enough time passed for a stable number
+double timeDecode(DecodePool &pool, ChunkReader const &reader, Uint8 *dst) {
+  int runs = 0;
+  Uint64 start = SDL_GetPerformanceCounter();
+  while (runs < 3 || secondsSince(start) < 0.2) {
+    pool.decodeAll(reader, dst);
+    runs++;
+  }
+  return secondsSince(start) / runs;
+}
+
+// compression ratio plus decompression throughput on one core and spread over
+// every core, the same way AssetPak decodes compressed entries
+int benchmark(std::vector<std::string> const &files) {
+  const char *levelNames[2] = { "fast", "high" };
+  BenchTotals totals[2];
+  DecodePool serial(0);
+  DecodePool parallel(SDL_max(1, SDL_GetNumLogicalCPUCores()) - 1);
+  int threads = parallel.threadCount();
+  SDL_Log("Benchmarking %d files, %d KB chunks, %d decode threads", (int)files.size(), PAK_CHUNK_SIZE / 1024, threads);
+  for (std::string const &fn : files) {
+    size_t size = 0;
+    Uint8 *data = static_cast<Uint8*>(SDL_LoadFile(fn.c_str(), &size));
+    if (data == NULL) {
+      SDL_Log("Could not open file: %s", SDL_GetError());
+      return 1;
+    }
+    std::vector<Uint8> packed;
+    std::vector<Uint8> out(size);
+    for (int level = LZ_Fast; level <= LZ_High; level++) {
+      Uint64 start = SDL_GetPerformanceCounter();
+      compressChunks(data, size, (LZLevel)level, PAK_CHUNK_SIZE, packed);
+      double compressSec = secondsSince(start);
+      ChunkReader reader;
+      reader.init(packed.data(), packed.size(), size);
+      double decodeSec = timeDecode(serial, reader, out.data());
+      double parallelSec = timeDecode(parallel, reader, out.data());
+      if (SDL_memcmp(out.data(), data, size) != 0) {
+        SDL_Log("Round trip mismatch in %s (%s)", fn.c_str(), levelNames[level]);
+        SDL_free(data);
+        return 2;
+      }
+      BenchTotals &t = totals[level];
+      t.raw += size;
+      t.stored += packed.size();
+      t.compressSec += compressSec;
+      t.decodeSec += decodeSec;
+      t.parallelSec += parallelSec;
+      SDL_Log(
+        "  %-40s %-4s %8d -> %8d (%.2fx) compress %7.1f MB/s, decompress %7.1f MB/s",
+        fn.c_str(), levelNames[level], (int)size, (int)packed.size(), (double)size / SDL_max((size_t)1, packed.size()),
+        size / 1e6 / compressSec, size / 1e6 / decodeSec
+      );
+    }
+    SDL_free(data);
+  }
+  for (int level = LZ_Fast; level <= LZ_High; level++) {
+    BenchTotals &t = totals[level];
+    SDL_Log(
+      "Total %s: %d -> %d bytes (%.2fx), compress %.1f MB/s, decompress %.1f MB/s on 1 core, "
+      "%.1f MB/s on %d cores (%.1f MB/s per core)",
+      levelNames[level], (int)t.raw, (int)t.stored, (double)t.raw / SDL_max((Uint64)1, t.stored),
+      t.raw / 1e6 / t.compressSec, t.raw / 1e6 / t.decodeSec,
+      t.raw / 1e6 / t.parallelSec, threads, t.raw / 1e6 / t.parallelSec / threads
+    );
+  }
+  return 0;
+}
+
+struct ShaderDir {
+  const char *dir;
+  const char *ext;
+  SDL_GPUShaderFormat format;
+};
+
+struct BundledShader {
+  std::string name;
+  ShaderBundleEntry entry;
+  Uint8 *data = NULL;
+  size_t size = 0;
+};
+
+// every compiled shader under assets/ in one blob for ShaderRegistry.
+// shaders are named after their source file, identical bytecode is stored once
+int bundleShaders(std::string const &outPath) {
+  const ShaderDir dirs[] = {
+    { "assets/SPIRV", ".spv", SDL_GPU_SHADERFORMAT_SPIRV },
+    { "assets/MSL", ".msl", SDL_GPU_SHADERFORMAT_MSL },
+    { "assets/DXIL", ".dxil", SDL_GPU_SHADERFORMAT_DXIL },
+  };
+  std::vector<BundledShader> shaders;
+  auto freeShaders = [&]() {
+    for (BundledShader &sh : shaders) SDL_free(sh.data);
+  };
+  for (ShaderDir const &d : dirs) {
+    int count = 0;
+    std::string pattern = std::string("*") + d.ext;
+    char **found = SDL_GlobDirectory(d.dir, pattern.c_str(), 0, &count);
+    for (int i=0; i < count; i++) {
+      BundledShader sh;
+      sh.name = std::string(found[i], SDL_strlen(found[i]) - SDL_strlen(d.ext));
+      if (sh.name.find(".vert") != std::string::npos) {
+        sh.entry.stage = SDL_GPU_SHADERSTAGE_VERTEX;
+      } else if (sh.name.find(".frag") != std::string::npos) {
+        sh.entry.stage = SDL_GPU_SHADERSTAGE_FRAGMENT;
+      } else {
+        SDL_Log("Skipping %s/%s, unknown shader stage", d.dir, found[i]);
+        continue;
+      }
+      sh.entry.format = d.format;
+      std::string path = std::string(d.dir) + "/" + found[i];
+      sh.data = static_cast<Uint8*>(SDL_LoadFile(path.c_str(), &sh.size));
+      if (sh.data == NULL) {
+        SDL_Log("Could not open file: %s", SDL_GetError());
+        SDL_free(found);
+        freeShaders();
+        return 1;
+      }
+      shaders.push_back(sh);
+    }
+    SDL_free(found);
+  }
+
+  std::sort(shaders.begin(), shaders.end(), [](BundledShader const &a, BundledShader const &b) {
+    if (a.name != b.name) return a.name < b.name;
+    return a.entry.format < b.entry.format;
+  });
+  std::string names;
+  for (BundledShader &sh : shaders) {
+    sh.entry.nameOffset = names.size();
+    names.append(sh.name);
+    names.push_back('\0');
+  }
+
+  // layout: header, entries, names, then 4 byte aligned code (SPIR-V is read as words)
+  ShaderBundleHeader header;
+  header.entryCount = shaders.size();
+  header.namesSize = names.size();
+  Uint64 offset = alignUp(sizeof(ShaderBundleHeader) + shaders.size() * sizeof(ShaderBundleEntry) + names.size(), 4);
+  std::vector<BundledShader*> unique;
+  for (BundledShader &sh : shaders) {
+    sh.entry.codeSize = sh.size;
+    for (BundledShader *u : unique) {
+      if (u->size == sh.size && SDL_memcmp(u->data, sh.data, sh.size) == 0) sh.entry.codeOffset = u->entry.codeOffset;
+    }
+    if (sh.entry.codeOffset != 0) continue;
+    sh.entry.codeOffset = offset;
+    offset = alignUp(offset + sh.size, 4);
+    unique.push_back(&sh);
+  }
+
+  SDL_IOStream *output = SDL_IOFromFile(outPath.c_str(), "wb");
+  if (output == NULL) {
+    SDL_Log("Failed to create output file: %s", SDL_GetError());
+    freeShaders();
+    return 3;
+  }
+  bool ok = SDL_WriteIO(output, &header, sizeof(header)) == sizeof(header);
+  for (BundledShader &sh : shaders) {
+    ok = ok && SDL_WriteIO(output, &sh.entry, sizeof(ShaderBundleEntry)) == sizeof(ShaderBundleEntry);
+  }
+  ok = ok && SDL_WriteIO(output, names.data(), names.size()) == names.size();
+  for (BundledShader *u : unique) {
+    ok = ok && padTo(output, u->entry.codeOffset) && writeAll(output, u->data, u->size) == u->size;
+  }
+  ok = ok && padTo(output, offset);
+  SDL_CloseIO(output);
+  freeShaders();
+  if (!ok) {
+    SDL_Log("Failed to write to output file: %s", SDL_GetError());
+    return 4;
+  }
+  SDL_Log("Bundled %d shaders (%d unique) into %s, %d bytes", (int)shaders.size(), (int)unique.size(), outPath.c_str(), (int)offset);
+  return 0;
+}
+
+// usage: packer [-fast|-high] [output.pak] [files...]
+//        packer -bench [files...]
+//        packer -shaders [output.bundle]
+// without files the default assets and compiled shaders are packed into build/assets.pak.
+// -shaders bundles the compiled shaders into assets/shaders.bundle, which is
+// then packed in place of the individual files.
+// -fast/-high compress entries in independent chunks, entries that
+// don't shrink by at least 1/8 are stored as is
+int main(int argc, char* argv[]) {
+  int arg = 1;
+  bool compress = false;
+  LZLevel level = LZ_Fast;
+  if (arg < argc && SDL_strcmp(argv[arg], "-shaders") == 0) {
+    return bundleShaders(arg + 1 < argc ? argv[arg + 1] : "assets/shaders.bundle");
+  }
+  if (arg < argc && SDL_strcmp(argv[arg], "-bench") == 0) {
+    std::vector<std::string> files(argv + arg + 1, argv + argc);
+    return benchmark(files.empty() ? defaultFiles() : files);
+  }
+  if (arg < argc && (SDL_strcmp(argv[arg], "-fast") == 0 || SDL_strcmp(argv[arg], "-high") == 0)) {
+    compress = true;
+    level = SDL_strcmp(argv[arg], "-high") == 0 ? LZ_High : LZ_Fast;
+    arg++;
+  }
+  std::string outPath = arg < argc ? argv[arg] : "build/assets.pak";
+  std::vector<std::string> files(argv + SDL_min(arg + 1, argc), argv + argc);
+  if (files.empty()) files = defaultFiles();
 
   // open up files
-  Uint16 id = 0;
+  SDL_Log("Opening files");
+  std::vector<InputFile> inputs;
   for (std::string fn : files) {
-    SDL_IOStream *file = SDL_IOFromFile(fn.c_str(), "rb");
-    if (file == NULL) {
+    // names are looked up with forward slashes at runtime
+    std::replace(fn.begin(), fn.end(), '\\', '/');
+    bool duplicate = false;
+    for (InputFile &in : inputs) duplicate = duplicate || in.name == fn;
+    if (duplicate) continue;
+
+    InputFile in;
+    in.name = fn;
+    size_t fileSize = 0;
+    in.data = static_cast<Uint8*>(SDL_LoadFile(fn.c_str(), &fileSize));
+    if (in.data == NULL) {
       SDL_Log("Could not open file: %s", SDL_GetError());
       closeFiles(inputs);
       return 1;
     }
-    Sint64 fileSize = SDL_GetIOSize(file);
-    id++;
-    MetaData metadata = { id, fileSize };
-    meta[id - 1] = metadata;
-    inputs.push_back(file);
+    in.entry.hash = pakHash(fn.c_str());
+    in.entry.size = fileSize;
+    if (compress) {
+      bool fits = compressChunks(in.data, fileSize, level, PAK_CHUNK_SIZE, in.packed);
+      if (fits && in.packed.size() <= fileSize - fileSize / 8) {
+        in.entry.flags |= PAK_FLAG_LZ;
+      } else {
+        in.packed.clear();
+      }
+    }
+    inputs.push_back(std::move(in));
+  }
+
+  // table of contents is sorted by hash for binary search
+  std::sort(inputs.begin(), inputs.end(), [](InputFile const &a, InputFile const &b) {
+    if (a.entry.hash != b.entry.hash) return a.entry.hash < b.entry.hash;
+    return a.name < b.name;
+  });
+  std::string names;
+  for (InputFile &in : inputs) {
+    in.entry.nameOffset = names.size();
+    names.append(in.name);
+    names.push_back('\0');
+  }
+
+  // layout: header, toc, names, then page aligned payloads
+  PakHeader header;
+  header.entryCount = inputs.size();
+  header.namesOffset = sizeof(PakHeader) + inputs.size() * sizeof(PakEntry);
+  header.namesSize = names.size();
+  Uint64 offset = alignUp(header.namesOffset + header.namesSize, PAK_ALIGNMENT);
+  for (InputFile &in : inputs) {
+    in.entry.offset = offset;
+    Uint64 stored = (in.entry.flags & PAK_FLAG_LZ) ? in.packed.size() : in.entry.size;
+    offset = alignUp(offset + stored, PAK_ALIGNMENT);
   }
 
   // generate output
   SDL_Log("Writing to .pak file");
-  SDL_IOStream *output = SDL_IOFromFile("build/assets.pak", "wb");
+  SDL_IOStream *output = SDL_IOFromFile(outPath.c_str(), "wb");
   if (output == NULL) {
     SDL_Log("Failed to create output file: %s", SDL_GetError());
     closeFiles(inputs);
@@ -47,42 +429,48 @@ int main(int argc, char* argv[]) {
   }
 
   // write metadata into output
-  size_t writeSize = SDL_WriteIO(output, &meta, sizeof(meta));
-  if (writeSize != sizeof(meta)) {
-    SDL_Log("Failed to write to output file: %d/%d", writeSize, sizeof(meta));
+  bool ok = SDL_WriteIO(output, &header, sizeof(header)) == sizeof(header);
+  for (InputFile &in : inputs) {
+    ok = ok && SDL_WriteIO(output, &in.entry, sizeof(PakEntry)) == sizeof(PakEntry);
+  }
+  ok = ok && SDL_WriteIO(output, names.data(), names.size()) == names.size();
+  if (!ok) {
+    SDL_Log("Failed to write to output file: %s", SDL_GetError());
     closeFiles(inputs);
     SDL_CloseIO(output);
     return 4;
   }
-  SDL_Log("Packed metadata: %d/%d", writeSize, sizeof(meta));
+  SDL_Log("Packed metadata: %d entries, %d bytes of names", header.entryCount, (int)header.namesSize);
 
   // write actual data
-  char buffer[10240];
-  size_t bytesRead = 0;
-  size_t bytesWritten = 0;
-  int counter = 0;
-  for (int i=0; i<inputs.size(); i++) {
-    // copy data 10kb at a time to bypass SDL_WriteIO size limitations
-    bytesRead = SDL_ReadIO(inputs[i], buffer, sizeof(buffer));
-    while (bytesRead > 0) {
-      bytesWritten = SDL_WriteIO(output, buffer, bytesRead);
-      if (bytesRead != bytesWritten) {
-        SDL_Log("Failed to write to output file: %d/%d\n -> %s", bytesWritten, meta[i].size, SDL_GetError());
-        closeFiles(inputs);
-        SDL_CloseIO(output);
-      }
-      bytesRead = SDL_ReadIO(inputs[i], buffer, sizeof(buffer));
-      counter++;
+  for (InputFile &in : inputs) {
+    if (!padTo(output, in.entry.offset)) {
+      SDL_Log("Failed to pad output file: %s", SDL_GetError());
+      closeFiles(inputs);
+      SDL_CloseIO(output);
+      return 5;
+    }
+    bool packed = (in.entry.flags & PAK_FLAG_LZ) != 0;
+    Uint8 const *payload = packed ? in.packed.data() : in.data;
+    Uint64 stored = packed ? in.packed.size() : in.entry.size;
+    Uint64 written = writeAll(output, payload, stored);
+    if (written != stored) {
+      SDL_Log("Failed to write to output file: %d/%d\n -> %s", (int)written, (int)stored, SDL_GetError());
+      closeFiles(inputs);
+      SDL_CloseIO(output);
+      return 4;
+    }
+    if (packed) {
+      SDL_Log("Packed file (%s): %d bytes compressed to %d at %d", in.name.c_str(), (int)in.entry.size, (int)written, (int)in.entry.offset);
+    } else {
+      SDL_Log("Packed file (%s): %d bytes at %d", in.name.c_str(), (int)written, (int)in.entry.offset);
     }
-    SDL_Log("Packed file (%s): %d/%d - %d iterations", files[i].c_str(), bytesWritten, meta[i].size, counter);
-    bytesRead = 0;
-    bytesWritten = 0;
-    counter = 0;
   }
+  padTo(output, offset);
 
   // clean up
   SDL_Log("Finished packing");
   closeFiles(inputs);
   SDL_CloseIO(output);
   return 0;
-}
\ No newline at end of file
+}
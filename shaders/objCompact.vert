@@ -0,0 +1,36 @@
+#version 450
+
+// VL_Compact vertices: snorm16 position, unorm16 uv, octahedral normal.
+// the model matrix already includes the mesh's quantization scale/offset
+layout(location = 0) in vec4 inPos;
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in vec2 inNormal;
+
+layout(set = 1, binding = 0) uniform UniformBufferObject {
+  mat4x4 model;
+  mat4x4 view;
+  mat4x4 proj;
+};
+
+layout(location = 0) out vec2 outUv;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec3 outPos;
+
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main() {
+  vec4 pos = vec4(inPos.xyz, 1.0);
+  mat4x4 mvp = proj * view * model;
+  vec4 outP = model * pos;
+  vec4 outN = model * vec4(octDecode(inNormal), 0.0);
+  outUv = inUv;
+  outNormal = outN.xyz;
+  outPos = outP.xyz;
+  gl_Position = mvp * pos;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 450
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in vec3 inNormal;
+
+struct InstanceData {
+  mat4x4 model;
+  vec4 albedo;
+};
+
+layout(set = 0, binding = 0) readonly buffer InstanceStorage {
+  InstanceData instances[];
+};
+
+layout(set = 1, binding = 0) uniform UniformBufferObject {
+  mat4x4 view;
+  mat4x4 proj;
+  uint baseInstance;
+};
+
+layout(location = 0) out vec2 outUv;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec3 outPos;
+layout(location = 3) flat out vec4 outAlbedo;
+
+void main() {
+  // gl_InstanceIndex does not include first_instance on every backend,
+  // so the batch offset is passed in explicitly
+  InstanceData inst = instances[baseInstance + gl_InstanceIndex];
+  mat4x4 mvp = proj * view * inst.model;
+  vec4 outP = inst.model * vec4(inPos, 1.0);
+  vec4 outN = inst.model * vec4(inNormal, 0.0);
+  outUv = inUv;
+  outNormal = outN.xyz;
+  outPos = outP.xyz;
+  outAlbedo = inst.albedo;
+  gl_Position = mvp * vec4(inPos, 1.0);
+}
@@ -16,12 +16,23 @@ layout(set=2, binding=0) buffer readonly SDFStorage {
   SDFObject sdfObjects[];
 };
 
+// per tile (offset, count) into tileIndices, see SDFTileBinner
+layout(set=2, binding=1) buffer readonly TileStorage {
+  uvec2 tiles[];
+};
+
+layout(set=2, binding=2) buffer readonly TileIndexStorage {
+  uint tileIndices[];
+};
+
 layout(set=3, binding=0) uniform SysData {
   vec2 screenSize;
   vec2 lightPos;
   vec4 lightColor;
   float lightMaxDist;
   uint objCount;
+  uint tileSize;
+  uint tileCols;
 };
 
 layout(location=0) out vec4 outColor;
@@ -92,11 +103,11 @@ float opSmoothMerge(float sd1, float sd2, float r) {
 }
 
 struct SdfOut { float dist; vec4 color; };
-SdfOut calculateSdf(vec2 p, float maxDist) {
+SdfOut calculateSdf(vec2 p, float maxDist, uvec2 tile) {
   float dist = maxDist;
   vec4 clr = vec4(0.0);
-  for (uint i = 0; i < objCount; i++) {
-    SDFObject obj = sdfObjects[i];
+  for (uint i = 0; i < tile.y; i++) {
+    SDFObject obj = sdfObjects[tileIndices[tile.x + i]];
     float d = maxDist;
     if (obj.objType == 1) { // circle
       d = sdCircle(p, obj.center, obj.radius);
@@ -130,15 +141,15 @@ SdfOut calculateSdf(vec2 p, float maxDist) {
 }
 
 struct RayMarchOut { float dist; float minSdf; };
-RayMarchOut rayMarch(vec2 origin, vec2 target, float maxDist) {
+RayMarchOut rayMarch(vec2 origin, vec2 target, float maxDist, uvec2 tile) {
   vec2 ndir = normalize(target - origin);
   vec2 p = origin;
-  SdfOut sdf = calculateSdf(p, maxDist);
+  SdfOut sdf = calculateSdf(p, maxDist, tile);
   float rayDist = sdf.dist;
   float minSdf = sdf.dist;
   for (int i=0; i<99999; i++) {
     p = p + (ndir * sdf.dist);
-    sdf = calculateSdf(p, maxDist);
+    sdf = calculateSdf(p, maxDist, tile);
     rayDist += sdf.dist;
     if (rayDist > maxDist || sdf.dist < 0.01) {
       break;
@@ -159,16 +170,19 @@ RayMarchOut rayMarch(vec2 origin, vec2 target, float maxDist) {
 // ----------------------------------------- //
 void main() {
   vec2 p = gl_FragCoord.xy;
+  // objects that can affect this tile
+  uvec2 tileId = min(uvec2(p) / tileSize, uvec2(tileCols - 1, 0xFFFF));
+  uvec2 tile = tiles[min(tileId.y * tileCols + tileId.x, uint(tiles.length()) - 1)];
   // calculate SDF/D/RM
-  SdfOut sdf = calculateSdf(p, 10000.0);
+  SdfOut sdf = calculateSdf(p, 10000.0, tile);
   outColor = sdf.color;
-  // add lighting
-  if (lightMaxDist > 0.01) {
+  // add lighting, attenuation is zero outside the light radius
+  float distFromLight = distance(p, lightPos);
+  if (lightMaxDist > 0.01 && distFromLight < lightMaxDist) {
     // calculations
     float shadowSmoothing = 2.0;
-    float distFromLight = distance(p, lightPos);
     vec2 shadowOffset = normalize(p - lightPos) * shadowSmoothing;
-    RayMarchOut rm = rayMarch(p - shadowOffset, lightPos, distFromLight);
+    RayMarchOut rm = rayMarch(p - shadowOffset, lightPos, distFromLight, tile);
     // lighting
     float inLight = step(distFromLight, rm.dist);
     float attenuation = smoothstep(lightMaxDist, 0.0, distFromLight);
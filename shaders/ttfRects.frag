@@ -2,12 +2,8 @@
 
 layout(set = 2, binding = 0) uniform sampler2D texture0;
 
-layout(set = 3, binding = 0) uniform UniformBufferObject {
-  vec4 color;
-};
-
 layout(location = 0) in vec2 uv;
-layout(location = 1) in vec3 normal;
+layout(location = 1) in vec4 color;
 
 layout(location = 0) out vec4 outColor;
 
@@ -0,0 +1,27 @@
+#version 450
+
+layout(set = 2, binding = 0) uniform sampler2D texture0;
+
+layout(set = 3, binding = 0) uniform UniformBufferObject {
+  vec4 outlineColor;
+  float outlineWidth;
+  float softness;
+};
+
+layout(location = 0) in vec2 uv;
+layout(location = 1) in vec4 color;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  // distance field is stored in alpha, 0.5 is the glyph edge
+  float dist = texture(texture0, uv).a;
+  // smooth over about one screen pixel whatever the text scale
+  float aa = max(0.5 * fwidth(dist) * softness, 0.0001);
+  float fill = smoothstep(0.5 - aa, 0.5 + aa, dist);
+  float edge = 0.5 - outlineWidth;
+  float shape = smoothstep(edge - aa, edge + aa, dist);
+  vec4 base = color;
+  if (outlineWidth > 0.0) base = mix(vec4(outlineColor.rgb, outlineColor.a * color.a), color, fill);
+  outColor = vec4(base.rgb, base.a * shape);
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
@@ -7,7 +8,21 @@
 #include <glm/vec2.hpp>
 
 #include "util.hpp"
+#include "gpuBackend.hpp"
+#include "gpuRecorder.hpp"
+#include "frameArena.hpp"
+#include "meshFactory.hpp"
+#include "stagingRing.hpp"
+#include "gpuResources.hpp"
+#include "jobSystem.hpp"
+#include "framePacer.hpp"
+#include "profiler.hpp"
+#include "assetPak.hpp"
+#include "shaderRegistry.hpp"
 #include "sdfPipeline.hpp"
+#include "sdfBatch.hpp"
+#include "sdfGrid.hpp"
+#include "sdfTiles.hpp"
 #include "textPipeline.hpp"
 #include "objPipeline.hpp"
 
@@ -34,6 +49,10 @@ namespace App {
     virtual void destroy() {
       SDL_Log("ERR: scene destroy method not overwritten");
     };
+    // optional text appended to the debug overlay
+    virtual std::string debugInfo() {
+      return "";
+    };
   protected:
     Scene() {};
   };
@@ -44,10 +63,13 @@ namespace App {
     SDL_AppResult update(SystemUpdates const &sys) override;
     SDL_AppResult render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* screenTx) override;
     void destroy() override;
+    std::string debugInfo() override;
     SDFPipeline *sdfPipe = NULL;
     glm::vec2 screenSize = glm::vec2(0.0f);
     glm::vec2 sdfLightPos = glm::vec2(0.0f);
     std::vector<SDFObject> objects;
+    SDFSysData sysData = {};
+    bool benchKeyHeld = false;
   };
   class ObjScene : public Scene {
   public:
@@ -55,24 +77,48 @@ namespace App {
     SDL_AppResult update(SystemUpdates const &sys);
     SDL_AppResult render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* screenTx);
     void destroy();
+    std::string debugInfo();
     ObjectPipeline *objPipe = NULL;
     glm::vec2 screenSize = glm::vec2(0.0f);
     bool usePerspective = true;
   };
+  class StressScene : public Scene {
+  public:
+    StressScene(SDL_GPUDevice *gpu, SDL_GPUTextureFormat targetFormat);
+    SDL_AppResult update(SystemUpdates const &sys) override;
+    SDL_AppResult render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* screenTx) override;
+    void destroy() override;
+    std::string debugInfo() override;
+    static const int GRID_SIZE = 100;
+    ObjectPipeline *objPipe = NULL;
+    glm::vec2 screenSize = glm::vec2(0.0f);
+    float spin = 0.0f;
+  };
+  // runs each scene headless against the recording backend, false if any budget is exceeded
+  bool runHeadlessBench(Uint32 frames);
   // root app state
   struct AppState {
     SDL_Window *window = NULL;
     SDL_GPUDevice *gpu = NULL;
     SDL_Surface *winIcon = NULL;
+    // --headless only runs the scene budgets, nothing else is created
+    bool headless = false;
+    FramePacer *pacer = NULL;
     SystemUpdates sys;
     std::vector<Scene*> scenes;
     int currentScene = 1;
     // text engine
     TTF_TextEngine *textEngine = NULL;
     TTF_Font *font = NULL;
+    // overlay text is drawn from a distance field atlas, PageUp/PageDown scale it
     TextPipeline *overlayp = NULL;
+    float textScale = 0.75f;
     // FPS debug helpers
     StringObject *fpsOverlay = NULL;
+    // F4 toggles the per-zone breakdown of the last frame
+    StringObject *profileOverlay = NULL;
+    // drawn by overlayp every frame, built once so nothing is copied per frame
+    std::vector<StringObject*> overlayStrs;
     Uint64 timeSinceLastFps = 0;
   };
 }
\ No newline at end of file
@@ -0,0 +1,386 @@
+#include <vector>
+#include "assetPak.hpp"
+#include "blockCodec.hpp"
+#include "jobSystem.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace App;
+
+bool AssetPak::open(const char *path) {
+  close();
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file != INVALID_HANDLE_VALUE) {
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping != NULL) {
+      base = static_cast<Uint8 const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (base != NULL) {
+      fileSize = (size_t)size.QuadPart;
+      fileHandle = file;
+      mapHandle = mapping;
+    } else {
+      if (mapping != NULL) CloseHandle(mapping);
+      CloseHandle(file);
+    }
+  }
+#else
+  int fd = ::open(path, O_RDONLY);
+  if (fd >= 0) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr != MAP_FAILED) {
+        base = static_cast<Uint8 const*>(ptr);
+        fileSize = st.st_size;
+      }
+    }
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+  }
+#endif
+  if (base == NULL) {
+    // mapping unavailable, read the whole file instead
+    base = static_cast<Uint8 const*>(SDL_LoadFile(path, &fileSize));
+    if (base == NULL) {
+      SDL_Log("ERR: Could not open asset pak %s - %s", path, SDL_GetError());
+      return false;
+    }
+    loaded = true;
+  }
+  if (!validate()) {
+    close();
+    return false;
+  }
+  SDL_Log("Mounted %s: %d assets, %d bytes%s", path, header->entryCount, (int)fileSize, loaded ? " (not mapped)" : "");
+  return true;
+}
+
+// bounds check everything so lookups can trust the mapping
+bool AssetPak::validate() {
+  if (fileSize < sizeof(PakHeader)) {
+    SDL_Log("ERR: Asset pak is too small");
+    return false;
+  }
+  header = reinterpret_cast<PakHeader const*>(base);
+  if (header->magic != PAK_MAGIC || header->version != PAK_VERSION) {
+    SDL_Log("ERR: Unsupported asset pak (magic %x, version %d)", header->magic, header->version);
+    return false;
+  }
+  // the names offset and size come straight from the file, their sum could wrap
+  Uint64 tocEnd = sizeof(PakHeader) + (Uint64)header->entryCount * sizeof(PakEntry);
+  if (tocEnd > fileSize || header->namesOffset < tocEnd || header->namesSize == 0 ||
+    header->namesSize > fileSize || header->namesOffset > fileSize - header->namesSize ||
+    base[header->namesOffset + header->namesSize - 1] != '\0'
+  ) {
+    SDL_Log("ERR: Asset pak table of contents is corrupt");
+    return false;
+  }
+  entries = reinterpret_cast<PakEntry const*>(base + sizeof(PakHeader));
+  names = reinterpret_cast<char const*>(base + header->namesOffset);
+  for (Uint32 i=0; i < header->entryCount; i++) {
+    PakEntry const &e = entries[i];
+    if (e.flags & ~PAK_FLAG_LZ) {
+      SDL_Log("ERR: Asset pak entry %d has unsupported flags %x", i, e.flags);
+      return false;
+    }
+    bool inBounds = e.offset <= fileSize && e.nameOffset < header->namesSize;
+    if (inBounds && (e.flags & PAK_FLAG_LZ)) {
+      ChunkReader reader;
+      inBounds = reader.init(base + e.offset, fileSize - e.offset, e.size);
+    } else if (inBounds) {
+      inBounds = e.size <= fileSize - e.offset;
+    }
+    if (!inBounds) {
+      SDL_Log("ERR: Asset pak entry %d is out of bounds", i);
+      return false;
+    }
+    if (i > 0 && entries[i - 1].hash > e.hash) {
+      SDL_Log("ERR: Asset pak entries are not sorted");
+      return false;
+    }
+  }
+  return true;
+}
+
+void AssetPak::close() {
+  if (base != NULL) {
+    if (loaded) {
+      SDL_free((void*)base);
+    } else {
+#ifdef _WIN32
+      UnmapViewOfFile(base);
+      CloseHandle((HANDLE)mapHandle);
+      CloseHandle((HANDLE)fileHandle);
+      mapHandle = NULL;
+      fileHandle = NULL;
+#else
+      munmap((void*)base, fileSize);
+#endif
+    }
+  }
+  base = NULL;
+  fileSize = 0;
+  header = NULL;
+  entries = NULL;
+  names = NULL;
+  loaded = false;
+}
+
+// binary search the hash, then compare names for collisions
+PakEntry const* AssetPak::lookup(const char *name) const {
+  if (header == NULL) return NULL;
+  Uint64 hash = pakHash(name);
+  Uint32 lo = 0;
+  Uint32 hi = header->entryCount;
+  while (lo < hi) {
+    Uint32 mid = (lo + hi) / 2;
+    if (entries[mid].hash < hash) lo = mid + 1;
+    else hi = mid;
+  }
+  for (Uint32 i = lo; i < header->entryCount && entries[i].hash == hash; i++) {
+    if (SDL_strcmp(names + entries[i].nameOffset, name) == 0) return &entries[i];
+  }
+  return NULL;
+}
+
+void const* AssetPak::find(const char *name, size_t *size) const {
+  PakEntry const *e = lookup(name);
+  if (e == NULL || (e->flags & PAK_FLAG_LZ)) return NULL;
+  if (size != NULL) *size = e->size;
+  return base + e->offset;
+}
+
+// returns the asset contents, compressed entries are decoded into a new
+// buffer on the job system's threads and owned is set
+void const* AssetPak::load(const char *name, size_t *size, bool *owned) const {
+  *owned = false;
+  PakEntry const *e = lookup(name);
+  if (e == NULL) return NULL;
+  if (!(e->flags & PAK_FLAG_LZ)) {
+    *size = e->size;
+    return base + e->offset;
+  }
+  ChunkReader reader;
+  reader.init(base + e->offset, fileSize - e->offset, e->size);
+  Uint8 *data = static_cast<Uint8*>(SDL_malloc(e->size));
+  if (data == NULL) return NULL;
+  SDL_AtomicInt failed;
+  SDL_SetAtomicInt(&failed, 0);
+  getJobSystem()->parallelFor(reader.count(), 1, [&](Uint32 begin, Uint32 end) {
+    for (Uint32 chunk = begin; chunk < end; chunk++) {
+      if (!reader.decode(chunk, data)) SDL_SetAtomicInt(&failed, 1);
+    }
+  });
+  if (SDL_GetAtomicInt(&failed) != 0) {
+    SDL_Log("ERR: Corrupt compressed asset %s", name);
+    SDL_free(data);
+    return NULL;
+  }
+  *size = e->size;
+  *owned = true;
+  return data;
+}
+
+#pragma region Chunk stream
+
+namespace {
+  // streams a compressed entry while jobs decode it front to back.
+  // reads only wait for the chunks they cover
+  struct ChunkStream {
+    ChunkReader reader;
+    Uint8 *data = NULL;
+    Uint64 size = 0;
+    Uint64 pos = 0;
+    SDL_AtomicInt next;
+    SDL_Mutex *lock = NULL;
+    SDL_Condition *decoded = NULL;
+    // 0 pending, 1 decoded, 2 corrupt. guarded by lock
+    std::vector<Uint8> state;
+    // decode jobs still running, guarded by lock
+    int running = 0;
+  };
+}
+
+// chunks are handed out in order so the front of the stream is ready first
+static bool decodeNextChunk(ChunkStream *s) {
+  int chunk = SDL_AddAtomicInt(&s->next, 1);
+  if (chunk >= (int)s->reader.count()) return false;
+  bool ok = s->reader.decode(chunk, s->data);
+  SDL_LockMutex(s->lock);
+  s->state[chunk] = ok ? 1 : 2;
+  SDL_BroadcastCondition(s->decoded);
+  SDL_UnlockMutex(s->lock);
+  return true;
+}
+
+static void decodeChunks(ChunkStream *s) {
+  while (decodeNextChunk(s));
+  SDL_LockMutex(s->lock);
+  s->running--;
+  SDL_BroadcastCondition(s->decoded);
+  SDL_UnlockMutex(s->lock);
+}
+
+// the reader decodes chunks nobody took yet and only sleeps on ones a job is
+// decoding, so a read can't stall behind jobs that haven't started
+static bool waitForChunk(ChunkStream *s, Uint32 chunk) {
+  SDL_LockMutex(s->lock);
+  while (s->state[chunk] == 0) {
+    SDL_UnlockMutex(s->lock);
+    bool took = decodeNextChunk(s);
+    SDL_LockMutex(s->lock);
+    if (!took && s->state[chunk] == 0) SDL_WaitCondition(s->decoded, s->lock);
+  }
+  bool ok = s->state[chunk] == 1;
+  SDL_UnlockMutex(s->lock);
+  return ok;
+}
+
+static Sint64 SDLCALL chunkStreamSize(void *userdata) {
+  return (Sint64)static_cast<ChunkStream*>(userdata)->size;
+}
+
+static Sint64 SDLCALL chunkStreamSeek(void *userdata, Sint64 offset, SDL_IOWhence whence) {
+  ChunkStream *s = static_cast<ChunkStream*>(userdata);
+  Sint64 pos = offset;
+  if (whence == SDL_IO_SEEK_CUR) pos += (Sint64)s->pos;
+  else if (whence == SDL_IO_SEEK_END) pos += (Sint64)s->size;
+  if (pos < 0) {
+    SDL_SetError("Seek before the start of the asset");
+    return -1;
+  }
+  s->pos = SDL_min((Uint64)pos, s->size);
+  return (Sint64)s->pos;
+}
+
+static size_t SDLCALL chunkStreamRead(void *userdata, void *ptr, size_t size, SDL_IOStatus *status) {
+  ChunkStream *s = static_cast<ChunkStream*>(userdata);
+  size_t n = (size_t)SDL_min((Uint64)size, s->size - s->pos);
+  if (n == 0) {
+    *status = SDL_IO_STATUS_EOF;
+    return 0;
+  }
+  Uint64 chunkSize = s->reader.rawSize(0);
+  for (Uint64 c = s->pos / chunkSize; c <= (s->pos + n - 1) / chunkSize; c++) {
+    if (!waitForChunk(s, (Uint32)c)) {
+      SDL_SetError("Corrupt compressed asset");
+      *status = SDL_IO_STATUS_ERROR;
+      return 0;
+    }
+  }
+  SDL_memcpy(ptr, s->data + s->pos, n);
+  s->pos += n;
+  return n;
+}
+
+static bool SDLCALL chunkStreamClose(void *userdata) {
+  ChunkStream *s = static_cast<ChunkStream*>(userdata);
+  // stop handing out chunks, then let running decodes finish
+  SDL_SetAtomicInt(&s->next, (int)s->reader.count());
+  SDL_LockMutex(s->lock);
+  while (s->running > 0) SDL_WaitCondition(s->decoded, s->lock);
+  SDL_UnlockMutex(s->lock);
+  SDL_DestroyCondition(s->decoded);
+  SDL_DestroyMutex(s->lock);
+  SDL_free(s->data);
+  delete s;
+  return true;
+}
+
+static SDL_IOStream* openChunkStream(ChunkReader const &reader, Uint64 size) {
+  ChunkStream *s = new ChunkStream();
+  s->reader = reader;
+  s->size = size;
+  s->data = static_cast<Uint8*>(SDL_malloc(size));
+  s->lock = SDL_CreateMutex();
+  s->decoded = SDL_CreateCondition();
+  s->state.resize(reader.count(), 0);
+  SDL_SetAtomicInt(&s->next, 0);
+  SDL_IOStreamInterface iface;
+  SDL_INIT_INTERFACE(&iface);
+  iface.size = chunkStreamSize;
+  iface.seek = chunkStreamSeek;
+  iface.read = chunkStreamRead;
+  iface.close = chunkStreamClose;
+  SDL_IOStream *io = NULL;
+  if (s->data != NULL && s->lock != NULL && s->decoded != NULL) io = SDL_OpenIO(&iface, s);
+  if (io == NULL) {
+    chunkStreamClose(s);
+    return NULL;
+  }
+  // one job per worker thread, the reader makes up the last one
+  JobSystem *jobs = getJobSystem();
+  s->running = SDL_max(SDL_min(jobs->threadCount() - 1, (int)reader.count() - 1), 0);
+  for (int i=0; i < s->running; i++) {
+    jobs->run([s]() { decodeChunks(s); });
+  }
+  return io;
+}
+
+#pragma endregion Chunk stream
+
+// read-only stream straight over the mapped payload, or a decoding stream
+// for compressed entries
+SDL_IOStream* AssetPak::openIO(const char *name) const {
+  PakEntry const *e = lookup(name);
+  if (e == NULL) return NULL;
+  if (!(e->flags & PAK_FLAG_LZ)) return SDL_IOFromConstMem(base + e->offset, e->size);
+  ChunkReader reader;
+  reader.init(base + e->offset, fileSize - e->offset, e->size);
+  return openChunkStream(reader, e->size);
+}
+
+static AssetPak *mountedPak = NULL;
+
+bool App::mountAssetPak(const char *path) {
+  unmountAssetPak();
+  AssetPak *pak = new AssetPak();
+  if (!pak->open(path)) {
+    delete pak;
+    return false;
+  }
+  mountedPak = pak;
+  return true;
+}
+
+// streams/pointers handed out from the archive are invalid after this
+void App::unmountAssetPak() {
+  if (mountedPak == NULL) return;
+  mountedPak->close();
+  delete mountedPak;
+  mountedPak = NULL;
+}
+
+SDL_IOStream* App::openAsset(const char *path) {
+  if (mountedPak != NULL) {
+    SDL_IOStream *io = mountedPak->openIO(path);
+    if (io != NULL) return io;
+  }
+  return SDL_IOFromFile(path, "rb");
+}
+
+// returns the asset contents, owned is set if the caller has to SDL_free them
+void const* App::loadAsset(const char *path, size_t *size, bool *owned) {
+  *owned = false;
+  if (mountedPak != NULL) {
+    void const *data = mountedPak->load(path, size, owned);
+    if (data != NULL) return data;
+  }
+  void *data = SDL_LoadFile(path, size);
+  if (data != NULL) *owned = true;
+  return data;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include "pakFormat.hpp"
+
+namespace App {
+  // read-only view of a pak v2 archive. the file is memory mapped and assets
+  // are handed out as pointers/streams into the mapping without copying.
+  // compressed entries are decoded chunk by chunk on worker threads instead
+  class AssetPak {
+  public:
+    bool open(const char *path);
+    void close();
+    PakEntry const* lookup(const char *name) const;
+    // only uncompressed entries can be returned in place
+    void const* find(const char *name, size_t *size) const;
+    void const* load(const char *name, size_t *size, bool *owned) const;
+    SDL_IOStream* openIO(const char *name) const;
+    Uint32 count() const { return header == NULL ? 0 : header->entryCount; }
+  private:
+    bool validate();
+    Uint8 const *base = NULL;
+    size_t fileSize = 0;
+    PakHeader const *header = NULL;
+    PakEntry const *entries = NULL;
+    char const *names = NULL;
+    // the file couldn't be mapped and was loaded into memory instead
+    bool loaded = false;
+#ifdef _WIN32
+    void *fileHandle = NULL;
+    void *mapHandle = NULL;
+#endif
+  };
+  // the archive used by openAsset/loadAsset, assets fall back to
+  // loose files when no archive is mounted or it doesn't contain them
+  bool mountAssetPak(const char *path);
+  void unmountAssetPak();
+  SDL_IOStream* openAsset(const char *path);
+  void const* loadAsset(const char *path, size_t *size, bool *owned);
+}
@@ -0,0 +1,313 @@
+#include "blockCodec.hpp"
+#include "pakFormat.hpp"
+
+using namespace App;
+
+#pragma region LZ4 block
+
+static const Uint32 MIN_MATCH = 4;
+// the block format requires the last 5 bytes to be literals and the last
+// match to start at least 12 bytes before the end
+static const Uint32 LAST_LITERALS = 5;
+static const Uint32 MF_LIMIT = 12;
+static const Uint32 MAX_OFFSET = 65535;
+static const Uint32 HASH_LOG = 16;
+// chain entries walked per position in high mode
+static const Uint32 HIGH_ATTEMPTS = 64;
+
+static inline Uint32 read32(Uint8 const *p) {
+  Uint32 v;
+  SDL_memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline Uint32 hashSeq(Uint32 seq) {
+  return (seq * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// bytes matching between a and b, b never reads past limit
+static inline Uint32 matchLength(Uint8 const *src, Uint32 a, Uint32 b, Uint32 limit) {
+  Uint32 start = b;
+  while (b + 8 <= limit) {
+    Uint64 x, y;
+    SDL_memcpy(&x, src + a, 8);
+    SDL_memcpy(&y, src + b, 8);
+    if (x != y) break;
+    a += 8;
+    b += 8;
+  }
+  while (b < limit && src[a] == src[b]) {
+    a++;
+    b++;
+  }
+  return b - start;
+}
+
+static Uint8* writeLength(Uint8 *op, Uint32 len) {
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (Uint8)len;
+  return op;
+}
+
+// token, literals, then the match. a matchLen of 0 emits the final literals
+static Uint8* emitSequence(Uint8 *op, Uint8 *oend, Uint8 const *lit, Uint32 litLen, Uint32 offset, Uint32 matchLen) {
+  Uint64 needed = 1 + litLen + litLen / 255 + 1 + (matchLen > 0 ? 2 + matchLen / 255 + 1 : 0);
+  if (needed > (Uint64)(oend - op)) return NULL;
+  Uint8 *token = op++;
+  *token = (Uint8)(SDL_min(litLen, 15u) << 4);
+  if (litLen >= 15) op = writeLength(op, litLen - 15);
+  SDL_memcpy(op, lit, litLen);
+  op += litLen;
+  if (matchLen == 0) return op;
+  *op++ = (Uint8)(offset & 0xFF);
+  *op++ = (Uint8)(offset >> 8);
+  Uint32 ml = matchLen - MIN_MATCH;
+  *token |= (Uint8)SDL_min(ml, 15u);
+  if (ml >= 15) op = writeLength(op, ml - 15);
+  return op;
+}
+
+Uint32 App::lzCompressBound(Uint32 size) {
+  return size + size / 255 + 16;
+}
+
+Uint32 App::lzCompress(Uint8 const *src, Uint32 size, Uint8 *dst, Uint32 capacity, LZLevel level) {
+  // empty input is a lone token, src may be NULL then
+  if (size == 0) {
+    if (capacity == 0) return 0;
+    dst[0] = 0;
+    return 1;
+  }
+  Uint8 *op = dst;
+  Uint8 *oend = dst + capacity;
+  Uint32 anchor = 0;
+  if (size > MF_LIMIT) {
+    Uint32 mfLimit = size - MF_LIMIT;
+    Uint32 matchLimit = size - LAST_LITERALS;
+    std::vector<Sint32> head(1 << HASH_LOG, -1);
+    // high mode links every position to the previous one with the same hash
+    std::vector<Uint16> chain(level == LZ_High ? MAX_OFFSET + 1 : 0);
+    Uint32 inserted = 0;
+    auto insertUpTo = [&](Uint32 pos) {
+      for (; inserted < pos; inserted++) {
+        Uint32 h = hashSeq(read32(src + inserted));
+        Uint32 delta = head[h] < 0 ? 0 : inserted - head[h];
+        chain[inserted & MAX_OFFSET] = (Uint16)(delta > MAX_OFFSET ? 0 : delta);
+        head[h] = inserted;
+      }
+    };
+    // longest match for pos, 0 if there is none
+    auto findHigh = [&](Uint32 pos, Uint32 &match) {
+      insertUpTo(pos);
+      Uint32 best = 0;
+      Sint64 cand = head[hashSeq(read32(src + pos))];
+      for (Uint32 attempts = HIGH_ATTEMPTS; cand >= 0 && pos - cand <= MAX_OFFSET && attempts > 0; attempts--) {
+        Uint32 c = (Uint32)cand;
+        if (pos + best < matchLimit && src[c + best] == src[pos + best] && read32(src + c) == read32(src + pos)) {
+          Uint32 len = MIN_MATCH + matchLength(src, c + MIN_MATCH, pos + MIN_MATCH, matchLimit);
+          if (len > best) {
+            best = len;
+            match = c;
+          }
+        }
+        Uint16 delta = chain[c & MAX_OFFSET];
+        if (delta == 0) break;
+        cand -= delta;
+      }
+      return best;
+    };
+
+    Uint32 ip = 0;
+    Uint32 misses = 0;
+    while (ip < mfLimit) {
+      Uint32 match = 0;
+      Uint32 len = 0;
+      if (level == LZ_High) {
+        len = findHigh(ip, match);
+        // lazy evaluation, prefer a longer match starting one byte later
+        while (len > 0 && ip + 1 < mfLimit) {
+          Uint32 nextMatch = 0;
+          Uint32 nextLen = findHigh(ip + 1, nextMatch);
+          if (nextLen <= len) break;
+          ip++;
+          len = nextLen;
+          match = nextMatch;
+        }
+      } else {
+        Uint32 seq = read32(src + ip);
+        Uint32 h = hashSeq(seq);
+        Sint32 cand = head[h];
+        head[h] = ip;
+        if (cand >= 0 && ip - cand <= MAX_OFFSET && read32(src + cand) == seq) {
+          match = cand;
+          len = MIN_MATCH + matchLength(src, match + MIN_MATCH, ip + MIN_MATCH, matchLimit);
+        }
+      }
+      if (len == 0) {
+        // skip ahead faster through data that doesn't compress
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      while (ip > anchor && match > 0 && src[ip - 1] == src[match - 1]) {
+        ip--;
+        match--;
+        len++;
+      }
+      op = emitSequence(op, oend, src + anchor, ip - anchor, ip - match, len);
+      if (op == NULL) return 0;
+      ip += len;
+      anchor = ip;
+      if (level == LZ_Fast && ip - 2 < mfLimit) head[hashSeq(read32(src + ip - 2))] = ip - 2;
+    }
+  }
+  op = emitSequence(op, oend, src + anchor, size - anchor, 0, 0);
+  if (op == NULL) return 0;
+  return (Uint32)(op - dst);
+}
+
+// every length and offset is checked, malformed input can't write out of bounds
+Sint32 App::lzDecompress(Uint8 const *src, Uint32 size, Uint8 *dst, Uint32 capacity) {
+  // a block has at least its token, src may be NULL otherwise
+  if (size == 0) return -1;
+  Uint8 const *ip = src;
+  Uint8 const *iend = src + size;
+  Uint8 *op = dst;
+  Uint8 *oend = dst + capacity;
+  while (ip < iend) {
+    Uint32 token = *ip++;
+    Uint32 litLen = token >> 4;
+    if (litLen == 15) {
+      Uint32 b = 255;
+      while (b == 255) {
+        if (ip >= iend) return -1;
+        b = *ip++;
+        litLen += b;
+      }
+    }
+    if (litLen > (Uint64)(iend - ip) || litLen > (Uint64)(oend - op)) return -1;
+    if (litLen + 16 <= (Uint64)(iend - ip) && litLen + 16 <= (Uint64)(oend - op)) {
+      // fixed size copies, the overshoot is overwritten by what follows
+      for (Uint32 i=0; i < litLen; i += 16) SDL_memcpy(op + i, ip + i, 16);
+    } else if (litLen > 0) {
+      SDL_memcpy(op, ip, litLen);
+    }
+    ip += litLen;
+    op += litLen;
+    // the last sequence has no match
+    if (ip == iend) return (Sint32)(op - dst);
+
+    if (iend - ip < 2) return -1;
+    Uint32 offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (Uint64)(op - dst)) return -1;
+    Uint32 matchLen = token & 15;
+    if (matchLen == 15) {
+      Uint32 b = 255;
+      while (b == 255) {
+        if (ip >= iend) return -1;
+        b = *ip++;
+        matchLen += b;
+      }
+    }
+    matchLen += MIN_MATCH;
+    if (matchLen > (Uint64)(oend - op)) return -1;
+    Uint8 const *match = op - offset;
+    if (offset >= 16 && matchLen + 16 <= (Uint64)(oend - op)) {
+      // steps no larger than offset never read bytes they are about to write
+      for (Uint32 i=0; i < matchLen; i += 16) SDL_memcpy(op + i, match + i, 16);
+      op += matchLen;
+    } else if (offset >= 8 && matchLen + 8 <= (Uint64)(oend - op)) {
+      for (Uint32 i=0; i < matchLen; i += 8) SDL_memcpy(op + i, match + i, 8);
+      op += matchLen;
+    } else if (offset >= matchLen) {
+      SDL_memcpy(op, match, matchLen);
+      op += matchLen;
+    } else {
+      // overlapping copy repeats the last `offset` bytes
+      for (Uint32 i=0; i < matchLen; i++) *op++ = *match++;
+    }
+  }
+  return -1;
+}
+
+#pragma endregion LZ4 block
+
+#pragma region Chunks
+
+bool App::compressChunks(Uint8 const *src, Uint64 size, LZLevel level, Uint32 chunkSize, std::vector<Uint8> &out) {
+  PakChunkTable table;
+  table.chunkSize = chunkSize;
+  Uint64 count = (size + chunkSize - 1) / chunkSize;
+  if (count > SDL_MAX_UINT32) return false;
+  table.chunkCount = (Uint32)count;
+  size_t tableSize = sizeof(PakChunkTable) + count * sizeof(Uint32);
+  out.assign(tableSize, 0);
+  SDL_memcpy(out.data(), &table, sizeof(table));
+
+  std::vector<Uint8> scratch(lzCompressBound(chunkSize));
+  for (Uint32 i=0; i < count; i++) {
+    Uint64 offset = (Uint64)i * chunkSize;
+    Uint32 raw = (Uint32)SDL_min((Uint64)chunkSize, size - offset);
+    Uint32 stored = lzCompress(src + offset, raw, scratch.data(), scratch.size(), level);
+    if (stored == 0 || stored >= raw) {
+      out.insert(out.end(), src + offset, src + offset + raw);
+    } else {
+      out.insert(out.end(), scratch.begin(), scratch.begin() + stored);
+    }
+    Uint64 end = out.size() - tableSize;
+    if (end > SDL_MAX_UINT32) return false;
+    Uint32 end32 = (Uint32)end;
+    SDL_memcpy(out.data() + sizeof(PakChunkTable) + i * sizeof(Uint32), &end32, sizeof(end32));
+  }
+  return true;
+}
+
+bool ChunkReader::init(Uint8 const *payload, Uint64 payloadSize, Uint64 rawSize) {
+  PakChunkTable table;
+  if (payloadSize < sizeof(table)) return false;
+  SDL_memcpy(&table, payload, sizeof(table));
+  if (table.chunkSize == 0 || table.chunkCount != (rawSize + table.chunkSize - 1) / table.chunkSize) return false;
+  Uint64 tableSize = sizeof(PakChunkTable) + (Uint64)table.chunkCount * sizeof(Uint32);
+  if (tableSize > payloadSize) return false;
+  chunkCount = table.chunkCount;
+  chunkSize = table.chunkSize;
+  size = rawSize;
+  ends = reinterpret_cast<Uint32 const*>(payload + sizeof(PakChunkTable));
+  data = payload + tableSize;
+  Uint32 prev = 0;
+  for (Uint32 i=0; i < chunkCount; i++) {
+    if (ends[i] <= prev || ends[i] > payloadSize - tableSize || ends[i] - prev > this->rawSize(i)) {
+      chunkCount = 0;
+      return false;
+    }
+    prev = ends[i];
+  }
+  return true;
+}
+
+Uint32 ChunkReader::rawSize(Uint32 chunk) const {
+  return (Uint32)SDL_min((Uint64)chunkSize, size - rawOffset(chunk));
+}
+
+Uint64 ChunkReader::storedSize() const {
+  Uint64 tableSize = sizeof(PakChunkTable) + (Uint64)chunkCount * sizeof(Uint32);
+  return tableSize + (chunkCount > 0 ? ends[chunkCount - 1] : 0);
+}
+
+bool ChunkReader::decode(Uint32 chunk, Uint8 *dst) const {
+  Uint32 begin = chunk > 0 ? ends[chunk - 1] : 0;
+  Uint32 stored = ends[chunk] - begin;
+  Uint32 raw = rawSize(chunk);
+  Uint8 *out = dst + rawOffset(chunk);
+  if (stored == raw) {
+    SDL_memcpy(out, data + begin, raw);
+    return true;
+  }
+  return lzDecompress(data + begin, stored, out, raw) == (Sint32)raw;
+}
+
+#pragma endregion Chunks
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+
+namespace App {
+  // LZ4 block format compressor/decompressor. fast mode does a single hash
+  // probe per position, high mode searches hash chains for the longest match.
+  // both produce streams any LZ4 block decoder can read
+  enum LZLevel {
+    LZ_Fast,
+    LZ_High
+  };
+  Uint32 lzCompressBound(Uint32 size);
+  // returns the compressed size, 0 if it didn't fit in capacity
+  Uint32 lzCompress(Uint8 const *src, Uint32 size, Uint8 *dst, Uint32 capacity, LZLevel level);
+  // returns the decompressed size, -1 if the input is malformed or overflows dst
+  Sint32 lzDecompress(Uint8 const *src, Uint32 size, Uint8 *dst, Uint32 capacity);
+
+  // payloads stored with PAK_FLAG_LZ are split into independently compressed
+  // chunks, see PakChunkTable. fails if the result is too large for the table
+  bool compressChunks(Uint8 const *src, Uint64 size, LZLevel level, Uint32 chunkSize, std::vector<Uint8> &out);
+  class ChunkReader {
+  public:
+    // checks the chunk table against the available payload bytes
+    bool init(Uint8 const *payload, Uint64 payloadSize, Uint64 rawSize);
+    Uint32 count() const { return chunkCount; }
+    Uint64 rawOffset(Uint32 chunk) const { return (Uint64)chunk * chunkSize; }
+    Uint32 rawSize(Uint32 chunk) const;
+    Uint64 storedSize() const;
+    // dst is the start of the whole decompressed asset. chunks are
+    // independent, so any number of threads can decode them at once
+    bool decode(Uint32 chunk, Uint8 *dst) const;
+  private:
+    Uint8 const *data = NULL;
+    Uint32 const *ends = NULL;
+    Uint64 size = 0;
+    Uint32 chunkCount = 0;
+    Uint32 chunkSize = 0;
+  };
+}
@@ -0,0 +1,113 @@
+#include "frameArena.hpp"
+
+using namespace App;
+
+#pragma region Heap counter
+
+static SDL_AtomicInt heapAllocs;
+
+// counts every allocation going through the global operator new
+void* operator new(size_t size) {
+  SDL_AddAtomicInt(&heapAllocs, 1);
+  void *p = SDL_malloc(size == 0 ? 1 : size);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+  SDL_free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  SDL_free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept {
+  SDL_free(p);
+}
+
+void operator delete[](void *p, size_t size) noexcept {
+  SDL_free(p);
+}
+
+Uint32 App::heapAllocationCount() {
+  return (Uint32)SDL_GetAtomicInt(&heapAllocs);
+}
+
+#pragma endregion Heap counter
+
+#pragma region Arena
+
+static Uint8* allocBlock(size_t size) {
+  return static_cast<Uint8*>(SDL_aligned_alloc(alignof(std::max_align_t), size));
+}
+
+FrameArena::FrameArena(Uint32 capacity) {
+  for (Frame &frame : frames) {
+    frame.blocks.reserve(4);
+    frame.blocks.push_back(Block { allocBlock(capacity), capacity, 0 });
+  }
+  heapAtFrameStart = heapAllocationCount();
+}
+
+FrameArena::~FrameArena() {
+  for (Frame &frame : frames) {
+    for (Block &block : frame.blocks) SDL_aligned_free(block.data);
+  }
+}
+
+void* FrameArena::alloc(size_t size, size_t align) {
+  Block *block = &frames[current].blocks.back();
+  size_t offset = (block->used + align - 1) & ~(align - 1);
+  if (offset + size > block->size) {
+    // overflow, keep going in a new block at least as large as the last one
+    size_t blockSize = SDL_max(block->size, size + align);
+    frames[current].blocks.push_back(Block { allocBlock(blockSize), blockSize, 0 });
+    block = &frames[current].blocks.back();
+    offset = 0;
+    stats.overflowBlocks++;
+  }
+  block->used = offset + size;
+  stats.bytesUsed += size;
+  stats.allocations++;
+  return block->data + offset;
+}
+
+void FrameArena::endFrame() {
+  stats.heapAllocations = heapAllocationCount() - heapAtFrameStart;
+  lastStats = stats;
+  stats = FrameArenaStats {};
+  heapAtFrameStart = heapAllocationCount();
+
+  // the oldest frame is done with its memory by now
+  current = (current + 1) % FRAMES_IN_FLIGHT;
+  std::vector<Block> &blocks = frames[current].blocks;
+  if (blocks.size() > 1) {
+    size_t total = 0;
+    for (Block &block : blocks) {
+      total += block.size;
+      SDL_aligned_free(block.data);
+    }
+    blocks.clear();
+    blocks.push_back(Block { allocBlock(total), total, 0 });
+  }
+  blocks[0].used = 0;
+}
+
+#pragma endregion Arena
+
+static FrameArena *frameArena = NULL;
+
+FrameArena* App::getFrameArena() {
+  if (frameArena == NULL) frameArena = new FrameArena(FrameArena::DEFAULT_CAPACITY);
+  return frameArena;
+}
+
+void App::destroyFrameArena() {
+  delete frameArena;
+  frameArena = NULL;
+}
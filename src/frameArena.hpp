@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <SDL3/SDL.h>
+
+namespace App {
+  struct FrameArenaStats {
+    Uint32 bytesUsed = 0;
+    Uint32 allocations = 0;
+    // blocks that had to come from the heap because the frame outgrew its buffer
+    Uint32 overflowBlocks = 0;
+    // every operator new on any thread, arena or not
+    Uint32 heapAllocations = 0;
+  };
+  // bump allocator for data that only lives until the frame is submitted.
+  // one buffer per frame in flight, a buffer is rewound when its frame comes
+  // around again. a frame that overflows gets extra blocks, merged into one
+  // bigger buffer on rewind so steady state never touches the heap.
+  // main thread only, jobs can fill memory allocated before they start
+  class FrameArena {
+  public:
+    static const Uint32 FRAMES_IN_FLIGHT = 2;
+    static const Uint32 DEFAULT_CAPACITY = 256 * 1024;
+    FrameArena(Uint32 capacity);
+    ~FrameArena();
+    void* alloc(size_t size, size_t align = alignof(std::max_align_t));
+    template<typename T>
+    T* allocArray(size_t count) {
+      return static_cast<T*>(alloc(sizeof(T) * count, alignof(T)));
+    }
+    // for plain descriptor structs, nothing allocated here is ever destructed
+    template<typename T>
+    T* make(T const &value) {
+      return new (alloc(sizeof(T), alignof(T))) T(value);
+    }
+    // rewind the oldest buffer for the next frame
+    void endFrame();
+    FrameArenaStats const &frameStats() const { return lastStats; }
+  private:
+    struct Block {
+      Uint8 *data;
+      size_t size;
+      size_t used;
+    };
+    struct Frame {
+      std::vector<Block> blocks;
+    };
+    Frame frames[FRAMES_IN_FLIGHT];
+    Uint32 current = 0;
+    Uint32 heapAtFrameStart = 0;
+    FrameArenaStats stats;
+    FrameArenaStats lastStats;
+  };
+  // std allocator adapter, deallocate is a no-op since the arena rewinds as a whole
+  template<typename T>
+  struct FrameAllocator {
+    typedef T value_type;
+    FrameArena *arena;
+    FrameAllocator(FrameArena *arena) : arena(arena) {}
+    template<typename U>
+    FrameAllocator(FrameAllocator<U> const &other) : arena(other.arena) {}
+    T* allocate(size_t n) { return arena->allocArray<T>(n); }
+    void deallocate(T *p, size_t n) {}
+    template<typename U>
+    bool operator==(FrameAllocator<U> const &other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(FrameAllocator<U> const &other) const { return arena != other.arena; }
+  };
+  template<typename T>
+  using FrameVector = std::vector<T, FrameAllocator<T>>;
+  FrameArena* getFrameArena();
+  void destroyFrameArena();
+  // running count of global operator new calls, for checking steady state
+  Uint32 heapAllocationCount();
+}
@@ -0,0 +1,175 @@
+#include "framePacer.hpp"
+#include "gpuBackend.hpp"
+#include "profiler.hpp"
+
+using namespace App;
+
+static const char* presentModeName(SDL_GPUPresentMode mode) {
+  switch (mode) {
+    case SDL_GPU_PRESENTMODE_IMMEDIATE: return "immediate";
+    case SDL_GPU_PRESENTMODE_MAILBOX: return "mailbox";
+    default: return "vsync";
+  }
+}
+
+static const char* paceModeName(PaceMode mode) {
+  switch (mode) {
+    case PACE_Uncapped: return "Uncapped";
+    case PACE_Fixed: return "Fixed";
+    case PACE_Adaptive: return "Adaptive";
+    default: return "VSync";
+  }
+}
+
+static void smoothInto(Uint64 &avg, Uint64 value) {
+  avg = avg - avg / 8 + value / 8;
+}
+
+FramePacer::FramePacer(SDL_GPUDevice *gpu, SDL_Window *win) {
+  device = gpu;
+  window = win;
+  setMode(mode);
+}
+
+float FramePacer::displayRate() const {
+  SDL_DisplayMode const *display = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+  if (display == NULL || display->refresh_rate <= 0.0f) return 60.0f;
+  return display->refresh_rate;
+}
+
+// falls back towards vsync, which every swapchain supports
+void FramePacer::applyPresentMode(SDL_GPUPresentMode preferred) {
+  SDL_GPUPresentMode order[3] = { preferred, SDL_GPU_PRESENTMODE_MAILBOX, SDL_GPU_PRESENTMODE_VSYNC };
+  if (preferred == SDL_GPU_PRESENTMODE_MAILBOX) order[1] = SDL_GPU_PRESENTMODE_IMMEDIATE;
+  for (SDL_GPUPresentMode m : order) {
+    if (m != SDL_GPU_PRESENTMODE_VSYNC && !getGPUBackend()->windowSupportsPresentMode(device, window, m)) continue;
+    if (m == presentMode) return;
+    if (getGPUBackend()->setSwapchainParameters(device, window, SDL_GPU_SWAPCHAINCOMPOSITION_SDR, m)) {
+      presentMode = m;
+      return;
+    }
+    SDL_Log("ERR: Failed to set present mode %s - %s", presentModeName(m), SDL_GetError());
+  }
+}
+
+// targetFps <= 0 follows the display refresh rate
+void FramePacer::setMode(PaceMode newMode, float fps) {
+  mode = newMode;
+  targetFps = fps > 0.0f ? fps : displayRate();
+  missed = 0;
+  fitted = 0;
+  switch (mode) {
+    case PACE_Uncapped:
+      applyPresentMode(SDL_GPU_PRESENTMODE_IMMEDIATE);
+      break;
+    case PACE_Fixed:
+      // mailbox never blocks the pacer and still doesn't tear
+      applyPresentMode(SDL_GPU_PRESENTMODE_MAILBOX);
+      break;
+    default:
+      applyPresentMode(SDL_GPU_PRESENTMODE_VSYNC);
+      break;
+  }
+  SDL_Log("Frame pacing: %s at %.1f fps (%s)", paceModeName(mode), targetFps, presentModeName(presentMode));
+}
+
+void FramePacer::cycleMode() {
+  setMode((PaceMode)((mode + 1) % (PACE_Adaptive + 1)));
+}
+
+// sleep most of the way, then spin the last stretch since sleeps wake up late
+void FramePacer::sleepUntil(Uint64 target) {
+  Uint64 now = SDL_GetTicksNS();
+  if (target > now + spinMarginNS) {
+    Uint64 want = target - now - spinMarginNS;
+    SDL_DelayNS(want);
+    Uint64 woke = SDL_GetTicksNS();
+    current.sleepNS += woke - now;
+    // keep the margin just above the recent oversleep, grow fast and shrink slowly
+    Uint64 late = woke - now > want ? woke - now - want : 0;
+    Uint64 margin = late + late / 4 + 100000;
+    if (margin > spinMarginNS) spinMarginNS = margin;
+    else spinMarginNS -= (spinMarginNS - margin) / 16;
+    spinMarginNS = SDL_clamp(spinMarginNS, 200000, 4000000);
+    now = woke;
+  }
+  Uint64 spinStart = now;
+  while (now < target) {
+    SDL_CPUPauseInstruction();
+    now = SDL_GetTicksNS();
+  }
+  current.spinNS += now - spinStart;
+}
+
+Uint64 FramePacer::beginFrame() {
+  PROFILE_ZONE("FramePacer::beginFrame");
+  Uint64 now = SDL_GetTicksNS();
+  if (frameStart != 0) current.workNS = now - frameStart - SDL_min(current.syncNS, now - frameStart);
+
+  if (mode == PACE_Adaptive && frameStart != 0) {
+    // stalling a late frame to the next vblank halves the rate, tear instead
+    Uint64 refresh = (Uint64)(SDL_NS_PER_SECOND / displayRate());
+    if (current.workNS > refresh - refresh / 10) {
+      missed++;
+      fitted = 0;
+    } else {
+      fitted++;
+      missed = 0;
+    }
+    if (presentMode == SDL_GPU_PRESENTMODE_VSYNC && missed >= 3) {
+      applyPresentMode(SDL_GPU_PRESENTMODE_IMMEDIATE);
+    } else if (presentMode != SDL_GPU_PRESENTMODE_VSYNC && fitted >= 30) {
+      applyPresentMode(SDL_GPU_PRESENTMODE_VSYNC);
+    }
+  }
+
+  // vsync'd frames are paced by the swapchain, the rest by the clock
+  if (mode == PACE_Fixed || (mode == PACE_Adaptive && presentMode != SDL_GPU_PRESENTMODE_VSYNC)) {
+    Uint64 period = (Uint64)(SDL_NS_PER_SECOND / targetFps);
+    deadline += period;
+    // too far behind (or first frame), start over instead of rushing to catch up
+    if (deadline + period < now || deadline > now + period) deadline = now;
+    sleepUntil(deadline);
+  }
+
+  Uint64 start = SDL_GetTicksNS();
+  Uint64 delta = frameStart != 0 ? start - frameStart : 0;
+  if (frameStart != 0) {
+    current.frameNS = delta;
+    last = current;
+    smoothInto(smooth.frameNS, last.frameNS);
+    smoothInto(smooth.workNS, last.workNS);
+    smoothInto(smooth.sleepNS, last.sleepNS);
+    smoothInto(smooth.spinNS, last.spinNS);
+    smoothInto(smooth.syncNS, last.syncNS);
+  }
+  current = FramePaceStats {};
+  frameStart = start;
+  return delta;
+}
+
+bool FramePacer::acquireSwapchain(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture **swapchain) {
+  PROFILE_ZONE("FramePacer::acquireSwapchain");
+  Uint64 t0 = SDL_GetTicksNS();
+  bool acquired = getGPUBackend()->waitAndAcquireSwapchainTexture(cmdBuf, window, swapchain, NULL, NULL);
+  current.syncNS += SDL_GetTicksNS() - t0;
+  // a NULL texture only means the window is minimized or occluded
+  if (!acquired) SDL_Log("ERR: Failed to acquire swapchain texture - %s", SDL_GetError());
+  return acquired && *swapchain != NULL;
+}
+
+void FramePacer::skipFrame() {
+  Uint64 t0 = SDL_GetTicksNS();
+  SDL_DelayNS((Uint64)(SDL_NS_PER_SECOND / displayRate()));
+  current.sleepNS += SDL_GetTicksNS() - t0;
+}
+
+std::string FramePacer::info() const {
+  char str[160];
+  SDL_snprintf(
+    str, sizeof(str), "%s %.0f (%s): work %.2f ms, sync %.2f ms, sleep %.2f ms, spin %.2f ms",
+    paceModeName(mode), targetFps, presentModeName(presentMode),
+    smooth.workNS / 1e6, smooth.syncNS / 1e6, smooth.sleepNS / 1e6, smooth.spinNS / 1e6
+  );
+  return str;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <SDL3/SDL.h>
+
+namespace App {
+  enum PaceMode {
+    PACE_Uncapped, // as fast as the gpu allows, no vsync
+    PACE_Fixed,    // sleep + spin-tail to a target rate, no vsync
+    PACE_VSync,    // blocked by the swapchain at the display rate
+    PACE_Adaptive  // vsync while frames fit the refresh period, tear instead of stalling when they don't
+  };
+  struct FramePaceStats {
+    Uint64 frameNS = 0;
+    Uint64 workNS = 0;
+    Uint64 sleepNS = 0;
+    Uint64 spinNS = 0;
+    // blocked in swapchain acquire
+    Uint64 syncNS = 0;
+  };
+  class FramePacer {
+  public:
+    FramePacer(SDL_GPUDevice *gpu, SDL_Window *win);
+    void setMode(PaceMode mode, float targetFps = 0.0f);
+    void cycleMode();
+    // waits until the next frame is due, returns ns since the previous frame started
+    Uint64 beginFrame();
+    // acquire the swapchain, time spent blocked counts as sync rather than work
+    bool acquireSwapchain(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture **swapchain);
+    // nothing to present (minimized window), wait a refresh period instead of spinning
+    void skipFrame();
+    std::string info() const;
+    PaceMode mode = PACE_VSync;
+    float targetFps = 60.0f;
+    FramePaceStats last;
+    // exponential average of recent frames for display
+    FramePaceStats smooth;
+  private:
+    void applyPresentMode(SDL_GPUPresentMode preferred);
+    void sleepUntil(Uint64 deadline);
+    float displayRate() const;
+    SDL_GPUDevice *device = NULL;
+    SDL_Window *window = NULL;
+    SDL_GPUPresentMode presentMode = SDL_GPU_PRESENTMODE_VSYNC;
+    Uint64 frameStart = 0;
+    Uint64 deadline = 0;
+    // margin left for spinning, follows how late sleeps wake up
+    Uint64 spinMarginNS = 2000000;
+    FramePaceStats current;
+    // adaptive: consecutive frames that missed / fit the refresh period
+    Uint32 missed = 0;
+    Uint32 fitted = 0;
+  };
+}
@@ -0,0 +1,222 @@
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "frustum.hpp"
+
+using namespace App;
+
+Frustum App::extractFrustum(glm::mat4x4 const &m) {
+  glm::vec4 row[4];
+  for (int i=0; i < 4; i++) row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+  Frustum f = { {
+    row[3] + row[0], row[3] - row[0], // left, right
+    row[3] + row[1], row[3] - row[1], // bottom, top
+    row[3] + row[2], row[3] - row[2], // near, far
+  } };
+  // normalized so plane distances come out in world units
+  for (glm::vec4 &p : f.planes) {
+    float len = glm::length(glm::vec3(p));
+    if (len > 0.0f) p /= len;
+  }
+  return f;
+}
+
+void FrustumCuller::resize(Uint32 count) {
+  for (std::vector<float> *a : { &cx, &cy, &cz, &radius, &ex, &ey, &ez }) a->resize(count);
+}
+
+void FrustumCuller::set(Uint32 i, glm::vec3 center, float r, glm::vec3 extents) {
+  cx[i] = center.x;
+  cy[i] = center.y;
+  cz[i] = center.z;
+  radius[i] = r;
+  ex[i] = extents.x;
+  ey[i] = extents.y;
+  ez[i] = extents.z;
+}
+
+#pragma region Kernels
+
+struct CullArrays {
+  float const *cx, *cy, *cz, *radius, *ex, *ey, *ez;
+};
+
+static Uint32 cullScalar(CullArrays const &a, Frustum const &frustum, Uint8 *visible, Uint32 begin, Uint32 count) {
+  Uint32 inside = 0;
+  for (Uint32 i=begin; i < count; i++) {
+    bool outside = false;
+    for (glm::vec4 const &p : frustum.planes) {
+      float dist = p.x * a.cx[i] + p.y * a.cy[i] + p.z * a.cz[i] + p.w;
+      float boxReach = SDL_fabsf(p.x) * a.ex[i] + SDL_fabsf(p.y) * a.ey[i] + SDL_fabsf(p.z) * a.ez[i];
+      outside = outside || dist < -SDL_min(a.radius[i], boxReach);
+    }
+    visible[i] = outside ? 0 : 1;
+    inside += visible[i];
+  }
+  return inside;
+}
+
+#ifdef SDL_SSE2_INTRINSICS
+
+// four objects per step against all six planes
+static SDL_TARGETING("sse2") Uint32 cullBlocksSSE(
+  CullArrays const &a, Frustum const &frustum, Uint8 *visible, Uint32 count, Uint32 &inside
+) {
+  __m128 sign = _mm_set1_ps(-0.0f);
+  Uint32 i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(a.cx + i);
+    __m128 y = _mm_loadu_ps(a.cy + i);
+    __m128 z = _mm_loadu_ps(a.cz + i);
+    __m128 r = _mm_loadu_ps(a.radius + i);
+    __m128 ex = _mm_loadu_ps(a.ex + i);
+    __m128 ey = _mm_loadu_ps(a.ey + i);
+    __m128 ez = _mm_loadu_ps(a.ez + i);
+    __m128 outside = _mm_setzero_ps();
+    for (glm::vec4 const &p : frustum.planes) {
+      __m128 dist = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), x), _mm_mul_ps(_mm_set1_ps(p.y), y)),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), z), _mm_set1_ps(p.w))
+      );
+      __m128 boxReach = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SDL_fabsf(p.x)), ex), _mm_mul_ps(_mm_set1_ps(SDL_fabsf(p.y)), ey)),
+        _mm_mul_ps(_mm_set1_ps(SDL_fabsf(p.z)), ez)
+      );
+      __m128 reach = _mm_xor_ps(_mm_min_ps(r, boxReach), sign);
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, reach));
+    }
+    int mask = _mm_movemask_ps(outside);
+    for (int k=0; k < 4; k++) {
+      visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+      inside += visible[i + k];
+    }
+  }
+  return i;
+}
+
+#endif
+
+#pragma endregion Kernels
+
+Uint32 FrustumCuller::cull(Frustum const &frustum, Uint8 *visible) const {
+  CullArrays arrays = { cx.data(), cy.data(), cz.data(), radius.data(), ex.data(), ey.data(), ez.data() };
+  Uint32 count = cx.size();
+  Uint32 inside = 0;
+  Uint32 done = 0;
+#ifdef SDL_SSE2_INTRINSICS
+  if (SDL_HasSSE2()) done = cullBlocksSSE(arrays, frustum, visible, count, inside);
+#endif
+  // remaining objects
+  return inside + cullScalar(arrays, frustum, visible, done, count);
+}
+
+#pragma region Validation
+
+// plane vs box through the eight corners, independent of the kernels' reach
+// formulation. margin is how close the deciding corner came to a plane
+static bool boxOutside(Frustum const &frustum, glm::vec3 center, glm::vec3 extents, float &margin) {
+  bool outside = false;
+  margin = 1e30f;
+  for (glm::vec4 const &p : frustum.planes) {
+    float farthest = -1e30f;
+    for (int c=0; c < 8; c++) {
+      glm::vec3 corner = center + glm::vec3(
+        c & 1 ? extents.x : -extents.x, c & 2 ? extents.y : -extents.y, c & 4 ? extents.z : -extents.z
+      );
+      farthest = SDL_max(farthest, glm::dot(glm::vec3(p), corner) + p.w);
+    }
+    margin = SDL_min(margin, SDL_fabsf(farthest));
+    outside = outside || farthest < 0.0f;
+  }
+  return outside;
+}
+
+bool App::validateFrustumCuller(Uint32 sampleCount) {
+  Uint32 failures = 0;
+
+  // boxes with an obvious answer in a 90 degree frustum looking down -z
+  Frustum known = extractFrustum(
+    glm::perspective(SDL_PI_F / 2.0f, 1.0f, 1.0f, 100.0f) *
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+  );
+  struct KnownBox {
+    const char *name;
+    glm::vec3 center;
+    float extent;
+    Uint8 visible;
+  };
+  KnownBox const cases[] = {
+    { "inside", glm::vec3(0.0f, 0.0f, -50.0f), 1.0f, 1 },
+    { "behind the camera", glm::vec3(0.0f, 0.0f, 50.0f), 1.0f, 0 },
+    { "right of the frustum", glm::vec3(200.0f, 0.0f, -50.0f), 1.0f, 0 },
+    { "past the far plane", glm::vec3(0.0f, 0.0f, -200.0f), 1.0f, 0 },
+    { "straddling the right plane", glm::vec3(50.0f, 0.0f, -50.0f), 5.0f, 1 },
+    { "straddling the near plane", glm::vec3(0.0f, 0.0f, -1.0f), 2.0f, 1 },
+    { "straddling the far plane", glm::vec3(0.0f, 0.0f, -100.0f), 5.0f, 1 },
+  };
+  Uint32 caseCount = SDL_arraysize(cases);
+  FrustumCuller culler;
+  culler.resize(caseCount);
+  for (Uint32 i=0; i < caseCount; i++) {
+    glm::vec3 e = glm::vec3(cases[i].extent);
+    culler.set(i, cases[i].center, glm::length(e), e);
+  }
+  std::vector<Uint8> visible(caseCount);
+  culler.cull(known, visible.data());
+  for (Uint32 i=0; i < caseCount; i++) {
+    if (visible[i] == cases[i].visible) continue;
+    SDL_Log("ERR: Frustum culler: box %s came out %s", cases[i].name, visible[i] ? "visible" : "culled");
+    failures++;
+  }
+
+  // random boxes against a tilted camera. spheres enclose their boxes, so the
+  // kernels reduce to the box test. the count leaves a scalar tail after the
+  // sse blocks, near ties are skipped since the two sides round differently
+  Frustum frustum = extractFrustum(
+    glm::perspective(1.0f, 1.5f, 1.0f, 500.0f) *
+    glm::lookAt(glm::vec3(10.0f, 20.0f, 30.0f), glm::vec3(0.0f, 0.0f, -100.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+  );
+  Uint32 count = sampleCount - sampleCount % 4 + 3;
+  Uint64 seed = 1;
+  std::vector<glm::vec3> centers(count), extents(count);
+  culler.resize(count);
+  for (Uint32 i=0; i < count; i++) {
+    centers[i] = glm::vec3(
+      SDL_randf_r(&seed) * 600.0f - 300.0f, SDL_randf_r(&seed) * 600.0f - 300.0f, SDL_randf_r(&seed) * 700.0f - 600.0f
+    );
+    extents[i] = glm::vec3(
+      SDL_randf_r(&seed) * 40.0f + 0.1f, SDL_randf_r(&seed) * 40.0f + 0.1f, SDL_randf_r(&seed) * 40.0f + 0.1f
+    );
+    culler.set(i, centers[i], glm::length(extents[i]), extents[i]);
+  }
+  // cull() takes the sse path where it can, the scalar kernel is run over everything too
+  std::vector<Uint8> kernel(count), scalar(count);
+  culler.cull(frustum, kernel.data());
+  CullArrays arrays = {
+    culler.cx.data(), culler.cy.data(), culler.cz.data(), culler.radius.data(),
+    culler.ex.data(), culler.ey.data(), culler.ez.data()
+  };
+  cullScalar(arrays, frustum, scalar.data(), 0, count);
+  Uint32 checked = 0, culled = 0;
+  for (Uint32 i=0; i < count; i++) {
+    float margin;
+    Uint8 expected = boxOutside(frustum, centers[i], extents[i], margin) ? 0 : 1;
+    if (margin < 0.01f) continue;
+    checked++;
+    culled += 1 - expected;
+    if (kernel[i] == expected && scalar[i] == expected) continue;
+    if (failures < 8) {
+      SDL_Log(
+        "ERR: Frustum culler: box %d (%.1f, %.1f, %.1f) expected %s, kernel %d scalar %d",
+        i, centers[i].x, centers[i].y, centers[i].z, expected ? "visible" : "culled", kernel[i], scalar[i]
+      );
+    }
+    failures++;
+  }
+  SDL_Log(
+    "Frustum culler: %d known boxes, %d random boxes checked (%d culled), %d failures",
+    caseCount, checked, culled, failures
+  );
+  return failures == 0;
+}
+
+#pragma endregion Validation
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace App {
+  // world space planes as (normal, d), a point p is inside when dot(normal, p) + d >= 0
+  struct Frustum {
+    glm::vec4 planes[6];
+  };
+  // Gribb/Hartmann plane extraction. the near plane is taken at z = -w, which is
+  // conservative for both [-1, 1] and [0, 1] clip depth
+  Frustum extractFrustum(glm::mat4x4 const &viewProj);
+  // structure-of-arrays world bounds tested against a frustum in batches. each
+  // object has a sphere and an axis aligned box around the same center, a plane
+  // culls it when either lies fully behind it
+  class FrustumCuller {
+  public:
+    void resize(Uint32 count);
+    void set(Uint32 i, glm::vec3 center, float radius, glm::vec3 extents);
+    // visible[i] is 1 for objects at least partly inside, returns how many are
+    Uint32 cull(Frustum const &frustum, Uint8 *visible) const;
+    Uint32 size() const { return cx.size(); }
+  private:
+    friend bool validateFrustumCuller(Uint32 sampleCount);
+    std::vector<float> cx, cy, cz, radius, ex, ey, ez;
+  };
+  // headless check of both cull kernels against a brute force box test, plus
+  // boxes with a known answer. false on any mismatch
+  bool validateFrustumCuller(Uint32 sampleCount);
+}
@@ -0,0 +1,183 @@
+#include "gpuBackend.hpp"
+
+using namespace App;
+
+SDL_GPUBuffer* GPUBackend::createBuffer(SDL_GPUDevice *device, SDL_GPUBufferCreateInfo const *info) {
+  return SDL_CreateGPUBuffer(device, info);
+}
+
+void GPUBackend::releaseBuffer(SDL_GPUDevice *device, SDL_GPUBuffer *buffer) {
+  SDL_ReleaseGPUBuffer(device, buffer);
+}
+
+SDL_GPUTexture* GPUBackend::createTexture(SDL_GPUDevice *device, SDL_GPUTextureCreateInfo const *info) {
+  return SDL_CreateGPUTexture(device, info);
+}
+
+void GPUBackend::releaseTexture(SDL_GPUDevice *device, SDL_GPUTexture *texture) {
+  SDL_ReleaseGPUTexture(device, texture);
+}
+
+SDL_GPUSampler* GPUBackend::createSampler(SDL_GPUDevice *device, SDL_GPUSamplerCreateInfo const *info) {
+  return SDL_CreateGPUSampler(device, info);
+}
+
+void GPUBackend::releaseSampler(SDL_GPUDevice *device, SDL_GPUSampler *sampler) {
+  SDL_ReleaseGPUSampler(device, sampler);
+}
+
+SDL_GPUShader* GPUBackend::createShader(SDL_GPUDevice *device, SDL_GPUShaderCreateInfo const *info) {
+  return SDL_CreateGPUShader(device, info);
+}
+
+void GPUBackend::releaseShader(SDL_GPUDevice *device, SDL_GPUShader *shader) {
+  SDL_ReleaseGPUShader(device, shader);
+}
+
+SDL_GPUGraphicsPipeline* GPUBackend::createGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipelineCreateInfo const *info) {
+  return SDL_CreateGPUGraphicsPipeline(device, info);
+}
+
+void GPUBackend::releaseGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipeline *pipeline) {
+  SDL_ReleaseGPUGraphicsPipeline(device, pipeline);
+}
+
+SDL_GPUTransferBuffer* GPUBackend::createTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBufferCreateInfo const *info) {
+  return SDL_CreateGPUTransferBuffer(device, info);
+}
+
+void GPUBackend::releaseTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer) {
+  SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
+}
+
+void* GPUBackend::mapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer, bool cycle) {
+  return SDL_MapGPUTransferBuffer(device, transferBuffer, cycle);
+}
+
+void GPUBackend::unmapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer) {
+  SDL_UnmapGPUTransferBuffer(device, transferBuffer);
+}
+
+SDL_GPUShaderFormat GPUBackend::getShaderFormats(SDL_GPUDevice *device) {
+  return SDL_GetGPUShaderFormats(device);
+}
+
+bool GPUBackend::waitForIdle(SDL_GPUDevice *device) {
+  return SDL_WaitForGPUIdle(device);
+}
+
+bool GPUBackend::waitForFences(SDL_GPUDevice *device, bool waitAll, SDL_GPUFence *const *fences, Uint32 numFences) {
+  return SDL_WaitForGPUFences(device, waitAll, fences, numFences);
+}
+
+bool GPUBackend::queryFence(SDL_GPUDevice *device, SDL_GPUFence *fence) {
+  return SDL_QueryGPUFence(device, fence);
+}
+
+void GPUBackend::releaseFence(SDL_GPUDevice *device, SDL_GPUFence *fence) {
+  SDL_ReleaseGPUFence(device, fence);
+}
+
+bool GPUBackend::windowSupportsPresentMode(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUPresentMode mode) {
+  return SDL_WindowSupportsGPUPresentMode(device, window, mode);
+}
+
+bool GPUBackend::setSwapchainParameters(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUSwapchainComposition composition, SDL_GPUPresentMode mode) {
+  return SDL_SetGPUSwapchainParameters(device, window, composition, mode);
+}
+
+SDL_GPUTextureFormat GPUBackend::getSwapchainTextureFormat(SDL_GPUDevice *device, SDL_Window *window) {
+  return SDL_GetGPUSwapchainTextureFormat(device, window);
+}
+
+SDL_GPUCommandBuffer* GPUBackend::acquireCommandBuffer(SDL_GPUDevice *device) {
+  return SDL_AcquireGPUCommandBuffer(device);
+}
+
+void GPUBackend::insertDebugLabel(SDL_GPUCommandBuffer *cmdBuf, const char *text) {
+  SDL_InsertGPUDebugLabel(cmdBuf, text);
+}
+
+void GPUBackend::pushVertexUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length) {
+  SDL_PushGPUVertexUniformData(cmdBuf, slot, data, length);
+}
+
+void GPUBackend::pushFragmentUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length) {
+  SDL_PushGPUFragmentUniformData(cmdBuf, slot, data, length);
+}
+
+bool GPUBackend::waitAndAcquireSwapchainTexture(SDL_GPUCommandBuffer *cmdBuf, SDL_Window *window, SDL_GPUTexture **texture, Uint32 *w, Uint32 *h) {
+  return SDL_WaitAndAcquireGPUSwapchainTexture(cmdBuf, window, texture, w, h);
+}
+
+SDL_GPUFence* GPUBackend::submitCommandBufferAndAcquireFence(SDL_GPUCommandBuffer *cmdBuf) {
+  return SDL_SubmitGPUCommandBufferAndAcquireFence(cmdBuf);
+}
+
+bool GPUBackend::cancelCommandBuffer(SDL_GPUCommandBuffer *cmdBuf) {
+  return SDL_CancelGPUCommandBuffer(cmdBuf);
+}
+
+SDL_GPUCopyPass* GPUBackend::beginCopyPass(SDL_GPUCommandBuffer *cmdBuf) {
+  return SDL_BeginGPUCopyPass(cmdBuf);
+}
+
+void GPUBackend::uploadToBuffer(SDL_GPUCopyPass *copyPass, SDL_GPUTransferBufferLocation const *source, SDL_GPUBufferRegion const *destination, bool cycle) {
+  SDL_UploadToGPUBuffer(copyPass, source, destination, cycle);
+}
+
+void GPUBackend::endCopyPass(SDL_GPUCopyPass *copyPass) {
+  SDL_EndGPUCopyPass(copyPass);
+}
+
+SDL_GPURenderPass* GPUBackend::beginRenderPass(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUColorTargetInfo const *colorTargets, Uint32 numColorTargets, SDL_GPUDepthStencilTargetInfo const *depthTarget) {
+  return SDL_BeginGPURenderPass(cmdBuf, colorTargets, numColorTargets, depthTarget);
+}
+
+void GPUBackend::bindGraphicsPipeline(SDL_GPURenderPass *pass, SDL_GPUGraphicsPipeline *pipeline) {
+  SDL_BindGPUGraphicsPipeline(pass, pipeline);
+}
+
+void GPUBackend::bindVertexBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBufferBinding const *bindings, Uint32 numBindings) {
+  SDL_BindGPUVertexBuffers(pass, firstSlot, bindings, numBindings);
+}
+
+void GPUBackend::bindIndexBuffer(SDL_GPURenderPass *pass, SDL_GPUBufferBinding const *binding, SDL_GPUIndexElementSize elementSize) {
+  SDL_BindGPUIndexBuffer(pass, binding, elementSize);
+}
+
+void GPUBackend::bindVertexStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers) {
+  SDL_BindGPUVertexStorageBuffers(pass, firstSlot, buffers, numBuffers);
+}
+
+void GPUBackend::bindFragmentStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers) {
+  SDL_BindGPUFragmentStorageBuffers(pass, firstSlot, buffers, numBuffers);
+}
+
+void GPUBackend::bindFragmentSamplers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUTextureSamplerBinding const *bindings, Uint32 numBindings) {
+  SDL_BindGPUFragmentSamplers(pass, firstSlot, bindings, numBindings);
+}
+
+void GPUBackend::drawPrimitives(SDL_GPURenderPass *pass, Uint32 numVertices, Uint32 numInstances, Uint32 firstVertex, Uint32 firstInstance) {
+  SDL_DrawGPUPrimitives(pass, numVertices, numInstances, firstVertex, firstInstance);
+}
+
+void GPUBackend::drawIndexedPrimitives(SDL_GPURenderPass *pass, Uint32 numIndices, Uint32 numInstances, Uint32 firstIndex, Sint32 vertexOffset, Uint32 firstInstance) {
+  SDL_DrawGPUIndexedPrimitives(pass, numIndices, numInstances, firstIndex, vertexOffset, firstInstance);
+}
+
+void GPUBackend::endRenderPass(SDL_GPURenderPass *pass) {
+  SDL_EndGPURenderPass(pass);
+}
+
+static GPUBackend sdlBackend;
+static GPUBackend *activeBackend = &sdlBackend;
+
+GPUBackend* App::getGPUBackend() {
+  return activeBackend;
+}
+
+// swap before any pipeline is created, resources don't move between backends
+void App::setGPUBackend(GPUBackend *backend) {
+  activeBackend = backend != NULL ? backend : &sdlBackend;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+namespace App {
+  // the SDL_GPU calls made by the pipelines, routed through the active backend.
+  // the base class forwards straight to SDL, RecordingGPUBackend overrides
+  // everything to run headless
+  class GPUBackend {
+  public:
+    virtual ~GPUBackend() {}
+    // resources
+    virtual SDL_GPUBuffer* createBuffer(SDL_GPUDevice *device, SDL_GPUBufferCreateInfo const *info);
+    virtual void releaseBuffer(SDL_GPUDevice *device, SDL_GPUBuffer *buffer);
+    virtual SDL_GPUTexture* createTexture(SDL_GPUDevice *device, SDL_GPUTextureCreateInfo const *info);
+    virtual void releaseTexture(SDL_GPUDevice *device, SDL_GPUTexture *texture);
+    virtual SDL_GPUSampler* createSampler(SDL_GPUDevice *device, SDL_GPUSamplerCreateInfo const *info);
+    virtual void releaseSampler(SDL_GPUDevice *device, SDL_GPUSampler *sampler);
+    virtual SDL_GPUShader* createShader(SDL_GPUDevice *device, SDL_GPUShaderCreateInfo const *info);
+    virtual void releaseShader(SDL_GPUDevice *device, SDL_GPUShader *shader);
+    virtual SDL_GPUGraphicsPipeline* createGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipelineCreateInfo const *info);
+    virtual void releaseGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipeline *pipeline);
+    virtual SDL_GPUTransferBuffer* createTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBufferCreateInfo const *info);
+    virtual void releaseTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer);
+    virtual void* mapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer, bool cycle);
+    virtual void unmapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer);
+    // device
+    virtual SDL_GPUShaderFormat getShaderFormats(SDL_GPUDevice *device);
+    virtual bool waitForIdle(SDL_GPUDevice *device);
+    virtual bool waitForFences(SDL_GPUDevice *device, bool waitAll, SDL_GPUFence *const *fences, Uint32 numFences);
+    virtual bool queryFence(SDL_GPUDevice *device, SDL_GPUFence *fence);
+    virtual void releaseFence(SDL_GPUDevice *device, SDL_GPUFence *fence);
+    virtual bool windowSupportsPresentMode(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUPresentMode mode);
+    virtual bool setSwapchainParameters(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUSwapchainComposition composition, SDL_GPUPresentMode mode);
+    virtual SDL_GPUTextureFormat getSwapchainTextureFormat(SDL_GPUDevice *device, SDL_Window *window);
+    // command buffers
+    virtual SDL_GPUCommandBuffer* acquireCommandBuffer(SDL_GPUDevice *device);
+    virtual void insertDebugLabel(SDL_GPUCommandBuffer *cmdBuf, const char *text);
+    virtual void pushVertexUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length);
+    virtual void pushFragmentUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length);
+    virtual bool waitAndAcquireSwapchainTexture(SDL_GPUCommandBuffer *cmdBuf, SDL_Window *window, SDL_GPUTexture **texture, Uint32 *w, Uint32 *h);
+    virtual SDL_GPUFence* submitCommandBufferAndAcquireFence(SDL_GPUCommandBuffer *cmdBuf);
+    virtual bool cancelCommandBuffer(SDL_GPUCommandBuffer *cmdBuf);
+    // copy passes
+    virtual SDL_GPUCopyPass* beginCopyPass(SDL_GPUCommandBuffer *cmdBuf);
+    virtual void uploadToBuffer(SDL_GPUCopyPass *copyPass, SDL_GPUTransferBufferLocation const *source, SDL_GPUBufferRegion const *destination, bool cycle);
+    virtual void endCopyPass(SDL_GPUCopyPass *copyPass);
+    // render passes
+    virtual SDL_GPURenderPass* beginRenderPass(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUColorTargetInfo const *colorTargets, Uint32 numColorTargets, SDL_GPUDepthStencilTargetInfo const *depthTarget);
+    virtual void bindGraphicsPipeline(SDL_GPURenderPass *pass, SDL_GPUGraphicsPipeline *pipeline);
+    virtual void bindVertexBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBufferBinding const *bindings, Uint32 numBindings);
+    virtual void bindIndexBuffer(SDL_GPURenderPass *pass, SDL_GPUBufferBinding const *binding, SDL_GPUIndexElementSize elementSize);
+    virtual void bindVertexStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers);
+    virtual void bindFragmentStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers);
+    virtual void bindFragmentSamplers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUTextureSamplerBinding const *bindings, Uint32 numBindings);
+    virtual void drawPrimitives(SDL_GPURenderPass *pass, Uint32 numVertices, Uint32 numInstances, Uint32 firstVertex, Uint32 firstInstance);
+    virtual void drawIndexedPrimitives(SDL_GPURenderPass *pass, Uint32 numIndices, Uint32 numInstances, Uint32 firstIndex, Sint32 vertexOffset, Uint32 firstInstance);
+    virtual void endRenderPass(SDL_GPURenderPass *pass);
+  };
+  GPUBackend* getGPUBackend();
+  // NULL goes back to the SDL backend, the caller keeps ownership
+  void setGPUBackend(GPUBackend *backend);
+}
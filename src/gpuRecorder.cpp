@@ -0,0 +1,356 @@
+#include "gpuRecorder.hpp"
+
+using namespace App;
+
+template<typename T>
+static T* fakeHandle(Uint64 handle) {
+  return reinterpret_cast<T*>((uintptr_t)handle);
+}
+
+static Uint64 handleOf(void const *handle) {
+  return (Uint64)(uintptr_t)handle;
+}
+
+RecordingGPUBackend::RecordingGPUBackend(Uint32 w, Uint32 h) {
+  swapchainW = w;
+  swapchainH = h;
+  fakeDevice = fakeHandle<SDL_GPUDevice>(nextHandle);
+  nextHandle += 16;
+  swapchainTx = fakeHandle<SDL_GPUTexture>(nextHandle);
+  nextHandle += 16;
+}
+
+const char* RecordingGPUBackend::commandName(GPUCommandType type) {
+  switch (type) {
+    case GCMD_CreateBuffer: return "CreateBuffer";
+    case GCMD_ReleaseBuffer: return "ReleaseBuffer";
+    case GCMD_CreateTexture: return "CreateTexture";
+    case GCMD_ReleaseTexture: return "ReleaseTexture";
+    case GCMD_CreateSampler: return "CreateSampler";
+    case GCMD_ReleaseSampler: return "ReleaseSampler";
+    case GCMD_CreateShader: return "CreateShader";
+    case GCMD_ReleaseShader: return "ReleaseShader";
+    case GCMD_CreatePipeline: return "CreatePipeline";
+    case GCMD_ReleasePipeline: return "ReleasePipeline";
+    case GCMD_CreateTransferBuffer: return "CreateTransferBuffer";
+    case GCMD_ReleaseTransferBuffer: return "ReleaseTransferBuffer";
+    case GCMD_BeginCopyPass: return "BeginCopyPass";
+    case GCMD_Upload: return "Upload";
+    case GCMD_EndCopyPass: return "EndCopyPass";
+    case GCMD_BeginRenderPass: return "BeginRenderPass";
+    case GCMD_BindPipeline: return "BindPipeline";
+    case GCMD_BindVertexBuffers: return "BindVertexBuffers";
+    case GCMD_BindIndexBuffer: return "BindIndexBuffer";
+    case GCMD_BindStorageBuffers: return "BindStorageBuffers";
+    case GCMD_BindSamplers: return "BindSamplers";
+    case GCMD_PushUniforms: return "PushUniforms";
+    case GCMD_Draw: return "Draw";
+    case GCMD_DrawIndexed: return "DrawIndexed";
+    case GCMD_EndRenderPass: return "EndRenderPass";
+    case GCMD_DebugLabel: return "DebugLabel";
+    case GCMD_Submit: return "Submit";
+    case GCMD_Cancel: return "Cancel";
+  }
+  return "Unknown";
+}
+
+void RecordingGPUBackend::record(GPUCommandType type, void const *handle, Uint32 count, Uint32 instances, Uint32 bytes) {
+  if (!recordCommands) return;
+  commands.push_back(GPUCommand { type, handleOf(handle), count, instances, bytes });
+}
+
+Uint64 RecordingGPUBackend::create(GPUCommandType type, Uint32 size) {
+  Uint64 handle = nextHandle;
+  nextHandle += 16;
+  live[handle] = Resource { type, size };
+  stats.resourcesCreated++;
+  record(type, fakeHandle<void>(handle), 0, 0, size);
+  return handle;
+}
+
+// catches releases of handles this backend never handed out, or released twice
+void RecordingGPUBackend::release(GPUCommandType type, void const *handle) {
+  if (handle == NULL) return;
+  auto it = live.find(handleOf(handle));
+  if (it == live.end()) {
+    SDL_Log("ERR: %s of unknown handle %llx", commandName(type), (unsigned long long)handleOf(handle));
+    stats.errors++;
+    return;
+  }
+  live.erase(it);
+  record(type, handle);
+}
+
+void RecordingGPUBackend::reset() {
+  commands.clear();
+  stats = GPURecordStats {};
+}
+
+void RecordingGPUBackend::logStats(const char *label) const {
+  SDL_Log(
+    "%s: %d submits, %d render passes, %d draws (%llu instances), %d binds (%d pipeline, %d buffer, %d sampler), "
+    "%d uniform pushes (%llu B), %d uploads (%.1f KB), %d resources created, %d live, %d errors",
+    label, stats.submits, stats.renderPasses, stats.drawCalls, (unsigned long long)stats.instances,
+    stats.binds(), stats.pipelineBinds, stats.bufferBinds, stats.samplerBinds,
+    stats.uniformPushes, (unsigned long long)stats.uniformBytes, stats.uploads, stats.uploadBytes / 1024.0f,
+    stats.resourcesCreated, (int)live.size(), stats.errors
+  );
+}
+
+void RecordingGPUBackend::dump(Uint32 maxCommands) const {
+  Uint32 count = SDL_min((Uint32)commands.size(), maxCommands);
+  for (Uint32 i=0; i < count; i++) {
+    GPUCommand const &c = commands[i];
+    SDL_Log(
+      "%5d %-22s %8llx count %d instances %d bytes %d",
+      i, commandName(c.type), (unsigned long long)c.handle, c.count, c.instances, c.bytes
+    );
+  }
+  if (count < commands.size()) SDL_Log("... %d more commands", (int)(commands.size() - count));
+}
+
+#pragma region Resources
+
+SDL_GPUBuffer* RecordingGPUBackend::createBuffer(SDL_GPUDevice *device, SDL_GPUBufferCreateInfo const *info) {
+  stats.bufferBytesCreated += info->size;
+  return fakeHandle<SDL_GPUBuffer>(create(GCMD_CreateBuffer, info->size));
+}
+
+void RecordingGPUBackend::releaseBuffer(SDL_GPUDevice *device, SDL_GPUBuffer *buffer) {
+  release(GCMD_ReleaseBuffer, buffer);
+}
+
+SDL_GPUTexture* RecordingGPUBackend::createTexture(SDL_GPUDevice *device, SDL_GPUTextureCreateInfo const *info) {
+  return fakeHandle<SDL_GPUTexture>(create(GCMD_CreateTexture, info->width * info->height));
+}
+
+void RecordingGPUBackend::releaseTexture(SDL_GPUDevice *device, SDL_GPUTexture *texture) {
+  release(GCMD_ReleaseTexture, texture);
+}
+
+SDL_GPUSampler* RecordingGPUBackend::createSampler(SDL_GPUDevice *device, SDL_GPUSamplerCreateInfo const *info) {
+  return fakeHandle<SDL_GPUSampler>(create(GCMD_CreateSampler, 0));
+}
+
+void RecordingGPUBackend::releaseSampler(SDL_GPUDevice *device, SDL_GPUSampler *sampler) {
+  release(GCMD_ReleaseSampler, sampler);
+}
+
+SDL_GPUShader* RecordingGPUBackend::createShader(SDL_GPUDevice *device, SDL_GPUShaderCreateInfo const *info) {
+  return fakeHandle<SDL_GPUShader>(create(GCMD_CreateShader, info->code_size));
+}
+
+void RecordingGPUBackend::releaseShader(SDL_GPUDevice *device, SDL_GPUShader *shader) {
+  release(GCMD_ReleaseShader, shader);
+}
+
+SDL_GPUGraphicsPipeline* RecordingGPUBackend::createGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipelineCreateInfo const *info) {
+  return fakeHandle<SDL_GPUGraphicsPipeline>(create(GCMD_CreatePipeline, 0));
+}
+
+void RecordingGPUBackend::releaseGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipeline *pipeline) {
+  release(GCMD_ReleasePipeline, pipeline);
+}
+
+SDL_GPUTransferBuffer* RecordingGPUBackend::createTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBufferCreateInfo const *info) {
+  Uint64 handle = create(GCMD_CreateTransferBuffer, info->size);
+  transferMemory[handle].resize(info->size);
+  return fakeHandle<SDL_GPUTransferBuffer>(handle);
+}
+
+void RecordingGPUBackend::releaseTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer) {
+  release(GCMD_ReleaseTransferBuffer, transferBuffer);
+  transferMemory.erase(handleOf(transferBuffer));
+}
+
+void* RecordingGPUBackend::mapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer, bool cycle) {
+  auto it = transferMemory.find(handleOf(transferBuffer));
+  if (it == transferMemory.end()) {
+    SDL_Log("ERR: Mapping unknown transfer buffer %llx", (unsigned long long)handleOf(transferBuffer));
+    stats.errors++;
+    return NULL;
+  }
+  return it->second.data();
+}
+
+void RecordingGPUBackend::unmapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer) {}
+
+#pragma endregion Resources
+
+#pragma region Device
+
+SDL_GPUShaderFormat RecordingGPUBackend::getShaderFormats(SDL_GPUDevice *device) {
+  return SDL_GPU_SHADERFORMAT_SPIRV;
+}
+
+bool RecordingGPUBackend::waitForIdle(SDL_GPUDevice *device) {
+  return true;
+}
+
+bool RecordingGPUBackend::waitForFences(SDL_GPUDevice *device, bool waitAll, SDL_GPUFence *const *fences, Uint32 numFences) {
+  return true;
+}
+
+// work "completes" as soon as it is submitted
+bool RecordingGPUBackend::queryFence(SDL_GPUDevice *device, SDL_GPUFence *fence) {
+  return true;
+}
+
+void RecordingGPUBackend::releaseFence(SDL_GPUDevice *device, SDL_GPUFence *fence) {
+  if (liveFences == 0) {
+    SDL_Log("ERR: Release of unknown fence %llx", (unsigned long long)handleOf(fence));
+    stats.errors++;
+    return;
+  }
+  liveFences--;
+}
+
+bool RecordingGPUBackend::windowSupportsPresentMode(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUPresentMode mode) {
+  return true;
+}
+
+bool RecordingGPUBackend::setSwapchainParameters(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUSwapchainComposition composition, SDL_GPUPresentMode mode) {
+  return true;
+}
+
+SDL_GPUTextureFormat RecordingGPUBackend::getSwapchainTextureFormat(SDL_GPUDevice *device, SDL_Window *window) {
+  return SDL_GPU_TEXTUREFORMAT_B8G8R8A8_UNORM;
+}
+
+#pragma endregion Device
+
+#pragma region Command buffers
+
+SDL_GPUCommandBuffer* RecordingGPUBackend::acquireCommandBuffer(SDL_GPUDevice *device) {
+  SDL_GPUCommandBuffer *cmdBuf = fakeHandle<SDL_GPUCommandBuffer>(nextHandle);
+  nextHandle += 16;
+  return cmdBuf;
+}
+
+void RecordingGPUBackend::insertDebugLabel(SDL_GPUCommandBuffer *cmdBuf, const char *text) {
+  record(GCMD_DebugLabel, cmdBuf);
+}
+
+void RecordingGPUBackend::pushVertexUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length) {
+  stats.uniformPushes++;
+  stats.uniformBytes += length;
+  record(GCMD_PushUniforms, cmdBuf, slot, 0, length);
+}
+
+void RecordingGPUBackend::pushFragmentUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length) {
+  stats.uniformPushes++;
+  stats.uniformBytes += length;
+  record(GCMD_PushUniforms, cmdBuf, slot, 0, length);
+}
+
+bool RecordingGPUBackend::waitAndAcquireSwapchainTexture(SDL_GPUCommandBuffer *cmdBuf, SDL_Window *window, SDL_GPUTexture **texture, Uint32 *w, Uint32 *h) {
+  *texture = swapchainTx;
+  if (w != NULL) *w = swapchainW;
+  if (h != NULL) *h = swapchainH;
+  return true;
+}
+
+SDL_GPUFence* RecordingGPUBackend::submitCommandBufferAndAcquireFence(SDL_GPUCommandBuffer *cmdBuf) {
+  stats.submits++;
+  record(GCMD_Submit, cmdBuf);
+  // leaked fences show up as live resources
+  liveFences++;
+  SDL_GPUFence *fence = fakeHandle<SDL_GPUFence>(nextHandle);
+  nextHandle += 16;
+  return fence;
+}
+
+bool RecordingGPUBackend::cancelCommandBuffer(SDL_GPUCommandBuffer *cmdBuf) {
+  record(GCMD_Cancel, cmdBuf);
+  return true;
+}
+
+#pragma endregion Command buffers
+
+#pragma region Passes
+
+SDL_GPUCopyPass* RecordingGPUBackend::beginCopyPass(SDL_GPUCommandBuffer *cmdBuf) {
+  stats.copyPasses++;
+  record(GCMD_BeginCopyPass, cmdBuf);
+  return fakeHandle<SDL_GPUCopyPass>(handleOf(cmdBuf));
+}
+
+// bounds are checked on both ends like the validation layers would
+void RecordingGPUBackend::uploadToBuffer(SDL_GPUCopyPass *copyPass, SDL_GPUTransferBufferLocation const *source, SDL_GPUBufferRegion const *destination, bool cycle) {
+  stats.uploads++;
+  stats.uploadBytes += destination->size;
+  record(GCMD_Upload, destination->buffer, 0, 0, destination->size);
+  auto src = live.find(handleOf(source->transfer_buffer));
+  auto dst = live.find(handleOf(destination->buffer));
+  if (src == live.end() || dst == live.end()) {
+    SDL_Log("ERR: Upload between unknown buffers");
+    stats.errors++;
+    return;
+  }
+  if ((Uint64)source->offset + destination->size > src->second.size ||
+      (Uint64)destination->offset + destination->size > dst->second.size) {
+    SDL_Log(
+      "ERR: Upload of %d bytes out of bounds (transfer %d/%d, buffer %d/%d)",
+      destination->size, source->offset, src->second.size, destination->offset, dst->second.size
+    );
+    stats.errors++;
+  }
+}
+
+void RecordingGPUBackend::endCopyPass(SDL_GPUCopyPass *copyPass) {
+  record(GCMD_EndCopyPass, copyPass);
+}
+
+SDL_GPURenderPass* RecordingGPUBackend::beginRenderPass(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUColorTargetInfo const *colorTargets, Uint32 numColorTargets, SDL_GPUDepthStencilTargetInfo const *depthTarget) {
+  stats.renderPasses++;
+  record(GCMD_BeginRenderPass, numColorTargets > 0 ? colorTargets[0].texture : NULL, numColorTargets);
+  return fakeHandle<SDL_GPURenderPass>(handleOf(cmdBuf));
+}
+
+void RecordingGPUBackend::bindGraphicsPipeline(SDL_GPURenderPass *pass, SDL_GPUGraphicsPipeline *pipeline) {
+  stats.pipelineBinds++;
+  record(GCMD_BindPipeline, pipeline);
+}
+
+void RecordingGPUBackend::bindVertexBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBufferBinding const *bindings, Uint32 numBindings) {
+  stats.bufferBinds++;
+  record(GCMD_BindVertexBuffers, numBindings > 0 ? bindings[0].buffer : NULL, numBindings);
+}
+
+void RecordingGPUBackend::bindIndexBuffer(SDL_GPURenderPass *pass, SDL_GPUBufferBinding const *binding, SDL_GPUIndexElementSize elementSize) {
+  stats.bufferBinds++;
+  record(GCMD_BindIndexBuffer, binding->buffer, 1);
+}
+
+void RecordingGPUBackend::bindVertexStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers) {
+  stats.bufferBinds++;
+  record(GCMD_BindStorageBuffers, numBuffers > 0 ? buffers[0] : NULL, numBuffers);
+}
+
+void RecordingGPUBackend::bindFragmentStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers) {
+  stats.bufferBinds++;
+  record(GCMD_BindStorageBuffers, numBuffers > 0 ? buffers[0] : NULL, numBuffers);
+}
+
+void RecordingGPUBackend::bindFragmentSamplers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUTextureSamplerBinding const *bindings, Uint32 numBindings) {
+  stats.samplerBinds++;
+  record(GCMD_BindSamplers, numBindings > 0 ? bindings[0].texture : NULL, numBindings);
+}
+
+void RecordingGPUBackend::drawPrimitives(SDL_GPURenderPass *pass, Uint32 numVertices, Uint32 numInstances, Uint32 firstVertex, Uint32 firstInstance) {
+  stats.drawCalls++;
+  stats.instances += numInstances;
+  record(GCMD_Draw, pass, numVertices, numInstances);
+}
+
+void RecordingGPUBackend::drawIndexedPrimitives(SDL_GPURenderPass *pass, Uint32 numIndices, Uint32 numInstances, Uint32 firstIndex, Sint32 vertexOffset, Uint32 firstInstance) {
+  stats.drawCalls++;
+  stats.instances += numInstances;
+  record(GCMD_DrawIndexed, pass, numIndices, numInstances);
+}
+
+void RecordingGPUBackend::endRenderPass(SDL_GPURenderPass *pass) {
+  record(GCMD_EndRenderPass, pass);
+}
+
+#pragma endregion Passes
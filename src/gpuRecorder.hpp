@@ -0,0 +1,151 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+#include "gpuBackend.hpp"
+
+namespace App {
+  enum GPUCommandType {
+    GCMD_CreateBuffer,
+    GCMD_ReleaseBuffer,
+    GCMD_CreateTexture,
+    GCMD_ReleaseTexture,
+    GCMD_CreateSampler,
+    GCMD_ReleaseSampler,
+    GCMD_CreateShader,
+    GCMD_ReleaseShader,
+    GCMD_CreatePipeline,
+    GCMD_ReleasePipeline,
+    GCMD_CreateTransferBuffer,
+    GCMD_ReleaseTransferBuffer,
+    GCMD_BeginCopyPass,
+    GCMD_Upload,
+    GCMD_EndCopyPass,
+    GCMD_BeginRenderPass,
+    GCMD_BindPipeline,
+    GCMD_BindVertexBuffers,
+    GCMD_BindIndexBuffer,
+    GCMD_BindStorageBuffers,
+    GCMD_BindSamplers,
+    GCMD_PushUniforms,
+    GCMD_Draw,
+    GCMD_DrawIndexed,
+    GCMD_EndRenderPass,
+    GCMD_DebugLabel,
+    GCMD_Submit,
+    GCMD_Cancel
+  };
+  struct GPUCommand {
+    GPUCommandType type;
+    // resource created, released, bound or uploaded to
+    Uint64 handle;
+    // bindings, color targets, vertices or indices
+    Uint32 count;
+    Uint32 instances;
+    // buffer, upload or uniform size
+    Uint32 bytes;
+  };
+  struct GPURecordStats {
+    Uint32 submits = 0;
+    Uint32 renderPasses = 0;
+    Uint32 copyPasses = 0;
+    Uint32 pipelineBinds = 0;
+    Uint32 bufferBinds = 0;
+    Uint32 samplerBinds = 0;
+    Uint32 uniformPushes = 0;
+    Uint64 uniformBytes = 0;
+    Uint32 drawCalls = 0;
+    Uint64 instances = 0;
+    Uint32 uploads = 0;
+    Uint64 uploadBytes = 0;
+    Uint32 resourcesCreated = 0;
+    Uint64 bufferBytesCreated = 0;
+    // uploads out of bounds, unknown handles, double releases
+    Uint32 errors = 0;
+    Uint32 binds() const { return pipelineBinds + bufferBinds + samplerBinds; }
+  };
+  // GPU backend for headless runs. hands out fake handles, keeps transfer
+  // buffer memory on the heap and records every call into an inspectable
+  // command stream with running totals
+  class RecordingGPUBackend : public GPUBackend {
+  public:
+    RecordingGPUBackend(Uint32 swapchainW = 800, Uint32 swapchainH = 600);
+    // stands in for a real device when creating pipelines
+    SDL_GPUDevice* device() const { return fakeDevice; }
+    // clear the command stream and totals, live resources are kept
+    void reset();
+    Uint32 liveResources() const { return live.size() + liveFences; }
+    void logStats(const char *label) const;
+    void dump(Uint32 maxCommands) const;
+    static const char* commandName(GPUCommandType type);
+    std::vector<GPUCommand> commands;
+    GPURecordStats stats;
+    // off to measure submission cost without the recording overhead
+    bool recordCommands = true;
+    // resources
+    SDL_GPUBuffer* createBuffer(SDL_GPUDevice *device, SDL_GPUBufferCreateInfo const *info) override;
+    void releaseBuffer(SDL_GPUDevice *device, SDL_GPUBuffer *buffer) override;
+    SDL_GPUTexture* createTexture(SDL_GPUDevice *device, SDL_GPUTextureCreateInfo const *info) override;
+    void releaseTexture(SDL_GPUDevice *device, SDL_GPUTexture *texture) override;
+    SDL_GPUSampler* createSampler(SDL_GPUDevice *device, SDL_GPUSamplerCreateInfo const *info) override;
+    void releaseSampler(SDL_GPUDevice *device, SDL_GPUSampler *sampler) override;
+    SDL_GPUShader* createShader(SDL_GPUDevice *device, SDL_GPUShaderCreateInfo const *info) override;
+    void releaseShader(SDL_GPUDevice *device, SDL_GPUShader *shader) override;
+    SDL_GPUGraphicsPipeline* createGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipelineCreateInfo const *info) override;
+    void releaseGraphicsPipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipeline *pipeline) override;
+    SDL_GPUTransferBuffer* createTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBufferCreateInfo const *info) override;
+    void releaseTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer) override;
+    void* mapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer, bool cycle) override;
+    void unmapTransferBuffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transferBuffer) override;
+    // device
+    SDL_GPUShaderFormat getShaderFormats(SDL_GPUDevice *device) override;
+    bool waitForIdle(SDL_GPUDevice *device) override;
+    bool waitForFences(SDL_GPUDevice *device, bool waitAll, SDL_GPUFence *const *fences, Uint32 numFences) override;
+    bool queryFence(SDL_GPUDevice *device, SDL_GPUFence *fence) override;
+    void releaseFence(SDL_GPUDevice *device, SDL_GPUFence *fence) override;
+    bool windowSupportsPresentMode(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUPresentMode mode) override;
+    bool setSwapchainParameters(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUSwapchainComposition composition, SDL_GPUPresentMode mode) override;
+    SDL_GPUTextureFormat getSwapchainTextureFormat(SDL_GPUDevice *device, SDL_Window *window) override;
+    // command buffers
+    SDL_GPUCommandBuffer* acquireCommandBuffer(SDL_GPUDevice *device) override;
+    void insertDebugLabel(SDL_GPUCommandBuffer *cmdBuf, const char *text) override;
+    void pushVertexUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length) override;
+    void pushFragmentUniformData(SDL_GPUCommandBuffer *cmdBuf, Uint32 slot, void const *data, Uint32 length) override;
+    bool waitAndAcquireSwapchainTexture(SDL_GPUCommandBuffer *cmdBuf, SDL_Window *window, SDL_GPUTexture **texture, Uint32 *w, Uint32 *h) override;
+    SDL_GPUFence* submitCommandBufferAndAcquireFence(SDL_GPUCommandBuffer *cmdBuf) override;
+    bool cancelCommandBuffer(SDL_GPUCommandBuffer *cmdBuf) override;
+    // copy passes
+    SDL_GPUCopyPass* beginCopyPass(SDL_GPUCommandBuffer *cmdBuf) override;
+    void uploadToBuffer(SDL_GPUCopyPass *copyPass, SDL_GPUTransferBufferLocation const *source, SDL_GPUBufferRegion const *destination, bool cycle) override;
+    void endCopyPass(SDL_GPUCopyPass *copyPass) override;
+    // render passes
+    SDL_GPURenderPass* beginRenderPass(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUColorTargetInfo const *colorTargets, Uint32 numColorTargets, SDL_GPUDepthStencilTargetInfo const *depthTarget) override;
+    void bindGraphicsPipeline(SDL_GPURenderPass *pass, SDL_GPUGraphicsPipeline *pipeline) override;
+    void bindVertexBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBufferBinding const *bindings, Uint32 numBindings) override;
+    void bindIndexBuffer(SDL_GPURenderPass *pass, SDL_GPUBufferBinding const *binding, SDL_GPUIndexElementSize elementSize) override;
+    void bindVertexStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers) override;
+    void bindFragmentStorageBuffers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUBuffer *const *buffers, Uint32 numBuffers) override;
+    void bindFragmentSamplers(SDL_GPURenderPass *pass, Uint32 firstSlot, SDL_GPUTextureSamplerBinding const *bindings, Uint32 numBindings) override;
+    void drawPrimitives(SDL_GPURenderPass *pass, Uint32 numVertices, Uint32 numInstances, Uint32 firstVertex, Uint32 firstInstance) override;
+    void drawIndexedPrimitives(SDL_GPURenderPass *pass, Uint32 numIndices, Uint32 numInstances, Uint32 firstIndex, Sint32 vertexOffset, Uint32 firstInstance) override;
+    void endRenderPass(SDL_GPURenderPass *pass) override;
+  private:
+    struct Resource {
+      GPUCommandType type;
+      Uint32 size;
+    };
+    Uint64 create(GPUCommandType type, Uint32 size);
+    void release(GPUCommandType type, void const *handle);
+    void record(GPUCommandType type, void const *handle, Uint32 count = 0, Uint32 instances = 0, Uint32 bytes = 0);
+    Uint64 nextHandle = 0x1000;
+    SDL_GPUDevice *fakeDevice = NULL;
+    SDL_GPUTexture *swapchainTx = NULL;
+    Uint32 swapchainW, swapchainH;
+    std::unordered_map<Uint64, Resource> live;
+    // fences are only counted, submits shouldn't allocate
+    Uint32 liveFences = 0;
+    std::unordered_map<Uint64, std::vector<Uint8>> transferMemory;
+  };
+}
@@ -0,0 +1,239 @@
+#include "gpuResources.hpp"
+#include "gpuBackend.hpp"
+#include "frameArena.hpp"
+
+using namespace App;
+
+// FNV-1a over the resource type and the raw create info. the SDL create
+// infos spell out their padding, so equal settings give equal bytes
+static Uint64 hashInfo(GPUResourceType type, void const *info, size_t size) {
+  Uint8 const *bytes = static_cast<Uint8 const*>(info);
+  Uint64 hash = 0xcbf29ce484222325ull;
+  hash ^= (Uint8)type;
+  hash *= 0x100000001b3ull;
+  for (size_t i=0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+GPUResourceRegistry::GPUResourceRegistry(SDL_GPUDevice *gpu) {
+  device = gpu;
+}
+
+// GR_None matches a referenced slot of any type
+GPUResourceRegistry::Slot* GPUResourceRegistry::resolve(GPUHandle handle, GPUResourceType type) {
+  if (handle.index >= slots.size()) return NULL;
+  Slot &slot = slots[handle.index];
+  if (slot.generation != handle.generation || slot.refs == 0) return NULL;
+  if (type != GR_None && slot.type != type) return NULL;
+  return &slot;
+}
+
+GPUResourceRegistry::Slot const* GPUResourceRegistry::resolve(GPUHandle handle, GPUResourceType type) const {
+  return const_cast<GPUResourceRegistry*>(this)->resolve(handle, type);
+}
+
+// a hash hit only counts when the stored create info matches byte for byte
+GPUHandle GPUResourceRegistry::findShared(Uint64 hash, void const *info, size_t size) {
+  auto it = shared.find(hash);
+  if (it == shared.end()) return GPUHandle {};
+  Slot &slot = slots[it->second];
+  if (SDL_memcmp(&slot.info, info, size) != 0) return GPUHandle {};
+  slot.refs++;
+  stats.shared++;
+  return GPUHandle { it->second, slot.generation };
+}
+
+GPUHandle GPUResourceRegistry::insert(GPUResourceType type, void *resource, Uint64 hash) {
+  if (resource == NULL) return GPUHandle {};
+  Uint32 index;
+  if (!freeSlots.empty()) {
+    index = freeSlots.back();
+    freeSlots.pop_back();
+  } else {
+    index = slots.size();
+    slots.push_back(Slot {});
+  }
+  Slot &slot = slots[index];
+  slot.type = type;
+  slot.resource = resource;
+  slot.refs = 1;
+  slot.hash = hash;
+  if (hash != 0) shared[hash] = index;
+  owners[resource] = index;
+  stats.live++;
+  return GPUHandle { index, slot.generation };
+}
+
+GPUHandle GPUResourceRegistry::acquireSampler(SDL_GPUSamplerCreateInfo const &info) {
+  Uint64 hash = hashInfo(GR_Sampler, &info, sizeof(info));
+  GPUHandle handle = findShared(hash, &info, sizeof(info));
+  if (handle.valid()) return handle;
+  SDL_GPUSampler *sampler = getGPUBackend()->createSampler(device, &info);
+  if (sampler == NULL) {
+    SDL_Log("ERR: Failed to create sampler - %s", SDL_GetError());
+    return handle;
+  }
+  // a colliding hash keeps the first resource shared, this one stays private
+  if (shared.find(hash) != shared.end()) hash = 0;
+  handle = insert(GR_Sampler, sampler, hash);
+  slots[handle.index].info.sampler = info;
+  return handle;
+}
+
+GPUHandle GPUResourceRegistry::acquireTexture(SDL_GPUTextureCreateInfo const &info) {
+  Uint64 hash = hashInfo(GR_Texture, &info, sizeof(info));
+  GPUHandle handle = findShared(hash, &info, sizeof(info));
+  if (handle.valid()) return handle;
+  SDL_GPUTexture *texture = getGPUBackend()->createTexture(device, &info);
+  if (texture == NULL) {
+    SDL_Log("ERR: Failed to create texture - %s", SDL_GetError());
+    return handle;
+  }
+  if (shared.find(hash) != shared.end()) hash = 0;
+  handle = insert(GR_Texture, texture, hash);
+  slots[handle.index].info.texture = info;
+  return handle;
+}
+
+GPUHandle GPUResourceRegistry::createBuffer(SDL_GPUBufferCreateInfo const &info) {
+  SDL_GPUBuffer *buffer = getGPUBackend()->createBuffer(device, &info);
+  if (buffer == NULL) {
+    SDL_Log("ERR: Failed to create buffer - %s", SDL_GetError());
+    return GPUHandle {};
+  }
+  return insert(GR_Buffer, buffer, 0);
+}
+
+GPUHandle GPUResourceRegistry::adoptTexture(SDL_GPUTexture *texture) {
+  if (texture == NULL) return GPUHandle {};
+  auto it = owners.find(texture);
+  if (it != owners.end()) {
+    Slot &slot = slots[it->second];
+    slot.refs++;
+    return GPUHandle { it->second, slot.generation };
+  }
+  return insert(GR_Texture, texture, 0);
+}
+
+void GPUResourceRegistry::retain(GPUHandle handle) {
+  if (!handle.valid()) return;
+  Slot *slot = resolve(handle, GR_None);
+  if (slot == NULL) {
+    SDL_Log("ERR: Tried to retain stale gpu resource handle %d", handle.index);
+    return;
+  }
+  slot->refs++;
+}
+
+// the slot gets a new generation right away so the handle stops resolving,
+// the resource itself waits in pending until endFrame retires it
+void GPUResourceRegistry::release(GPUHandle handle) {
+  if (!handle.valid()) return;
+  Slot *slot = resolve(handle, GR_None);
+  if (slot == NULL) {
+    SDL_Log("ERR: Tried to release stale gpu resource handle %d", handle.index);
+    return;
+  }
+  if (--slot->refs > 0) return;
+  if (slot->hash != 0) shared.erase(slot->hash);
+  owners.erase(slot->resource);
+  slot->hash = 0;
+  slot->generation = slot->generation + 1 == 0 ? 1 : slot->generation + 1;
+  pending.push_back(PendingRelease { handle.index, frame });
+  stats.live--;
+  stats.pending++;
+}
+
+SDL_GPUBuffer* GPUResourceRegistry::buffer(GPUHandle handle) const {
+  Slot const *slot = resolve(handle, GR_Buffer);
+  return slot == NULL ? NULL : static_cast<SDL_GPUBuffer*>(slot->resource);
+}
+
+SDL_GPUTexture* GPUResourceRegistry::texture(GPUHandle handle) const {
+  Slot const *slot = resolve(handle, GR_Texture);
+  return slot == NULL ? NULL : static_cast<SDL_GPUTexture*>(slot->resource);
+}
+
+SDL_GPUSampler* GPUResourceRegistry::sampler(GPUHandle handle) const {
+  Slot const *slot = resolve(handle, GR_Sampler);
+  return slot == NULL ? NULL : static_cast<SDL_GPUSampler*>(slot->resource);
+}
+
+void GPUResourceRegistry::releaseResource(Slot &slot) {
+  switch (slot.type) {
+    case GR_Buffer:
+      getGPUBackend()->releaseBuffer(device, static_cast<SDL_GPUBuffer*>(slot.resource));
+      break;
+    case GR_Texture:
+      getGPUBackend()->releaseTexture(device, static_cast<SDL_GPUTexture*>(slot.resource));
+      break;
+    case GR_Sampler:
+      getGPUBackend()->releaseSampler(device, static_cast<SDL_GPUSampler*>(slot.resource));
+      break;
+    default:
+      break;
+  }
+  slot.type = GR_None;
+  slot.resource = NULL;
+}
+
+// frames recorded before the last reference went may still be in flight,
+// a released resource is only freed once all of them have come around
+void GPUResourceRegistry::endFrame() {
+  frame++;
+  Uint32 kept = 0;
+  for (Uint32 i=0; i < pending.size(); i++) {
+    PendingRelease const &p = pending[i];
+    if (frame - p.frame < FrameArena::FRAMES_IN_FLIGHT) {
+      pending[kept++] = p;
+      continue;
+    }
+    releaseResource(slots[p.index]);
+    freeSlots.push_back(p.index);
+  }
+  pending.resize(kept);
+  stats.pending = kept;
+}
+
+void GPUResourceRegistry::logStats() const {
+  SDL_Log(
+    "GPU resources: %d live, %d acquires shared, %d waiting for release",
+    stats.live, stats.shared, stats.pending
+  );
+}
+
+// everything goes, referenced or not. the owners are expected to be gone by now
+void GPUResourceRegistry::destroy() {
+  if (stats.live > 0) SDL_Log("ERR: %d gpu resources still referenced on destroy", stats.live);
+  for (Slot &slot : slots) {
+    if (slot.resource != NULL) releaseResource(slot);
+  }
+  slots.clear();
+  freeSlots.clear();
+  shared.clear();
+  owners.clear();
+  pending.clear();
+  stats = GPUResourceStats {};
+}
+
+static std::unordered_map<SDL_GPUDevice*, GPUResourceRegistry*> registries;
+
+// one registry per device, created on first use
+GPUResourceRegistry* App::getGPUResources(SDL_GPUDevice *device) {
+  auto it = registries.find(device);
+  if (it != registries.end()) return it->second;
+  GPUResourceRegistry *registry = new GPUResourceRegistry(device);
+  registries[device] = registry;
+  return registry;
+}
+
+void App::destroyGPUResources(SDL_GPUDevice *device) {
+  auto it = registries.find(device);
+  if (it == registries.end()) return;
+  it->second->destroy();
+  delete it->second;
+  registries.erase(it);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+
+namespace App {
+  enum GPUResourceType {
+    GR_None,
+    GR_Buffer,
+    GR_Texture,
+    GR_Sampler
+  };
+  // refers to a registry slot. the slot's generation moves on when the last
+  // reference is released, so a handle kept past that resolves to NULL
+  struct GPUHandle {
+    Uint32 index = 0;
+    Uint32 generation = 0; // never handed out, marks the null handle
+    bool valid() const { return generation != 0; }
+  };
+  struct GPUResourceStats {
+    Uint32 live = 0;
+    // acquires answered with an existing resource instead of a new one
+    Uint32 shared = 0;
+    // unreferenced, waiting for the frames that may still use them
+    Uint32 pending = 0;
+  };
+  // reference counted buffers, textures and samplers of one device.
+  // samplers and textures with identical create infos are created once and
+  // shared. a resource is released FRAMES_IN_FLIGHT frames after its last
+  // reference goes, once no submitted frame can still be reading it
+  class GPUResourceRegistry {
+  public:
+    GPUResourceRegistry(SDL_GPUDevice *gpu);
+    GPUHandle acquireSampler(SDL_GPUSamplerCreateInfo const &info);
+    GPUHandle acquireTexture(SDL_GPUTextureCreateInfo const &info);
+    // buffers get their contents after creation, they are never shared by create info
+    GPUHandle createBuffer(SDL_GPUBufferCreateInfo const &info);
+    // take ownership of a texture created elsewhere, adopting it again adds a reference
+    GPUHandle adoptTexture(SDL_GPUTexture *texture);
+    void retain(GPUHandle handle);
+    // null handles are ignored, stale ones are reported instead of freeing twice
+    void release(GPUHandle handle);
+    SDL_GPUBuffer* buffer(GPUHandle handle) const;
+    SDL_GPUTexture* texture(GPUHandle handle) const;
+    SDL_GPUSampler* sampler(GPUHandle handle) const;
+    void endFrame();
+    GPUResourceStats const &getStats() const { return stats; }
+    void logStats() const;
+    void destroy();
+  private:
+    struct Slot {
+      GPUResourceType type = GR_None;
+      void *resource = NULL;
+      Uint32 refs = 0;
+      Uint32 generation = 1;
+      // key in the shared map, 0 when the resource isn't shared by create info
+      Uint64 hash = 0;
+      union {
+        SDL_GPUSamplerCreateInfo sampler;
+        SDL_GPUTextureCreateInfo texture;
+      } info;
+    };
+    struct PendingRelease {
+      Uint32 index;
+      Uint64 frame;
+    };
+    Slot* resolve(GPUHandle handle, GPUResourceType type);
+    Slot const* resolve(GPUHandle handle, GPUResourceType type) const;
+    GPUHandle findShared(Uint64 hash, void const *info, size_t size);
+    GPUHandle insert(GPUResourceType type, void *resource, Uint64 hash);
+    void releaseResource(Slot &slot);
+    SDL_GPUDevice *device = NULL;
+    std::vector<Slot> slots;
+    std::vector<Uint32> freeSlots;
+    // create info hash -> slot, for samplers and textures
+    std::unordered_map<Uint64, Uint32> shared;
+    // resource -> slot, so adopting a known texture adds a reference
+    std::unordered_map<void*, Uint32> owners;
+    std::vector<PendingRelease> pending;
+    Uint64 frame = 0;
+    GPUResourceStats stats;
+  };
+  GPUResourceRegistry* getGPUResources(SDL_GPUDevice *device);
+  void destroyGPUResources(SDL_GPUDevice *device);
+}
@@ -0,0 +1,208 @@
+#include "app.hpp"
+
+using namespace App;
+
+// per frame limits a scene has to stay under once it reaches steady state
+struct SceneBudget {
+  const char *name;
+  Uint32 drawCalls;
+  Uint32 binds;
+  Uint32 uniformPushes;
+  Uint64 uploadBytes;
+  // operator new calls, job ranges included
+  Uint32 heapAllocs;
+};
+
+static const SceneBudget budgets[] = {
+  { "SDF", 4, 12, 8, 64 * 1024, 0 },
+  { "Obj", 4, 12, 8, 16 * 1024, 0 },
+  { "Stress", 4, 12, 8, 1024 * 1024, 0 },
+};
+
+// the stress grid faces its camera at 800x600, the 7 rows past the top and
+// the 7 past the bottom plane are culled whatever the objects' spin
+static const Uint32 STRESS_CULLED = 14 * StressScene::GRID_SIZE;
+
+// random shapes of one type spread over area, SDF_None mixes all of them.
+// a third get round corners and another third become outlines
+static std::vector<SDFObject> randomSdfObjects(SDFObjectType type, Uint32 count, glm::vec2 area, Uint64 &seed) {
+  std::vector<SDFObject> objs;
+  for (Uint32 i=0; i < count; i++) {
+    SDFObjectType t = type != SDF_None ? type : (SDFObjectType)(SDF_Circle + SDL_rand_r(&seed, SDF_RectA));
+    glm::vec2 c = glm::vec2(SDL_randf_r(&seed) * area.x, SDL_randf_r(&seed) * area.y);
+    glm::vec2 size = glm::vec2(4.0f + SDL_randf_r(&seed) * 60.0f, 4.0f + SDL_randf_r(&seed) * 60.0f);
+    glm::vec2 p2 = c + glm::vec2(SDL_randf_r(&seed) - 0.5f, SDL_randf_r(&seed) - 0.5f) * size * 4.0f;
+    glm::vec2 p3 = c + glm::vec2(SDL_randf_r(&seed) - 0.5f, SDL_randf_r(&seed) - 0.5f) * size * 4.0f;
+    SDFObject obj;
+    switch (t) {
+      case SDF_Circle: obj = SDFObject::circle(c, size.x); break;
+      case SDF_Line: obj = SDFObject::line(c, p2, SDL_randf_r(&seed) * 8.0f); break;
+      case SDF_Triangle: obj = SDFObject::triangle(c, p2, p3); break;
+      case SDF_Rect: obj = SDFObject::rect(c, size); break;
+      default: obj = SDFObject::rect(c, size, SDL_randf_r(&seed) * 360.0f); break;
+    }
+    Sint32 modifier = SDL_rand_r(&seed, 3);
+    if (modifier == 1) obj.withRoundCorner(SDL_randf_r(&seed) * 10.0f);
+    if (modifier == 2) obj.asOutline(1.0f + SDL_randf_r(&seed) * 5.0f);
+    objs.push_back(obj);
+  }
+  return objs;
+}
+
+// the cpu sdf paths against calculateSdf, one shape type at a time and mixed
+static bool validateSdfQueries() {
+  glm::vec2 area = glm::vec2(800.0f, 600.0f);
+  SDFObjectType const types[] = { SDF_Circle, SDF_Line, SDF_Triangle, SDF_Rect, SDF_RectA, SDF_None };
+  Uint64 seed = 1;
+  bool passed = true;
+  for (SDFObjectType type : types) {
+    std::vector<SDFObject> objs = randomSdfObjects(type, 64, area, seed);
+    passed = validateSdfBatch(objs, area, 4000) && passed;
+    passed = validateSdfGrid(objs, area, 4000) && passed;
+  }
+
+  // tile binning on a dense mixed set, with a ring of shapes straddling the
+  // light radius. once with the light inside the screen, once off a corner
+  SDFSysData lights[2] = {
+    { .screenSize = area, .lightPos = glm::vec2(420.0f, 280.0f), .lightDist = 250.0f },
+    { .screenSize = area, .lightPos = glm::vec2(-60.0f, 650.0f), .lightDist = 800.0f },
+  };
+  for (SDFSysData &sys : lights) {
+    std::vector<SDFObject> objs = randomSdfObjects(SDF_None, 256, area, seed);
+    std::vector<SDFObject> ring = randomSdfObjects(SDF_None, 48, area, seed);
+    for (SDFObject &obj : ring) {
+      float angle = SDL_randf_r(&seed) * 2.0f * SDL_PI_F;
+      float r = sys.lightDist + SDL_randf_r(&seed) * 20.0f - 10.0f;
+      obj.updatePosition(sys.lightPos + glm::vec2(SDL_cosf(angle), SDL_sinf(angle)) * r);
+      objs.push_back(obj);
+    }
+    sys.objCount = objs.size();
+    passed = validateSdfTiles(objs, sys, 20000) && passed;
+  }
+  return passed;
+}
+
+static Scene* createBenchScene(int index, SDL_GPUDevice *gpu, SDL_GPUTextureFormat format) {
+  switch (index) {
+    case 0: return new SdfScene(gpu, format);
+    case 1: return new ObjScene(gpu, format);
+    case 2: return new StressScene(gpu, format);
+  }
+  return NULL;
+}
+
+// runs every scene against the recording backend and checks the command
+// stream of the last frames against the budgets. the text overlay is left
+// out since the SDL_ttf gpu engine needs a real device
+bool App::runHeadlessBench(Uint32 frames) {
+  RecordingGPUBackend recorder;
+  setGPUBackend(&recorder);
+  SDL_GPUDevice *gpu = recorder.device();
+  SDL_GPUTextureFormat format = recorder.getSwapchainTextureFormat(gpu, NULL);
+  frames = SDL_max(frames, 2);
+  Uint32 warmup = SDL_max(frames / 4, 1);
+
+  static bool noKeys[SDL_SCANCODE_COUNT] = {};
+  SystemUpdates sys;
+  sys.kbStates = noKeys;
+  sys.mFlags = 0;
+  sys.mousePosScreenSpace = glm::vec2(400.0f, 300.0f);
+  sys.deltaTime = 1.0f / 60.0f;
+
+  // the last frame of each scene records its commands, keep that off the heap count
+  recorder.commands.reserve(4096);
+  bool passed = validateFrustumCuller(10000);
+  passed = validateSdfQueries() && passed;
+  for (int i=0; i < SDL_arraysize(budgets); i++) {
+    SceneBudget const &budget = budgets[i];
+    Scene *scene = createBenchScene(i, gpu, format);
+    StagingRing *staging = getStagingRing(gpu);
+    Uint32 draws = 0, binds = 0, pushes = 0, errors = 0, heapAllocs = 0;
+    Uint64 uploadBytes = 0;
+    Uint64 cpuNs = 0;
+    Uint32 measured = 0;
+    for (Uint32 f=0; f < frames; f++) {
+      // early frames upload meshes and grow buffers, only steady state counts
+      recorder.reset();
+      recorder.recordCommands = f == frames - 1;
+      Uint64 t0 = SDL_GetTicksNS();
+      sys.lifetime = t0;
+      scene->update(sys);
+      getJobSystem()->sync();
+
+      SDL_GPUCommandBuffer *cmdBuf = recorder.acquireCommandBuffer(gpu);
+      SDL_GPUTexture *swapchain = NULL;
+      recorder.waitAndAcquireSwapchainTexture(cmdBuf, NULL, &swapchain, NULL, NULL);
+      staging->flush(cmdBuf);
+      scene->render(cmdBuf, swapchain);
+      SDL_GPUFence *fence = recorder.submitCommandBufferAndAcquireFence(cmdBuf);
+      staging->endFrame(fence);
+      getGPUResources(gpu)->endFrame();
+      getJobSystem()->endFrame();
+      getFrameArena()->endFrame();
+      getProfiler()->endFrame();
+      if (f < warmup) continue;
+      cpuNs += SDL_GetTicksNS() - t0;
+      measured++;
+      draws = SDL_max(draws, recorder.stats.drawCalls);
+      binds = SDL_max(binds, recorder.stats.binds());
+      pushes = SDL_max(pushes, recorder.stats.uniformPushes);
+      uploadBytes = SDL_max(uploadBytes, recorder.stats.uploadBytes);
+      errors += recorder.stats.errors;
+      heapAllocs = SDL_max(heapAllocs, getFrameArena()->frameStats().heapAllocations);
+    }
+
+    char label[96];
+    SDL_snprintf(
+      label, sizeof(label), "Headless %s (%.3f ms cpu/frame, %d heap allocs/frame)",
+      budget.name, (double)cpuNs / measured / 1e6, heapAllocs
+    );
+    recorder.logStats(label);
+    getGPUResources(gpu)->logStats();
+    bool ok = errors == 0;
+    if (draws > budget.drawCalls) {
+      SDL_Log("ERR: %s: %d draw calls over budget of %d", budget.name, draws, budget.drawCalls);
+      ok = false;
+    }
+    if (binds > budget.binds) {
+      SDL_Log("ERR: %s: %d binds over budget of %d", budget.name, binds, budget.binds);
+      ok = false;
+    }
+    if (pushes > budget.uniformPushes) {
+      SDL_Log("ERR: %s: %d uniform pushes over budget of %d", budget.name, pushes, budget.uniformPushes);
+      ok = false;
+    }
+    if (heapAllocs > budget.heapAllocs) {
+      SDL_Log("ERR: %s: %d heap allocs/frame over budget of %d", budget.name, heapAllocs, budget.heapAllocs);
+      ok = false;
+    }
+    if (uploadBytes > budget.uploadBytes) {
+      SDL_Log(
+        "ERR: %s: %llu upload bytes over budget of %llu", budget.name,
+        (unsigned long long)uploadBytes, (unsigned long long)budget.uploadBytes
+      );
+      ok = false;
+    }
+    StressScene *stress = dynamic_cast<StressScene*>(scene);
+    if (stress != NULL && stress->objPipe->stats.culled != STRESS_CULLED) {
+      SDL_Log("ERR: %s: %d objects culled, expected %d", budget.name, stress->objPipe->stats.culled, STRESS_CULLED);
+      ok = false;
+    }
+    if (!ok) recorder.dump(64);
+    passed = passed && ok;
+
+    scene->destroy();
+    delete scene;
+    destroyGPUResources(gpu);
+    destroyStagingRing(gpu);
+    getMeshFactory()->clear();
+  }
+
+  if (recorder.liveResources() > 0) {
+    SDL_Log("ERR: %d gpu resources leaked", recorder.liveResources());
+    passed = false;
+  }
+  setGPUBackend(NULL);
+  SDL_Log("Headless bench %s", passed ? "passed" : "failed");
+  return passed;
+}
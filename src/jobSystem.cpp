@@ -0,0 +1,317 @@
+#include <deque>
+#include "jobSystem.hpp"
+#include "profiler.hpp"
+
+using namespace App;
+
+struct App::Job {
+  JobSystem *owner;
+  SDL_AtomicInt refs;
+  JobFn fn;
+  // unfinished dependencies, plus one while the job is being queued
+  SDL_AtomicInt pending;
+  SDL_AtomicInt done;
+  std::vector<JobHandle> dependents;
+};
+
+// queue used by the current thread, threads outside the pool share queue 0
+static thread_local int workerIndex = 0;
+// jobs run inside a waiting job are already counted as busy time
+static thread_local int jobDepth = 0;
+// parallelFor range lists, one per nesting level on each thread, kept
+// across calls so queuing ranges reuses their storage
+static thread_local std::deque<std::vector<JobHandle>> rangeLists;
+static thread_local size_t rangeDepth = 0;
+// jobs made up front and queue slots reserved per thread, enough for a few
+// parallelFor calls in flight before the pool has to grow
+static const size_t JOBS_PER_THREAD = 16;
+static const size_t DEPENDENTS_PER_JOB = 4;
+
+static Job* newJob(JobSystem *owner) {
+  Job *job = new Job();
+  job->owner = owner;
+  SDL_SetAtomicInt(&job->refs, 0);
+  job->dependents.reserve(DEPENDENTS_PER_JOB);
+  return job;
+}
+
+JobHandle::JobHandle(Job *job) : job(job) {
+  SDL_AddAtomicInt(&job->refs, 1);
+}
+
+JobHandle::JobHandle(JobHandle const &other) : job(other.job) {
+  if (job != NULL) SDL_AddAtomicInt(&job->refs, 1);
+}
+
+JobHandle::~JobHandle() {
+  if (job != NULL && SDL_AddAtomicInt(&job->refs, -1) == 1) job->owner->recycle(job);
+}
+
+struct WorkerStart {
+  JobSystem *jobs;
+  int index;
+};
+
+JobSystem::JobSystem(int workerThreads) {
+  SDL_SetAtomicInt(&queued, 0);
+  SDL_SetAtomicInt(&outstanding, 0);
+  SDL_SetAtomicInt(&quit, 0);
+  depLock = SDL_CreateMutex();
+  poolLock = SDL_CreateMutex();
+  sleepLock = SDL_CreateMutex();
+  wake = SDL_CreateCondition();
+  for (int i=0; i <= workerThreads; i++) {
+    Queue *q = new Queue();
+    q->lock = SDL_CreateMutex();
+    SDL_SetAtomicInt(&q->busyUS, 0);
+    SDL_SetAtomicInt(&q->jobCount, 0);
+    SDL_SetAtomicInt(&q->steals, 0);
+    q->ring.resize(JOBS_PER_THREAD * (workerThreads + 1));
+    queues.push_back(q);
+  }
+  for (size_t i=0; i < JOBS_PER_THREAD * queues.size(); i++) freeJobs.push_back(newJob(this));
+  for (int i=1; i <= workerThreads; i++) {
+    SDL_Thread *thread = SDL_CreateThread(workerMain, "job worker", new WorkerStart { this, i });
+    if (thread == NULL) {
+      // the queue stays, jobs pushed to it are stolen by the others
+      SDL_Log("ERR: Failed to start job worker %d - %s", i, SDL_GetError());
+      continue;
+    }
+    threads.push_back(thread);
+  }
+  frameStart = SDL_GetTicksNS();
+}
+
+JobSystem::~JobSystem() {
+  sync();
+  SDL_LockMutex(sleepLock);
+  SDL_SetAtomicInt(&quit, 1);
+  SDL_BroadcastCondition(wake);
+  SDL_UnlockMutex(sleepLock);
+  for (SDL_Thread *thread : threads) SDL_WaitThread(thread, NULL);
+  for (Queue *q : queues) {
+    SDL_DestroyMutex(q->lock);
+    delete q;
+  }
+  for (Job *job : freeJobs) delete job;
+  SDL_DestroyCondition(wake);
+  SDL_DestroyMutex(sleepLock);
+  SDL_DestroyMutex(poolLock);
+  SDL_DestroyMutex(depLock);
+}
+
+Job* JobSystem::acquire() {
+  Job *job = NULL;
+  SDL_LockMutex(poolLock);
+  if (!freeJobs.empty()) {
+    job = freeJobs.back();
+    freeJobs.pop_back();
+  }
+  SDL_UnlockMutex(poolLock);
+  return job != NULL ? job : newJob(this);
+}
+
+void JobSystem::recycle(Job *job) {
+  SDL_LockMutex(poolLock);
+  freeJobs.push_back(job);
+  SDL_UnlockMutex(poolLock);
+}
+
+int JobSystem::workerMain(void *data) {
+  WorkerStart start = *static_cast<WorkerStart*>(data);
+  delete static_cast<WorkerStart*>(data);
+  JobSystem *jobs = start.jobs;
+  workerIndex = start.index;
+  setProfileThreadName("job worker");
+  // first nesting level up front, ranges queued from jobs are the common case
+  rangeLists.emplace_back().reserve(jobs->queues.size() * 4);
+  while (SDL_GetAtomicInt(&jobs->quit) == 0) {
+    if (jobs->runOne(start.index)) continue;
+    SDL_LockMutex(jobs->sleepLock);
+    while (SDL_GetAtomicInt(&jobs->queued) == 0 && SDL_GetAtomicInt(&jobs->quit) == 0) {
+      SDL_WaitCondition(jobs->wake, jobs->sleepLock);
+    }
+    SDL_UnlockMutex(jobs->sleepLock);
+  }
+  return 0;
+}
+
+int JobSystem::currentIndex() const {
+  return workerIndex < (int)queues.size() ? workerIndex : 0;
+}
+
+void JobSystem::push(JobHandle const &job) {
+  Queue *q = queues[currentIndex()];
+  SDL_LockMutex(q->lock);
+  if (q->count == q->ring.size()) {
+    // unroll into a bigger ring, oldest first
+    std::vector<JobHandle> grown(q->ring.size() * 2);
+    for (size_t i=0; i < q->count; i++) grown[i] = std::move(q->ring[(q->head + i) % q->ring.size()]);
+    q->ring.swap(grown);
+    q->head = 0;
+  }
+  q->ring[(q->head + q->count) % q->ring.size()] = job;
+  q->count++;
+  SDL_UnlockMutex(q->lock);
+  SDL_AddAtomicInt(&queued, 1);
+  if (threads.empty()) return;
+  SDL_LockMutex(sleepLock);
+  SDL_SignalCondition(wake);
+  SDL_UnlockMutex(sleepLock);
+}
+
+// newest job from our own queue, otherwise the oldest one of another queue
+JobHandle JobSystem::pop(int index) {
+  if (SDL_GetAtomicInt(&queued) == 0) return NULL;
+  JobHandle job;
+  Queue *own = queues[index];
+  SDL_LockMutex(own->lock);
+  if (own->count > 0) {
+    own->count--;
+    job = std::move(own->ring[(own->head + own->count) % own->ring.size()]);
+  }
+  SDL_UnlockMutex(own->lock);
+  for (size_t i=1; job == NULL && i < queues.size(); i++) {
+    Queue *victim = queues[(index + i) % queues.size()];
+    SDL_LockMutex(victim->lock);
+    if (victim->count > 0) {
+      job = std::move(victim->ring[victim->head]);
+      victim->head = (victim->head + 1) % victim->ring.size();
+      victim->count--;
+      SDL_AddAtomicInt(&own->steals, 1);
+    }
+    SDL_UnlockMutex(victim->lock);
+  }
+  if (job != NULL) SDL_AddAtomicInt(&queued, -1);
+  return job;
+}
+
+bool JobSystem::runOne(int index) {
+  JobHandle job = pop(index);
+  if (job == NULL) return false;
+  execute(job, index);
+  return true;
+}
+
+void JobSystem::execute(JobHandle const &job, int index) {
+  PROFILE_ZONE("job");
+  Uint64 t0 = SDL_GetTicksNS();
+  jobDepth++;
+  job->fn();
+  jobDepth--;
+  Queue *q = queues[index];
+  if (jobDepth == 0) SDL_AddAtomicInt(&q->busyUS, (int)((SDL_GetTicksNS() - t0) / 1000));
+  SDL_AddAtomicInt(&q->jobCount, 1);
+
+  // release dependents whose last dependency this was. once done is set no
+  // one adds to the list, so it can be walked outside the lock
+  SDL_LockMutex(depLock);
+  SDL_SetAtomicInt(&job->done, 1);
+  SDL_UnlockMutex(depLock);
+  for (JobHandle const &next : job->dependents) {
+    if (SDL_AddAtomicInt(&next->pending, -1) == 1) push(next);
+  }
+  // keeps its capacity for the job's next use
+  job->dependents.clear();
+  SDL_AddAtomicInt(&outstanding, -1);
+}
+
+JobHandle JobSystem::run(JobFn const &fn, std::vector<JobHandle> const &deps) {
+  JobHandle job(acquire());
+  job->fn = fn;
+  SDL_SetAtomicInt(&job->pending, 1);
+  SDL_SetAtomicInt(&job->done, 0);
+  SDL_AddAtomicInt(&outstanding, 1);
+  if (!deps.empty()) {
+    SDL_LockMutex(depLock);
+    for (JobHandle const &dep : deps) {
+      if (dep == NULL || SDL_GetAtomicInt(&dep->done) != 0) continue;
+      SDL_AddAtomicInt(&job->pending, 1);
+      dep->dependents.push_back(job);
+    }
+    SDL_UnlockMutex(depLock);
+  }
+  if (SDL_AddAtomicInt(&job->pending, -1) == 1) push(job);
+  return job;
+}
+
+// help out with queued jobs instead of blocking
+void JobSystem::wait(JobHandle const &job) {
+  int index = currentIndex();
+  while (job != NULL && SDL_GetAtomicInt(&job->done) == 0) {
+    if (!runOne(index)) SDL_CPUPauseInstruction();
+  }
+}
+
+void JobSystem::parallelFor(Uint32 count, Uint32 grain, RangeFn const &fn) {
+  if (count == 0) return;
+  // a few ranges per thread leaves room for stealing without drowning in jobs
+  Uint32 minGrain = (count + queues.size() * 4 - 1) / (queues.size() * 4);
+  grain = SDL_max(SDL_max(grain, minGrain), 1);
+  bool serial = queues.size() == 1 || count <= grain;
+  size_t depth = rangeDepth++;
+  if (depth == rangeLists.size()) rangeLists.emplace_back().reserve(queues.size() * 4);
+  std::vector<JobHandle> &ranges = rangeLists[depth];
+  for (Uint32 begin = grain; !serial && begin < count; begin += grain) {
+    Uint32 end = SDL_min(begin + grain, count);
+    ranges.push_back(run([&fn, begin, end]() { fn(begin, end); }));
+  }
+  // first range (or all of it) on this thread
+  Uint64 t0 = SDL_GetTicksNS();
+  jobDepth++;
+  fn(0, serial ? count : grain);
+  jobDepth--;
+  if (jobDepth == 0) SDL_AddAtomicInt(&queues[currentIndex()]->busyUS, (int)((SDL_GetTicksNS() - t0) / 1000));
+  for (JobHandle const &r : ranges) wait(r);
+  // drop the handles so the jobs go back to the pool
+  ranges.clear();
+  rangeDepth--;
+}
+
+void JobSystem::sync() {
+  PROFILE_ZONE("JobSystem::sync");
+  int index = currentIndex();
+  while (SDL_GetAtomicInt(&outstanding) > 0) {
+    if (!runOne(index)) SDL_CPUPauseInstruction();
+  }
+}
+
+void JobSystem::endFrame() {
+  sync();
+  Uint64 now = SDL_GetTicksNS();
+  lastFrame.frameNS = now - frameStart;
+  frameStart = now;
+  lastFrame.workers.resize(queues.size());
+  for (size_t i=0; i < queues.size(); i++) {
+    Queue *q = queues[i];
+    lastFrame.workers[i] = WorkerStats {
+      (Uint64)SDL_SetAtomicInt(&q->busyUS, 0) * 1000,
+      (Uint32)SDL_SetAtomicInt(&q->jobCount, 0),
+      (Uint32)SDL_SetAtomicInt(&q->steals, 0),
+    };
+  }
+}
+
+// busy share of the last frame per thread, main thread first
+std::string JobSystem::utilizationInfo() const {
+  if (lastFrame.frameNS == 0) return "";
+  std::string info = "Jobs: " + std::to_string(queues.size()) + " threads";
+  for (size_t i=0; i < lastFrame.workers.size(); i++) {
+    int percent = (int)(100 * lastFrame.workers[i].busyNS / lastFrame.frameNS);
+    info += (i == 0 ? " " : "/") + std::to_string(SDL_min(percent, 100)) + "%";
+  }
+  return info;
+}
+
+static JobSystem *jobSystem = NULL;
+
+// one worker per extra logical core, the main thread makes up the last one
+JobSystem* App::getJobSystem() {
+  if (jobSystem == NULL) jobSystem = new JobSystem(SDL_max(SDL_GetNumLogicalCPUCores() - 1, 0));
+  return jobSystem;
+}
+
+void App::destroyJobSystem() {
+  delete jobSystem;
+  jobSystem = NULL;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <SDL3/SDL.h>
+
+namespace App {
+  struct Job;
+  class JobSystem;
+  // counted reference to a pooled job, the job goes back to its JobSystem's
+  // free list once the last handle drops. handles must not outlive the system
+  class JobHandle {
+  public:
+    JobHandle() = default;
+    JobHandle(std::nullptr_t) {}
+    JobHandle(JobHandle const &other);
+    JobHandle(JobHandle &&other) : job(other.job) { other.job = NULL; }
+    ~JobHandle();
+    JobHandle& operator=(JobHandle other) {
+      std::swap(job, other.job);
+      return *this;
+    }
+    Job* operator->() const { return job; }
+    bool operator==(std::nullptr_t) const { return job == NULL; }
+    bool operator!=(std::nullptr_t) const { return job != NULL; }
+  private:
+    friend class JobSystem;
+    explicit JobHandle(Job *job);
+    Job *job = NULL;
+  };
+  struct WorkerStats {
+    Uint64 busyNS = 0;
+    Uint32 jobs = 0;
+    Uint32 steals = 0;
+  };
+  struct JobFrameStats {
+    Uint64 frameNS = 0;
+    // index 0 is the main thread
+    std::vector<WorkerStats> workers;
+  };
+  // non-owning reference to a parallelFor body. parallelFor only returns once
+  // every range ran, so the caller's lambda can be called in place without
+  // the copy (and heap allocation) std::function would make
+  class RangeFn {
+  public:
+    template<typename F>
+    RangeFn(F const &fn) : obj(&fn), call([](void const *obj, Uint32 begin, Uint32 end) {
+      (*static_cast<F const*>(obj))(begin, end);
+    }) {}
+    void operator()(Uint32 begin, Uint32 end) const { call(obj, begin, end); }
+  private:
+    void const *obj;
+    void (*call)(void const *obj, Uint32 begin, Uint32 end);
+  };
+  // job body stored inline in the pooled Job, so queuing one stays off the
+  // heap. captures have to be trivially copyable and fit CAPACITY, anything
+  // bigger goes behind a pointer
+  class JobFn {
+  public:
+    static constexpr size_t CAPACITY = 48;
+    JobFn() = default;
+    template<typename F>
+    JobFn(F const &fn) : call([](void const *data) { (*static_cast<F const*>(data))(); }) {
+      static_assert(sizeof(F) <= CAPACITY && alignof(F) <= alignof(std::max_align_t), "job captures too big");
+      static_assert(std::is_trivially_copyable<F>::value, "job captures have to be trivially copyable");
+      SDL_memcpy(data, &fn, sizeof(F));
+    }
+    void operator()() const { call(data); }
+  private:
+    alignas(std::max_align_t) unsigned char data[CAPACITY];
+    void (*call)(void const *data) = NULL;
+  };
+  // work-stealing pool for per-frame CPU work. each worker pops its own queue
+  // newest first and steals the oldest jobs of the others when it runs dry.
+  // the main thread owns queue 0 and runs jobs whenever it waits on one
+  class JobSystem {
+  public:
+    JobSystem(int workerThreads);
+    ~JobSystem();
+    // queue fn to run once every job in deps has finished
+    JobHandle run(JobFn const &fn, std::vector<JobHandle> const &deps = {});
+    // split [0, count) into ranges of at least grain items and wait for all of them.
+    // small ranges run inline on the calling thread
+    void parallelFor(Uint32 count, Uint32 grain, RangeFn const &fn);
+    void wait(JobHandle const &job);
+    // frame sync point, returns once every job queued so far has finished
+    void sync();
+    // sync and roll the per-worker counters over into lastFrame
+    void endFrame();
+    int threadCount() const { return (int)queues.size(); }
+    std::string utilizationInfo() const;
+    JobFrameStats lastFrame;
+  private:
+    friend class JobHandle;
+    // ring of queued jobs, grows but never shrinks so steady state
+    // pushes and pops don't allocate
+    struct Queue {
+      SDL_Mutex *lock = NULL;
+      std::vector<JobHandle> ring;
+      size_t head = 0;
+      size_t count = 0;
+      SDL_AtomicInt busyUS;
+      SDL_AtomicInt jobCount;
+      SDL_AtomicInt steals;
+    };
+    static int workerMain(void *data);
+    void push(JobHandle const &job);
+    JobHandle pop(int index);
+    bool runOne(int index);
+    void execute(JobHandle const &job, int index);
+    int currentIndex() const;
+    Job* acquire();
+    void recycle(Job *job);
+    std::vector<Queue*> queues;
+    std::vector<SDL_Thread*> threads;
+    // guards dependency lists
+    SDL_Mutex *depLock = NULL;
+    // finished jobs waiting to be reused
+    SDL_Mutex *poolLock = NULL;
+    std::vector<Job*> freeJobs;
+    // idle workers sleep here until a job is queued
+    SDL_Mutex *sleepLock = NULL;
+    SDL_Condition *wake = NULL;
+    SDL_AtomicInt queued;
+    SDL_AtomicInt outstanding;
+    SDL_AtomicInt quit;
+    Uint64 frameStart = 0;
+  };
+  JobSystem* getJobSystem();
+  void destroyJobSystem();
+}
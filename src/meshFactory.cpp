@@ -0,0 +1,258 @@
+#include "meshFactory.hpp"
+
+using namespace App;
+
+bool MeshFactory::Params::operator==(Params const &other) const {
+  return shape == other.shape && SDL_memcmp(values, other.values, sizeof(values)) == 0;
+}
+
+// FNV-1a over the shape and raw parameter bits, never 0 so it can't be
+// mistaken for an unkeyed primitive
+Uint64 MeshFactory::hashParams(Params const &p) {
+  Uint8 bytes[sizeof(Uint32) + sizeof(p.values)];
+  SDL_memcpy(bytes, &p.shape, sizeof(Uint32));
+  SDL_memcpy(bytes + sizeof(Uint32), p.values, sizeof(p.values));
+  Uint64 hash = 0xcbf29ce484222325ull;
+  for (Uint8 b : bytes) {
+    hash ^= b;
+    hash *= 0x100000001b3ull;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+// colliding parameters probe on to the next key. entries are never replaced,
+// so primitives handed out and the keys ObjectPipeline caches stay what they were
+Uint64 MeshFactory::keyFor(Params const &p) const {
+  Uint64 key = hashParams(p);
+  while (true) {
+    auto it = cache.find(key);
+    if (it == cache.end() || it->second.params == p) return key;
+    key = key + 1 == 0 ? 1 : key + 1;
+  }
+}
+
+Primitive const* MeshFactory::lookup(Params const &p) {
+  auto it = cache.find(keyFor(p));
+  if (it == cache.end()) return NULL;
+  stats.hits++;
+  return &it->second.prim;
+}
+
+Primitive const& MeshFactory::store(Params const &p, Primitive &&prim) {
+  Uint64 key = keyFor(p);
+  auto it = cache.find(key);
+  if (it != cache.end()) return it->second.prim;
+  prim.key = key;
+  if (optimize) {
+    MeshOptStats opt = optimizeMesh(prim);
+    stats.optimized.triangles += opt.triangles;
+    stats.optimized.verticesBefore += opt.verticesBefore;
+    stats.optimized.verticesAfter += opt.verticesAfter;
+    stats.optimized.missesBefore += opt.missesBefore;
+    stats.optimized.missesAfter += opt.missesAfter;
+    if (opt.triangles >= HEAVY_MESH_TRIANGLES) {
+      SDL_Log(
+        "Mesh optimized: %d triangles, %d -> %d vertices, ACMR %.2f -> %.2f, ATVR %.2f -> %.2f",
+        opt.triangles, opt.verticesBefore, opt.verticesAfter,
+        opt.acmrBefore(), opt.acmrAfter(), opt.atvrBefore(), opt.atvrAfter()
+      );
+    }
+  }
+  stats.generated++;
+  stats.vertices += prim.vertices.size();
+  stats.indices += prim.indices.size();
+  return cache.emplace(key, Entry { p, std::move(prim) }).first->second.prim;
+}
+
+// FNV-1a over vertex and index data, for meshes that don't come from the factory
+Uint64 MeshFactory::hashMesh(Primitive const &mesh) {
+  Uint64 hash = 0xcbf29ce484222325ull;
+  Uint8 const *bytes = reinterpret_cast<Uint8 const*>(mesh.vertices.data());
+  for (size_t i=0; i < mesh.vertices.size() * sizeof(RenderVertex); i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  bytes = reinterpret_cast<Uint8 const*>(mesh.indices.data());
+  for (size_t i=0; i < mesh.indices.size() * sizeof(Uint32); i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+Primitive const& MeshFactory::rect2d(float w, float h, float z) {
+  Params p = { MS_Rect2d, { w, h, z, 0.0f } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::rect2d(w, h, z));
+}
+
+Primitive const& MeshFactory::regPolygon2d(float radius, Uint16 sides, float z) {
+  Params p = { MS_RegPolygon2d, { radius, (float)sides, z, 0.0f } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::regPolygon2d(radius, sides, z));
+}
+
+Primitive const& MeshFactory::torus2d(float outerRadius, float innerRadius, Uint16 sides, float z) {
+  Params p = { MS_Torus2d, { outerRadius, innerRadius, (float)sides, z } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::torus2d(outerRadius, innerRadius, sides, z));
+}
+
+Primitive const& MeshFactory::cube(float w, float h, float d) {
+  Params p = { MS_Cube, { w, h, d, 0.0f } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::cube(w, h, d));
+}
+
+Primitive const& MeshFactory::cylinder(float r, float h, Uint16 sides) {
+  Params p = { MS_Cylinder, { r, h, (float)sides, 0.0f } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::cylinder(r, h, sides));
+}
+
+Primitive const& MeshFactory::tube(float outerRadius, float innerRadius, float h, Uint16 sides) {
+  Params p = { MS_Tube, { outerRadius, innerRadius, h, (float)sides } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::tube(outerRadius, innerRadius, h, sides));
+}
+
+Primitive const& MeshFactory::sphere(float r, Uint16 sides, Uint16 slices) {
+  Params p = { MS_Sphere, { r, (float)sides, (float)slices, 0.0f } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::sphere(r, sides, slices));
+}
+
+Primitive const& MeshFactory::hemisphere(float r, Uint16 sides, Uint16 slices) {
+  Params p = { MS_Hemisphere, { r, (float)sides, (float)slices, 0.0f } };
+  Primitive const *prim = lookup(p);
+  return prim != NULL ? *prim : store(p, App::hemisphere(r, sides, slices));
+}
+
+#pragma region Detail chains
+
+// lower levels stop once halving would go under these
+static const Uint16 MIN_LOD_SIDES = 6;
+static const Uint16 MIN_LOD_SLICES = 3;
+
+static Uint32 triangleCount(Primitive const &mesh) {
+  return (mesh.useIndices ? mesh.indices.size() : mesh.vertices.size()) / 3;
+}
+
+static Uint16 halveDetail(Uint16 n, Uint16 minimum) {
+  return n / 2 >= minimum ? n / 2 : n;
+}
+
+// largest gap between an arc of radius r and its chords when split into segments
+static float chordError(float r, Uint16 segments, float arc) {
+  return r * (1.0f - SDL_cosf(arc / (2.0f * segments)));
+}
+
+MeshLodChain MeshFactory::cylinderLods(float r, float h, Uint16 sides) {
+  MeshLodChain chain;
+  while (true) {
+    float error = chain.empty() ? 0.0f : chordError(r, sides, 2.0f * SDL_PI_F);
+    chain.push_back(MeshLod { &cylinder(r, h, sides), error });
+    Uint16 next = halveDetail(sides, MIN_LOD_SIDES);
+    if (next == sides || chain.size() == MAX_MESH_LODS) break;
+    sides = next;
+  }
+  return chain;
+}
+
+MeshLodChain MeshFactory::tubeLods(float outerRadius, float innerRadius, float h, Uint16 sides) {
+  MeshLodChain chain;
+  while (true) {
+    float error = chain.empty() ? 0.0f : chordError(outerRadius, sides, 2.0f * SDL_PI_F);
+    chain.push_back(MeshLod { &tube(outerRadius, innerRadius, h, sides), error });
+    Uint16 next = halveDetail(sides, MIN_LOD_SIDES);
+    if (next == sides || chain.size() == MAX_MESH_LODS) break;
+    sides = next;
+  }
+  return chain;
+}
+
+MeshLodChain MeshFactory::sphereLods(float r, Uint16 sides, Uint16 slices) {
+  MeshLodChain chain;
+  while (true) {
+    float error = SDL_max(chordError(r, sides, 2.0f * SDL_PI_F), chordError(r, slices, SDL_PI_F));
+    chain.push_back(MeshLod { &sphere(r, sides, slices), chain.empty() ? 0.0f : error });
+    Uint16 nextSides = halveDetail(sides, MIN_LOD_SIDES);
+    Uint16 nextSlices = halveDetail(slices, MIN_LOD_SLICES);
+    if ((nextSides == sides && nextSlices == slices) || chain.size() == MAX_MESH_LODS) break;
+    sides = nextSides;
+    slices = nextSlices;
+  }
+  return chain;
+}
+
+MeshLodChain MeshFactory::hemisphereLods(float r, Uint16 sides, Uint16 slices) {
+  MeshLodChain chain;
+  while (true) {
+    float error = SDL_max(chordError(r, sides, 2.0f * SDL_PI_F), chordError(r, slices, SDL_PI_F / 2.0f));
+    chain.push_back(MeshLod { &hemisphere(r, sides, slices), chain.empty() ? 0.0f : error });
+    Uint16 nextSides = halveDetail(sides, MIN_LOD_SIDES);
+    Uint16 nextSlices = halveDetail(slices, MIN_LOD_SLICES);
+    if ((nextSides == sides && nextSlices == slices) || chain.size() == MAX_MESH_LODS) break;
+    sides = nextSides;
+    slices = nextSlices;
+  }
+  return chain;
+}
+
+// each level aims for half the triangles of the one before and is simplified from
+// the full mesh, so its error is measured against it. the chain ends early once a
+// level saves less than a quarter of the triangles. mesh has to outlive the chain
+MeshLodChain MeshFactory::simplifiedLods(Primitive const &mesh) {
+  Uint64 source = mesh.key != 0 ? mesh.key : hashMesh(mesh);
+  MeshLodChain chain;
+  chain.push_back(MeshLod { &mesh, 0.0f });
+  Uint32 triangles = triangleCount(mesh);
+  for (Uint32 level=1; level < MAX_MESH_LODS; level++) {
+    Params p = { MS_Simplified, { 0.0f, 0.0f, (float)level, 0.0f } };
+    SDL_memcpy(p.values, &source, sizeof(source));
+    Primitive const *prim = lookup(p);
+    if (prim == NULL) {
+      Primitive simplified;
+      float error = simplifyMesh(mesh, triangles >> level, simplified);
+      prim = &store(p, std::move(simplified));
+      cache.at(prim->key).error = error;
+    }
+    Uint32 levelTriangles = triangleCount(*prim);
+    if (levelTriangles == 0 || levelTriangles * 4 > triangleCount(*chain.back().mesh) * 3) break;
+    chain.push_back(MeshLod { prim, cache.at(prim->key).error });
+  }
+  return chain;
+}
+
+#pragma endregion Detail chains
+
+void MeshFactory::logStats() const {
+  SDL_Log(
+    "Meshes: %d generated (%d vertices, %d indices), %d requests served from cache",
+    stats.generated, stats.vertices, stats.indices, stats.hits
+  );
+  MeshOptStats const &opt = stats.optimized;
+  if (opt.triangles == 0) return;
+  SDL_Log(
+    "Meshes: optimized %d triangles, %d -> %d vertices, ACMR %.2f -> %.2f, ATVR %.2f -> %.2f",
+    opt.triangles, opt.verticesBefore, opt.verticesAfter,
+    opt.acmrBefore(), opt.acmrAfter(), opt.atvrBefore(), opt.atvrAfter()
+  );
+}
+
+void MeshFactory::clear() {
+  cache.clear();
+  stats = MeshFactoryStats();
+}
+
+static MeshFactory *meshFactory = NULL;
+
+MeshFactory* App::getMeshFactory() {
+  if (meshFactory == NULL) meshFactory = new MeshFactory();
+  return meshFactory;
+}
+
+void App::destroyMeshFactory() {
+  delete meshFactory;
+  meshFactory = NULL;
+}
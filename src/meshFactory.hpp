@@ -0,0 +1,86 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+#include "util.hpp"
+#include "meshOptimizer.hpp"
+
+namespace App {
+  enum MeshShape {
+    MS_Rect2d,
+    MS_RegPolygon2d,
+    MS_Torus2d,
+    MS_Cube,
+    MS_Cylinder,
+    MS_Tube,
+    MS_Sphere,
+    MS_Hemisphere,
+    MS_Simplified
+  };
+  // one level of a detail chain. error is how far the level strays from the
+  // full mesh in mesh units, 0 for the full mesh
+  struct MeshLod {
+    Primitive const *mesh;
+    float error;
+  };
+  // finest level first
+  typedef std::vector<MeshLod> MeshLodChain;
+  static const Uint32 MAX_MESH_LODS = 4;
+  struct MeshFactoryStats {
+    Uint32 hits = 0;
+    Uint32 generated = 0;
+    Uint32 vertices = 0;
+    Uint32 indices = 0;
+    // totals of the optimization pass, see meshOptimizer.hpp
+    MeshOptStats optimized;
+  };
+  // memoizes the primitive generators by shape and parameters. returned
+  // primitives stay valid until clear() and carry a key that lets
+  // ObjectPipeline::uploadObject reuse buffers it already holds
+  class MeshFactory {
+  public:
+    Primitive const& rect2d(float w, float h, float z);
+    Primitive const& regPolygon2d(float radius, Uint16 sides, float z);
+    Primitive const& torus2d(float outerRadius, float innerRadius, Uint16 sides, float z);
+    Primitive const& cube(float w, float h, float d);
+    Primitive const& cylinder(float r, float h, Uint16 sides);
+    Primitive const& tube(float outerRadius, float innerRadius, float h, Uint16 sides);
+    Primitive const& sphere(float r, Uint16 sides, Uint16 slices);
+    Primitive const& hemisphere(float r, Uint16 sides, Uint16 slices);
+    // detail chains halving the tessellation per level
+    MeshLodChain cylinderLods(float r, float h, Uint16 sides);
+    MeshLodChain tubeLods(float outerRadius, float innerRadius, float h, Uint16 sides);
+    MeshLodChain sphereLods(float r, Uint16 sides, Uint16 slices);
+    MeshLodChain hemisphereLods(float r, Uint16 sides, Uint16 slices);
+    // detail chain for any other mesh, coarser levels come from simplifyMesh
+    MeshLodChain simplifiedLods(Primitive const &mesh);
+    void logStats() const;
+    void clear();
+    MeshFactoryStats stats;
+    // weld and reorder generated meshes for the vertex cache before caching them
+    bool optimize = true;
+    // meshes at least this big get their optimization logged on their own
+    static const Uint32 HEAVY_MESH_TRIANGLES = 4096;
+  private:
+    struct Params {
+      Uint32 shape;
+      float values[4];
+      bool operator==(Params const &other) const;
+    };
+    struct Entry {
+      Params params;
+      Primitive prim;
+      // MS_Simplified levels keep their error so cached chains come back whole
+      float error = 0.0f;
+    };
+    static Uint64 hashParams(Params const &p);
+    Uint64 keyFor(Params const &p) const;
+    static Uint64 hashMesh(Primitive const &mesh);
+    Primitive const* lookup(Params const &p);
+    Primitive const& store(Params const &p, Primitive &&prim);
+    std::unordered_map<Uint64, Entry> cache;
+  };
+  MeshFactory* getMeshFactory();
+  void destroyMeshFactory();
+}
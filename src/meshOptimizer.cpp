@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include "meshOptimizer.hpp"
+#include "profiler.hpp"
+
+using namespace App;
+
+Uint32 App::vertexCacheMisses(std::vector<Uint32> const &indices, Uint32 vertexCount, Uint32 cacheSize) {
+  // a vertex is cached while fewer than cacheSize misses happened since it was loaded
+  std::vector<Uint32> loaded(vertexCount, 0);
+  Uint32 clock = cacheSize + 1;
+  Uint32 misses = 0;
+  for (Uint32 v : indices) {
+    if (clock - loaded[v] <= cacheSize) continue;
+    loaded[v] = clock++;
+    misses++;
+  }
+  return misses;
+}
+
+#pragma region Welding
+
+struct VertexHash {
+  size_t operator()(RenderVertex const &v) const {
+    Uint8 const *bytes = reinterpret_cast<Uint8 const*>(&v);
+    Uint64 hash = 0xcbf29ce484222325ull;
+    for (size_t i=0; i < sizeof(RenderVertex); i++) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ull;
+    }
+    return (size_t)hash;
+  }
+};
+
+struct VertexEqual {
+  bool operator()(RenderVertex const &a, RenderVertex const &b) const {
+    return SDL_memcmp(&a, &b, sizeof(RenderVertex)) == 0;
+  }
+};
+
+// merge bit identical vertices, indices are rewritten to the first copy
+static void weldVertices(Primitive &prim) {
+  std::unordered_map<RenderVertex, Uint32, VertexHash, VertexEqual> seen;
+  seen.reserve(prim.vertices.size());
+  std::vector<RenderVertex> welded;
+  welded.reserve(prim.vertices.size());
+  std::vector<Uint32> remap(prim.vertices.size());
+  for (Uint32 i=0; i < prim.vertices.size(); i++) {
+    auto it = seen.emplace(prim.vertices[i], (Uint32)welded.size());
+    if (it.second) welded.push_back(prim.vertices[i]);
+    remap[i] = it.first->second;
+  }
+  for (Uint32 &index : prim.indices) index = remap[index];
+  prim.vertices = std::move(welded);
+}
+
+#pragma endregion Welding
+
+#pragma region Triangle order
+
+// tipsify (Sander et al. 2007). fans around the most recently cached vertex that
+// still has triangles left, jumping elsewhere only at dead ends. the jumps split
+// the output into clusters that can be reordered without hurting the cache much
+static std::vector<Uint32> tipsify(
+  std::vector<Uint32> const &indices, Uint32 vertexCount, Uint32 cacheSize, std::vector<Uint32> &clusters
+) {
+  Uint32 triCount = indices.size() / 3;
+  // triangles around each vertex
+  std::vector<Uint32> live(vertexCount, 0);
+  for (Uint32 v : indices) live[v]++;
+  std::vector<Uint32> offsets(vertexCount + 1, 0);
+  for (Uint32 v=0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+  std::vector<Uint32> adjacency(indices.size());
+  std::vector<Uint32> fill(offsets.begin(), offsets.end() - 1);
+  for (Uint32 i=0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = i / 3;
+
+  std::vector<Uint32> cacheTime(vertexCount, 0);
+  std::vector<Uint8> emitted(triCount, 0);
+  std::vector<Uint32> deadEnd;
+  std::vector<Uint32> candidates;
+  std::vector<Uint32> out;
+  out.reserve(indices.size());
+  clusters.clear();
+  clusters.push_back(0);
+
+  Uint32 stamp = cacheSize + 1;
+  Uint32 cursor = 0;
+  Sint64 fan = vertexCount > 0 ? 0 : -1;
+  while (fan >= 0) {
+    candidates.clear();
+    for (Uint32 a=offsets[fan]; a < offsets[fan + 1]; a++) {
+      Uint32 t = adjacency[a];
+      if (emitted[t]) continue;
+      emitted[t] = 1;
+      for (int k=0; k < 3; k++) {
+        Uint32 v = indices[t * 3 + k];
+        out.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (stamp - cacheTime[v] > cacheSize) cacheTime[v] = stamp++;
+      }
+    }
+    // prefer the candidate that stays in the cache longest while its fan is emitted
+    Sint64 next = -1;
+    Sint64 bestPriority = -1;
+    for (Uint32 v : candidates) {
+      if (live[v] == 0) continue;
+      Sint64 priority = 0;
+      if (stamp - cacheTime[v] + 2 * live[v] <= cacheSize) priority = stamp - cacheTime[v];
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        next = v;
+      }
+    }
+    if (next < 0) {
+      // dead end, try recently used vertices before scanning for any left
+      while (!deadEnd.empty() && next < 0) {
+        Uint32 v = deadEnd.back();
+        deadEnd.pop_back();
+        if (live[v] > 0) next = v;
+      }
+      while (next < 0 && cursor < vertexCount) {
+        if (live[cursor] > 0) next = cursor;
+        cursor++;
+      }
+      if (next >= 0 && out.size() / 3 > clusters.back()) clusters.push_back(out.size() / 3);
+    }
+    fan = next;
+  }
+  return out;
+}
+
+// sort clusters so triangles facing away from the mesh center draw first, a cheap
+// view independent front to back order for convex-ish meshes
+static std::vector<Uint32> sortClusters(
+  std::vector<Uint32> const &indices, std::vector<RenderVertex> const &vertices, std::vector<Uint32> const &clusters
+) {
+  Uint32 triCount = indices.size() / 3;
+  glm::vec3 meshCenter = glm::vec3(0.0f);
+  for (RenderVertex const &v : vertices) meshCenter += v.pos;
+  if (!vertices.empty()) meshCenter /= (float)vertices.size();
+
+  struct Cluster {
+    Uint32 first;
+    Uint32 count;
+    float sortKey;
+  };
+  std::vector<Cluster> order;
+  order.reserve(clusters.size());
+  for (Uint32 c=0; c < clusters.size(); c++) {
+    Uint32 first = clusters[c];
+    Uint32 end = c + 1 < clusters.size() ? clusters[c + 1] : triCount;
+    glm::vec3 center = glm::vec3(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);
+    for (Uint32 t=first; t < end; t++) {
+      glm::vec3 a = vertices[indices[t * 3]].pos;
+      glm::vec3 b = vertices[indices[t * 3 + 1]].pos;
+      glm::vec3 d = vertices[indices[t * 3 + 2]].pos;
+      center += (a + b + d) / 3.0f;
+      // area weighted
+      normal += glm::cross(b - a, d - a);
+    }
+    center /= (float)(end - first);
+    float len = glm::length(normal);
+    float key = len > 0.0f ? glm::dot(center - meshCenter, normal / len) : 0.0f;
+    order.push_back(Cluster { first, end - first, key });
+  }
+  std::stable_sort(order.begin(), order.end(), [](Cluster const &a, Cluster const &b) {
+    return a.sortKey > b.sortKey;
+  });
+
+  std::vector<Uint32> out;
+  out.reserve(indices.size());
+  for (Cluster const &c : order) {
+    out.insert(out.end(), indices.begin() + c.first * 3, indices.begin() + (c.first + c.count) * 3);
+  }
+  return out;
+}
+
+#pragma endregion Triangle order
+
+// renumber vertices in the order the indices first reach them
+static void reorderForFetch(Primitive &prim) {
+  std::vector<Uint32> remap(prim.vertices.size(), UINT32_MAX);
+  std::vector<RenderVertex> ordered;
+  ordered.reserve(prim.vertices.size());
+  for (Uint32 &index : prim.indices) {
+    if (remap[index] == UINT32_MAX) {
+      remap[index] = ordered.size();
+      ordered.push_back(prim.vertices[index]);
+    }
+    index = remap[index];
+  }
+  prim.vertices = std::move(ordered);
+}
+
+#pragma region Simplification
+
+// one pass of vertex clustering with cubic cells of cellSize starting at lo
+static float clusterVertices(
+  Primitive const &src, std::vector<Uint32> const &indices, glm::vec3 lo, float cellSize, Primitive &out
+) {
+  struct Cluster {
+    glm::vec3 pos;
+    glm::vec2 uv;
+    glm::vec3 normal;
+    Uint32 count;
+  };
+  std::unordered_map<Uint64, Uint32> ids;
+  ids.reserve(src.vertices.size());
+  std::vector<Cluster> clusters;
+  std::vector<Uint32> clusterOf(src.vertices.size());
+  std::vector<Uint64> cellOf(src.vertices.size());
+  for (Uint32 i=0; i < src.vertices.size(); i++) {
+    RenderVertex const &v = src.vertices[i];
+    Uint64 cell = 0;
+    for (int k=0; k < 3; k++) {
+      Uint64 c = (Uint64)SDL_max((v.pos[k] - lo[k]) / cellSize, 0.0f);
+      cell = (cell << 20) | SDL_min(c, (Uint64)0xFFFFF);
+    }
+    // split each cell by the axis the normal mostly points along
+    int axis = 0;
+    glm::vec3 n = glm::abs(v.normal);
+    if (n.y > n[axis]) axis = 1;
+    if (n.z > n[axis]) axis = 2;
+    Uint64 bucket = axis * 2 + (v.normal[axis] < 0.0f ? 1 : 0);
+    auto it = ids.emplace(cell * 6 + bucket, (Uint32)clusters.size());
+    if (it.second) clusters.push_back(Cluster { glm::vec3(0.0f), glm::vec2(0.0f), glm::vec3(0.0f), 0 });
+    Cluster &c = clusters[it.first->second];
+    c.pos += v.pos;
+    c.uv += v.uv;
+    c.normal += v.normal;
+    c.count++;
+    clusterOf[i] = it.first->second;
+    cellOf[i] = cell;
+  }
+
+  out.vertices.resize(clusters.size());
+  for (Uint32 i=0; i < clusters.size(); i++) {
+    Cluster const &c = clusters[i];
+    float len = glm::length(c.normal);
+    out.vertices[i] = RenderVertex {
+      c.pos / (float)c.count,
+      c.uv / (float)c.count,
+      len > 0.0f ? c.normal / len : c.normal,
+    };
+  }
+  float error = 0.0f;
+  for (Uint32 i=0; i < src.vertices.size(); i++) {
+    error = SDL_max(error, glm::distance(src.vertices[i].pos, out.vertices[clusterOf[i]].pos));
+  }
+
+  // triangles with two corners in one cell collapse, clustering also leaves
+  // copies of the same triangle behind
+  bool dedupe = clusters.size() < (1u << 21);
+  std::unordered_set<Uint64> seen;
+  out.indices.clear();
+  out.useIndices = true;
+  for (Uint32 t=0; t + 2 < indices.size(); t += 3) {
+    Uint32 a = indices[t], b = indices[t + 1], c = indices[t + 2];
+    if (cellOf[a] == cellOf[b] || cellOf[b] == cellOf[c] || cellOf[a] == cellOf[c]) continue;
+    Uint32 tri[3] = { clusterOf[a], clusterOf[b], clusterOf[c] };
+    if (dedupe) {
+      // rotate the smallest id first so the key keeps the winding
+      int first = tri[0] < tri[1] ? (tri[0] < tri[2] ? 0 : 2) : (tri[1] < tri[2] ? 1 : 2);
+      Uint64 key = 0;
+      for (int k=0; k < 3; k++) key = (key << 21) | tri[(first + k) % 3];
+      if (!seen.insert(key).second) continue;
+    }
+    out.indices.insert(out.indices.end(), tri, tri + 3);
+  }
+  return error;
+}
+
+// binary searches the grid resolution for the finest clustering that gets
+// under the triangle budget
+float App::simplifyMesh(Primitive const &src, Uint32 targetTriangles, Primitive &out) {
+  PROFILE_ZONE("simplifyMesh");
+  std::vector<Uint32> indices = src.indices;
+  if (!src.useIndices) {
+    indices.resize(src.vertices.size());
+    for (Uint32 i=0; i < indices.size(); i++) indices[i] = i;
+  }
+  out = Primitive {};
+  if (src.vertices.empty()) return 0.0f;
+  glm::vec3 lo = src.vertices[0].pos;
+  glm::vec3 hi = lo;
+  for (RenderVertex const &v : src.vertices) {
+    lo = glm::min(lo, v.pos);
+    hi = glm::max(hi, v.pos);
+  }
+  float extent = SDL_max(SDL_max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z);
+  if (extent <= 0.0f || indices.size() / 3 <= targetTriangles) {
+    out = Primitive { src.vertices, indices, true };
+    return 0.0f;
+  }
+
+  Primitive attempt;
+  float error = 0.0f;
+  Uint32 minCells = 1;
+  Uint32 maxCells = 1024;
+  while (minCells <= maxCells) {
+    Uint32 cells = (minCells + maxCells) / 2;
+    float attemptError = clusterVertices(src, indices, lo, extent / cells, attempt);
+    if (attempt.indices.size() / 3 <= targetTriangles) {
+      out = attempt;
+      error = attemptError;
+      minCells = cells + 1;
+    } else {
+      maxCells = cells - 1;
+    }
+  }
+  return error;
+}
+
+#pragma endregion Simplification
+
+MeshOptStats App::optimizeMesh(Primitive &prim, Uint32 cacheSize) {
+  PROFILE_ZONE("optimizeMesh");
+  MeshOptStats stats;
+  stats.verticesBefore = prim.vertices.size();
+  // non-indexed lists transform every vertex they list
+  if (!prim.useIndices) {
+    prim.indices.resize(prim.vertices.size());
+    for (Uint32 i=0; i < prim.indices.size(); i++) prim.indices[i] = i;
+    prim.useIndices = true;
+    stats.missesBefore = prim.vertices.size();
+  } else {
+    stats.missesBefore = vertexCacheMisses(prim.indices, prim.vertices.size(), cacheSize);
+  }
+  stats.triangles = prim.indices.size() / 3;
+  if (prim.indices.size() % 3 != 0 || prim.indices.empty()) {
+    stats.verticesAfter = prim.vertices.size();
+    stats.missesAfter = stats.missesBefore;
+    return stats;
+  }
+
+  weldVertices(prim);
+  Uint32 vertexCount = prim.vertices.size();
+  Uint32 weldedMisses = vertexCacheMisses(prim.indices, vertexCount, cacheSize);
+  std::vector<Uint32> clusters;
+  std::vector<Uint32> cacheOrder = tipsify(prim.indices, vertexCount, cacheSize, clusters);
+  Uint32 cacheMisses = vertexCacheMisses(cacheOrder, vertexCount, cacheSize);
+  // only keep the overdraw order while it costs under 5% more vertex shading
+  std::vector<Uint32> depthOrder = sortClusters(cacheOrder, prim.vertices, clusters);
+  Uint32 depthMisses = vertexCacheMisses(depthOrder, vertexCount, cacheSize);
+  if ((float)depthMisses <= (float)cacheMisses * 1.05f && depthMisses <= weldedMisses) {
+    prim.indices = std::move(depthOrder);
+  } else if (cacheMisses <= weldedMisses) {
+    prim.indices = std::move(cacheOrder);
+  }
+  reorderForFetch(prim);
+
+  stats.verticesAfter = prim.vertices.size();
+  stats.missesAfter = vertexCacheMisses(prim.indices, prim.vertices.size(), cacheSize);
+  return stats;
+}
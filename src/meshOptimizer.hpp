@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+#include "util.hpp"
+
+namespace App {
+  struct MeshOptStats {
+    Uint32 triangles = 0;
+    Uint32 verticesBefore = 0;
+    Uint32 verticesAfter = 0;
+    // simulated post-transform cache misses, ACMR = misses / triangles, ATVR = misses / vertices
+    Uint32 missesBefore = 0;
+    Uint32 missesAfter = 0;
+    float acmrBefore() const { return triangles > 0 ? (float)missesBefore / triangles : 0.0f; }
+    float acmrAfter() const { return triangles > 0 ? (float)missesAfter / triangles : 0.0f; }
+    float atvrBefore() const { return verticesBefore > 0 ? (float)missesBefore / verticesBefore : 0.0f; }
+    float atvrAfter() const { return verticesAfter > 0 ? (float)missesAfter / verticesAfter : 0.0f; }
+  };
+  // post-transform cache size the triangle order is tuned for
+  static const Uint32 MESH_CACHE_SIZE = 16;
+  // weld identical vertices, reorder triangles for the vertex cache (tipsify) and
+  // front to back by cluster, then renumber vertices in first use order.
+  // non-indexed triangle lists come out indexed
+  MeshOptStats optimizeMesh(Primitive &prim, Uint32 cacheSize = MESH_CACHE_SIZE);
+  // vertex clustering down to at most targetTriangles. vertices are merged per grid
+  // cell and dominant normal axis, so hard edges stay hard. returns how far any vertex
+  // moved, the mesh space error of the result
+  float simplifyMesh(Primitive const &src, Uint32 targetTriangles, Primitive &out);
+  // FIFO cache simulation of drawing the indices
+  Uint32 vertexCacheMisses(std::vector<Uint32> const &indices, Uint32 vertexCount, Uint32 cacheSize = MESH_CACHE_SIZE);
+}
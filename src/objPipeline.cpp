@@ -1,14 +1,23 @@
 #include "objPipeline.hpp"
+#include "gpuBackend.hpp"
+#include "gpuResources.hpp"
+#include "frameArena.hpp"
+#include "stagingRing.hpp"
+#include "jobSystem.hpp"
+#include "profiler.hpp"
 
 using namespace App;
 
 ObjectPipeline::ObjectPipeline(
   SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu,
-  GPUPrimitiveType type, SDL_GPUCullMode cullMode, Uint32 sw, Uint32 sh
+  GPUPrimitiveType type, SDL_GPUCullMode cullMode, Uint32 sw, Uint32 sh,
+  VertexLayout layout
 ) {
   device = gpu;
-  // create shaders
-  SDL_GPUShader *vertShader = App::loadShader(device, "obj.vert", 0, 1, 0, 0);
+  this->layout = layout;
+  bool compact = layout == VL_Compact;
+  // create shaders, compact vertices only need their own vertex stage
+  SDL_GPUShader *vertShader = App::loadShader(device, compact ? "objCompact.vert" : "obj.vert", 0, 1, 0, 0);
   SDL_GPUShader *fragShader = App::loadShader(device, "obj.frag", 1, 1, 0, 0);
 
   // change render type
@@ -23,10 +32,10 @@ ObjectPipeline::ObjectPipeline(
   }
 
   // create pipeline
-	pipeline = SDL_CreateGPUGraphicsPipeline(device, new SDL_GPUGraphicsPipelineCreateInfo {
+	SDL_GPUGraphicsPipelineCreateInfo pipelineInfo = {
 		.vertex_shader = vertShader,
 		.fragment_shader = fragShader,
-    .vertex_input_state = createVertexInputState(),
+    .vertex_input_state = createVertexInputState(layout),
 		.primitive_type = primType,
 		.rasterizer_state = SDL_GPURasterizerState {
 			.fill_mode = fillMode,
@@ -39,7 +48,7 @@ ObjectPipeline::ObjectPipeline(
       .enable_depth_write = true,
     },
 		.target_info = SDL_GPUGraphicsPipelineTargetInfo {
-			.color_target_descriptions = new SDL_GPUColorTargetDescription {
+			.color_target_descriptions = getFrameArena()->make(SDL_GPUColorTargetDescription {
 				.format = targetFormat,
 				.blend_state = SDL_GPUColorTargetBlendState {
 					.src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
@@ -50,15 +59,25 @@ ObjectPipeline::ObjectPipeline(
 					.alpha_blend_op = SDL_GPU_BLENDOP_ADD,
 					.enable_blend = true,
 				},
-			},
+			}),
 			.num_color_targets = 1,
       .depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D16_UNORM,
       .has_depth_stencil_target = true,
 		},
-	});
+	};
+	pipeline = getGPUBackend()->createGraphicsPipeline(device, &pipelineInfo);
+
+  // instanced variant, reads transforms + albedo from a storage buffer
+  SDL_GPUShader *instVertShader = App::loadShader(
+    device, compact ? "objInstancedCompact.vert" : "objInstanced.vert", 0, 1, 1, 0
+  );
+  SDL_GPUShader *instFragShader = App::loadShader(device, "objInstanced.frag", 1, 1, 0, 0);
+  pipelineInfo.vertex_shader = instVertShader;
+  pipelineInfo.fragment_shader = instFragShader;
+  instancedPipeline = getGPUBackend()->createGraphicsPipeline(device, &pipelineInfo);
 
   // create depth texture
-  depthTx = SDL_CreateGPUTexture(device, new SDL_GPUTextureCreateInfo {
+  depthTx = getGPUBackend()->createTexture(device, getFrameArena()->make(SDL_GPUTextureCreateInfo {
     .type = SDL_GPU_TEXTURETYPE_2D,
     .format = SDL_GPU_TEXTUREFORMAT_D16_UNORM,
     .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET,
@@ -66,16 +85,18 @@ ObjectPipeline::ObjectPipeline(
     .height = sh,
     .layer_count_or_depth = 1,
     .num_levels = 1,
-  });
+  }));
 
   // release shaders
-	SDL_ReleaseGPUShader(device, vertShader);
-  SDL_ReleaseGPUShader(device, fragShader);
+	getGPUBackend()->releaseShader(device, vertShader);
+  getGPUBackend()->releaseShader(device, fragShader);
+	getGPUBackend()->releaseShader(device, instVertShader);
+  getGPUBackend()->releaseShader(device, instFragShader);
 }
 
 void ObjectPipeline::resizeScreen(Uint32 w, Uint32 h) {
-  SDL_ReleaseGPUTexture(device, depthTx);
-  depthTx = SDL_CreateGPUTexture(device, new SDL_GPUTextureCreateInfo {
+  getGPUBackend()->releaseTexture(device, depthTx);
+  depthTx = getGPUBackend()->createTexture(device, getFrameArena()->make(SDL_GPUTextureCreateInfo {
     .type = SDL_GPU_TEXTURETYPE_2D,
     .format = SDL_GPU_TEXTUREFORMAT_D16_UNORM,
     .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER | SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET,
@@ -83,61 +104,50 @@ void ObjectPipeline::resizeScreen(Uint32 w, Uint32 h) {
     .height = h,
     .layer_count_or_depth = 1,
     .num_levels = 1,
-  });
+  }));
   cam.viewWidth = (float)w;
   cam.viewHeight = (float)h;
 }
 
-int ObjectPipeline::uploadObject(std::vector<RenderVertex> const &vertices) {
-	// create vertex buffer
-  Uint32 vSize = sizeof(RenderVertex) * vertices.size();
-  SDL_GPUBuffer *vBuffer = SDL_CreateGPUBuffer(device, new SDL_GPUBufferCreateInfo {
+// create a vertex buffer and pack vertices in the pipeline's layout straight
+// into the upload ring, copied on the next frame flush
+GPUHandle ObjectPipeline::uploadVertices(std::vector<RenderVertex> const &vertices, VertexQuantization &quant) {
+  Uint32 vSize = vertexStride(layout) * vertices.size();
+  GPUResourceRegistry *resources = getGPUResources(device);
+  GPUHandle vBuffer = resources->createBuffer(SDL_GPUBufferCreateInfo {
     .usage = SDL_GPU_BUFFERUSAGE_VERTEX,
     .size = vSize
   });
-  // pump vertex data into transfer buffer
-  SDL_GPUTransferBuffer *vertTransferBuf = SDL_CreateGPUTransferBuffer(
-    device,
-    new SDL_GPUTransferBufferCreateInfo {
-      .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-      .size = vSize,
-    }
-  );
-  RenderVertex* vertData = static_cast<RenderVertex*>(SDL_MapGPUTransferBuffer(
-    device, vertTransferBuf, false
-  ));
-  for (int i=0; i < vertices.size(); i++) {
-    vertData[i] = vertices.at(i);
+  void *dst = getStagingRing(device)->stage(resources->buffer(vBuffer), 0, vSize, false);
+  if (dst != NULL) quant = packVertices(layout, vertices.data(), vertices.size(), dst);
+  return vBuffer;
+}
+
+// create an index buffer and stage the indices, narrowed unless wide
+GPUHandle ObjectPipeline::uploadIndices(std::vector<Uint32> const &indices, bool wide) {
+  Uint32 iSize = (wide ? sizeof(Uint32) : sizeof(Uint16)) * indices.size();
+  GPUResourceRegistry *resources = getGPUResources(device);
+  GPUHandle iBuffer = resources->createBuffer(SDL_GPUBufferCreateInfo {
+    .usage = SDL_GPU_BUFFERUSAGE_INDEX,
+    .size = iSize
+  });
+
+  // stage index data, copied on the next frame flush
+  void *dst = getStagingRing(device)->stage(resources->buffer(iBuffer), 0, iSize, false);
+  if (dst != NULL && wide) {
+    SDL_memcpy(dst, indices.data(), iSize);
+  } else if (dst != NULL) {
+    Uint16 *narrow = static_cast<Uint16*>(dst);
+    for (Uint32 i=0; i < indices.size(); i++) narrow[i] = (Uint16)indices[i];
   }
-  SDL_UnmapGPUTransferBuffer(device, vertTransferBuf);
-
-  // create cmd buffer + copy pass
-	SDL_GPUCommandBuffer *cmdBuf = SDL_AcquireGPUCommandBuffer(device);
-	SDL_GPUCopyPass *copyPass = SDL_BeginGPUCopyPass(cmdBuf);
-  // upload vertex buffer
-  SDL_UploadToGPUBuffer(
-    copyPass,
-    new SDL_GPUTransferBufferLocation {
-      .transfer_buffer = vertTransferBuf,
-      .offset = 0,
-    },
-    new SDL_GPUBufferRegion {
-      .buffer = vBuffer,
-      .offset = 0,
-      .size = vSize,
-    },
-    false
-  );
-  // clean up passes
-	SDL_EndGPUCopyPass(copyPass);
-	if (!SDL_SubmitGPUCommandBuffer(cmdBuf)) {
-    SDL_Log("Failed to upload to buffer - %s", SDL_GetError());
-  };
-  // release transfer buffers
-  SDL_ReleaseGPUTransferBuffer(device, vertTransferBuf);
-
-  // create placeholder texture + sampler
-  SDL_GPUTexture *tx = SDL_CreateGPUTexture(device, new SDL_GPUTextureCreateInfo {
+  return iBuffer;
+}
+
+// every object starts on the same placeholder texture and sampler, the
+// registry creates them once per device and counts the users
+void ObjectPipeline::attachDefaults(RenderObject &obj) {
+  GPUResourceRegistry *resources = getGPUResources(device);
+  obj.textureHandle = resources->acquireTexture(SDL_GPUTextureCreateInfo {
     .type = SDL_GPU_TEXTURETYPE_2D,
     .format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
     .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER,
@@ -146,7 +156,7 @@ int ObjectPipeline::uploadObject(std::vector<RenderVertex> const &vertices) {
     .layer_count_or_depth = 1,
     .num_levels = 1,
   });
-  SDL_GPUSampler *sm = SDL_CreateGPUSampler(device, new SDL_GPUSamplerCreateInfo {
+  obj.samplerHandle = resources->acquireSampler(SDL_GPUSamplerCreateInfo {
     .min_filter = SDL_GPU_FILTER_LINEAR,
     .mag_filter = SDL_GPU_FILTER_LINEAR,
     .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_LINEAR,
@@ -154,158 +164,175 @@ int ObjectPipeline::uploadObject(std::vector<RenderVertex> const &vertices) {
     .address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
     .address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE
   });
+  obj.texture = resources->texture(obj.textureHandle);
+  obj.sampler = resources->sampler(obj.samplerHandle);
+  trackTexture(obj.texture);
+}
+
+int ObjectPipeline::uploadObject(std::vector<RenderVertex> const &vertices) {
+	// create vertex buffer
+  VertexQuantization quant;
+  GPUHandle vBuffer = uploadVertices(vertices, quant);
 
   // create object
   int id = robjs.size();
   robjs.push_back(RenderObject {
     .id = id,
+    .meshId = id,
     .visible = true,
-    .vertexBuffer = vBuffer,
+    .vertexBuffer = getGPUResources(device)->buffer(vBuffer),
     .vertexCount = (int)(vertices.size()),
     .indexCount = 0,
-    .sampler = sm,
-    .texture = tx,
+    .quant = quant,
+    .bounds = computeBounds(vertices.data(), vertices.size()),
+    .vertexHandle = vBuffer,
   });
+  attachDefaults(robjs.back());
   return id;
 }
 
-int ObjectPipeline::uploadObject(std::vector<RenderVertex> const &vertices, std::vector<Uint16> const &indices) {
-  // create vertex buffer
-  Uint32 vSize = sizeof(RenderVertex) * vertices.size();
-  SDL_GPUBuffer *vBuffer = SDL_CreateGPUBuffer(device, new SDL_GPUBufferCreateInfo {
-    .usage = SDL_GPU_BUFFERUSAGE_VERTEX,
-    .size = vSize
-  });
-  // create index buffer
-  Uint32 iSize = sizeof(Uint16) * indices.size();
-  SDL_GPUBuffer *iBuffer = SDL_CreateGPUBuffer(device, new SDL_GPUBufferCreateInfo {
-    .usage = SDL_GPU_BUFFERUSAGE_INDEX,
-    .size = iSize
-  });
-
-  // pump vertex data into transfer buffer
-  SDL_GPUTransferBuffer *vertTransferBuf = SDL_CreateGPUTransferBuffer(
-    device,
-    new SDL_GPUTransferBufferCreateInfo {
-      .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-      .size = vSize,
-    }
-  );
-  RenderVertex* vertData = static_cast<RenderVertex*>(SDL_MapGPUTransferBuffer(
-    device, vertTransferBuf, false
-  ));
-  for (int i=0; i < vertices.size(); i++) {
-    vertData[i] = vertices.at(i);
+int ObjectPipeline::uploadObject(std::vector<RenderVertex> const &vertices, std::vector<Uint32> const &indices) {
+  // out of range indices would draw garbage, refuse the mesh instead
+  Uint32 maxIndex = 0;
+  for (Uint32 index : indices) maxIndex = SDL_max(maxIndex, index);
+  if (!indices.empty() && maxIndex >= vertices.size()) {
+    SDL_Log("ERR: Mesh index %d out of range for %d vertices", maxIndex, (int)vertices.size());
+    return -1;
   }
-  SDL_UnmapGPUTransferBuffer(device, vertTransferBuf);
-
-  // pump index data into transfer buffer
-  SDL_GPUTransferBuffer *idxTransferBuf = SDL_CreateGPUTransferBuffer(
-    device,
-    new SDL_GPUTransferBufferCreateInfo {
-      .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-      .size = iSize,
-    }
-  );
-  Uint16* indexData = static_cast<Uint16*>(SDL_MapGPUTransferBuffer(
-    device, idxTransferBuf, false
-  ));
-  for (int i=0; i < indices.size(); i++) {
-    indexData[i] = indices.at(i);
-  }
-  SDL_UnmapGPUTransferBuffer(device, idxTransferBuf);
-
-  // create cmd buffer + copy pass
-	SDL_GPUCommandBuffer *cmdBuf = SDL_AcquireGPUCommandBuffer(device);
-	SDL_GPUCopyPass *copyPass = SDL_BeginGPUCopyPass(cmdBuf);
-
-  // upload vertex buffer
-  SDL_UploadToGPUBuffer(
-    copyPass,
-    new SDL_GPUTransferBufferLocation {
-      .transfer_buffer = vertTransferBuf,
-      .offset = 0,
-    },
-    new SDL_GPUBufferRegion {
-      .buffer = vBuffer,
-      .offset = 0,
-      .size = vSize,
-    },
-    false
-  );
-  // upload index buffer
-  SDL_UploadToGPUBuffer(
-    copyPass,
-    new SDL_GPUTransferBufferLocation {
-      .transfer_buffer = idxTransferBuf,
-      .offset = 0,
-    },
-    new SDL_GPUBufferRegion {
-      .buffer = iBuffer,
-      .offset = 0,
-      .size = iSize,
-    },
-    false
-  );
-
-  // clean up passes
-	SDL_EndGPUCopyPass(copyPass);
-	if (!SDL_SubmitGPUCommandBuffer(cmdBuf)) {
-    SDL_Log("Failed to upload to buffers - %s", SDL_GetError());
-  };
-  // release transfer buffers
-  SDL_ReleaseGPUTransferBuffer(device, vertTransferBuf);
-  SDL_ReleaseGPUTransferBuffer(device, idxTransferBuf);
-
-  
-  // create placeholder texture + sampler
-  SDL_GPUTexture *tx = SDL_CreateGPUTexture(device, new SDL_GPUTextureCreateInfo {
-    .type = SDL_GPU_TEXTURETYPE_2D,
-    .format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
-    .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER,
-    .width = 1,
-    .height = 1,
-    .layer_count_or_depth = 1,
-    .num_levels = 1,
-  });
-  SDL_GPUSampler *sm = SDL_CreateGPUSampler(device, new SDL_GPUSamplerCreateInfo {
-    .min_filter = SDL_GPU_FILTER_LINEAR,
-    .mag_filter = SDL_GPU_FILTER_LINEAR,
-    .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_LINEAR,
-    .address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
-    .address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
-    .address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE
-  });
+  // create vertex buffer
+  VertexQuantization quant;
+  GPUHandle vBuffer = uploadVertices(vertices, quant);
+  // create index buffer, 16 bit unless an index needs more.
+  // 0xFFFF is left out so it can never be read as a strip restart
+  bool wide = maxIndex >= 0xFFFF;
+  GPUHandle iBuffer = uploadIndices(indices, wide);
 
   // create object
+  GPUResourceRegistry *resources = getGPUResources(device);
   int id = robjs.size();
   robjs.push_back(RenderObject {
     .id = id,
+    .meshId = id,
     .visible = true,
-    .vertexBuffer = vBuffer,
-    .indexBuffer = iBuffer,
+    .vertexBuffer = resources->buffer(vBuffer),
+    .indexBuffer = resources->buffer(iBuffer),
     .vertexCount = (int)(vertices.size()),
     .indexCount = (int)(indices.size()),
-    .sampler = sm,
-    .texture = tx,
+    .indexSize = wide ? SDL_GPU_INDEXELEMENTSIZE_32BIT : SDL_GPU_INDEXELEMENTSIZE_16BIT,
+    .quant = quant,
+    .bounds = computeBounds(vertices.data(), vertices.size()),
+    .vertexHandle = vBuffer,
+    .indexHandle = iBuffer,
   });
+  attachDefaults(robjs.back());
   return id;
 }
 
+// shapes from the mesh factory are uploaded once, later uploads of the
+// same shape become instances sharing its buffers
 int ObjectPipeline::uploadObject(Primitive const &shape) {
-  if (shape.useIndices) {
-    return uploadObject(shape.vertices, shape.indices);
+  if (shape.key != 0) {
+    auto it = meshCache.find(shape.key);
+    if (it != meshCache.end()) return addInstance(it->second);
+  }
+  int id = shape.useIndices ? uploadObject(shape.vertices, shape.indices) : uploadObject(shape.vertices);
+  if (shape.key != 0 && id >= 0) meshCache[shape.key] = id;
+  return id;
+}
+
+// buffers only, lower levels share the owner's texture and sampler
+void ObjectPipeline::uploadLevel(Primitive const &shape, MeshLevel &level) {
+  GPUResourceRegistry *resources = getGPUResources(device);
+  level.vertexHandle = uploadVertices(shape.vertices, level.quant);
+  level.vertexBuffer = resources->buffer(level.vertexHandle);
+  level.vertexCount = shape.vertices.size();
+  if (!shape.useIndices) return;
+  Uint32 maxIndex = 0;
+  for (Uint32 index : shape.indices) maxIndex = SDL_max(maxIndex, index);
+  bool wide = maxIndex >= 0xFFFF;
+  level.indexHandle = uploadIndices(shape.indices, wide);
+  level.indexBuffer = resources->buffer(level.indexHandle);
+  level.indexCount = shape.indices.size();
+  level.indexSize = wide ? SDL_GPU_INDEXELEMENTSIZE_32BIT : SDL_GPU_INDEXELEMENTSIZE_16BIT;
+}
+
+// the finest level becomes the object like any other upload, coarser levels
+// are kept on the side for prepare() to swap in. chains attach to the mesh
+// owner once, so instances of it share them. the chain holds its own
+// references, the finest level included
+int ObjectPipeline::uploadObject(MeshLodChain const &lods) {
+  if (lods.empty()) return -1;
+  int id = uploadObject(*lods[0].mesh);
+  if (id < 0 || lods.size() == 1) return id;
+  int meshId = robjs[id].meshId;
+  if (lodChains.find(meshId) != lodChains.end()) return id;
+
+  RenderObject const &owner = robjs[meshId];
+  GPUResourceRegistry *resources = getGPUResources(device);
+  resources->retain(owner.vertexHandle);
+  resources->retain(owner.indexHandle);
+  std::vector<MeshLevel> &chain = lodChains[meshId];
+  chain.reserve(lods.size());
+  chain.push_back(MeshLevel {
+    .vertexBuffer = owner.vertexBuffer,
+    .indexBuffer = owner.indexBuffer,
+    .vertexHandle = owner.vertexHandle,
+    .indexHandle = owner.indexHandle,
+    .vertexCount = owner.vertexCount,
+    .indexCount = owner.indexCount,
+    .indexSize = owner.indexSize,
+    .quant = owner.quant,
+    .error = 0.0f,
+  });
+  for (Uint32 i=1; i < lods.size(); i++) {
+    MeshLevel level;
+    uploadLevel(*lods[i].mesh, level);
+    level.error = lods[i].error;
+    chain.push_back(level);
   }
-  return uploadObject(shape.vertices);
+  return id;
+}
+
+// create another object drawing the same gpu buffers as meshId
+int ObjectPipeline::addInstance(int meshId) {
+  if (meshId < 0 || meshId >= robjs.size()) {
+    SDL_Log("ERR: Tried to instance render object that doesn't exist %d", meshId);
+    return -1;
+  }
+  RenderObject obj = robjs.at(robjs.at(meshId).meshId);
+  obj.id = robjs.size();
+  GPUResourceRegistry *resources = getGPUResources(device);
+  resources->retain(obj.vertexHandle);
+  resources->retain(obj.indexHandle);
+  resources->retain(obj.samplerHandle);
+  resources->retain(obj.textureHandle);
+  robjs.push_back(obj);
+  return obj.id;
 }
 
 void ObjectPipeline::addTextureToObject(int id, SDL_GPUTexture *texture) {
-  if (id >= robjs.size()) {
+  if (id < 0 || id >= robjs.size()) {
     SDL_Log("ERR: Tried to access render object that doesn't exist %d", id);
     return;
   }
-  SDL_ReleaseGPUTexture(device, robjs.at(id).texture);
-  robjs.at(id).texture = texture;
+  if (texture == NULL) {
+    SDL_Log("ERR: Tried to add a NULL texture to render object %d", id);
+    return;
+  }
+  RenderObject &obj = robjs.at(id);
+  // the pipeline takes over the texture. the old one may still be bound by
+  // other objects, it only goes with the last reference
+  GPUResourceRegistry *resources = getGPUResources(device);
+  GPUHandle handle = resources->adoptTexture(texture);
+  resources->release(obj.textureHandle);
+  obj.textureHandle = handle;
+  obj.texture = texture;
+  trackTexture(texture);
+}
+
+// small ids for the sort keys, in the order textures are first seen
+void ObjectPipeline::trackTexture(SDL_GPUTexture *texture) {
+  textureIds.emplace(texture, (Uint32)textureIds.size());
 }
 
 RenderObject& ObjectPipeline::getObject(int id) {
@@ -317,6 +344,11 @@ glm::mat4x4 modelMatrix(RenderObject const &obj) {
   glm::mat4x4 model = glm::translate(id, obj.pos);
   model = glm::rotate(model, obj.rotAngleRad, obj.rotAxis);
   model = glm::scale(model, obj.scale);
+  // compact meshes are stored in a unit cube around their bounds
+  if (obj.quant.scale != 1.0f || obj.quant.offset != glm::vec3(0.0f)) {
+    model = glm::translate(model, obj.quant.offset);
+    model = glm::scale(model, glm::vec3(obj.quant.scale));
+  }
   return model;
 }
 
@@ -334,74 +366,314 @@ glm::mat4x4 projMatrix(RenderCamera const &cam) {
   }
 }
 
+// pixels covered by one mesh unit at the object's distance
+static float pixelsPerUnit(RenderCamera const &cam, RenderObject const &obj) {
+  float scale = SDL_max(SDL_max(SDL_fabsf(obj.scale.x), SDL_fabsf(obj.scale.y)), SDL_fabsf(obj.scale.z));
+  // the ortho projection maps one unit to one pixel
+  if (!cam.perspective) return scale;
+  float dist = SDL_max(glm::distance(cam.pos, obj.pos), cam.near);
+  return scale * cam.viewHeight / (2.0f * dist * SDL_tanf(cam.fovY / 2.0f));
+}
+
+// coarsest level whose error stays under the pixel limit. moving to a coarser
+// level needs a margin below the limit, so objects sitting on a threshold
+// don't flicker between two levels. finer levels are picked right away
+static Uint8 selectLod(std::vector<MeshLevel> const &chain, Uint8 current, float pixels, float limit, float hysteresis) {
+  Uint8 level = 0;
+  for (Uint8 i=1; i < chain.size(); i++) {
+    if (chain[i].error * pixels <= limit) level = i;
+  }
+  while (level > current && chain[level].error * pixels > limit * (1.0f - hysteresis)) level--;
+  return level;
+}
+
+// swap each object's buffers to the level its screen size calls for
+void ObjectPipeline::selectLods() {
+  if (lodChains.empty()) return;
+  PROFILE_ZONE("ObjectPipeline::selectLods");
+  getJobSystem()->parallelFor(robjs.size(), 256, [this](Uint32 begin, Uint32 end) {
+    for (Uint32 i=begin; i < end; i++) {
+      RenderObject &obj = robjs[i];
+      if (!obj.visible) continue;
+      auto it = lodChains.find(obj.meshId);
+      if (it == lodChains.end()) continue;
+      std::vector<MeshLevel> const &chain = it->second;
+      Uint8 level = selectLod(chain, obj.lod, pixelsPerUnit(cam, obj), lodPixelError, lodHysteresis);
+      if (level == obj.lod) continue;
+      MeshLevel const &mesh = chain[level];
+      obj.lod = level;
+      obj.vertexBuffer = mesh.vertexBuffer;
+      obj.indexBuffer = mesh.indexBuffer;
+      obj.vertexCount = mesh.vertexCount;
+      obj.indexCount = mesh.indexCount;
+      obj.indexSize = mesh.indexSize;
+      obj.quant = mesh.quant;
+    }
+  });
+}
+
+// see renderQueue.hpp for the key layouts
+Uint64 ObjectPipeline::sortKey(RenderObject const &obj, glm::vec3 forward) const {
+  auto it = textureIds.find(obj.texture);
+  Uint32 texture = it != textureIds.end() ? it->second : 0;
+  // detail chains have at most 4 levels
+  Uint32 mesh = ((Uint32)obj.meshId << 2) | obj.lod;
+  float depth = glm::dot(obj.pos - cam.pos, forward) / cam.far;
+  if (obj.albedo.a < 1.0f) return translucentSortKey(texture, mesh, depth);
+  return opaqueSortKey(texture, mesh, depth);
+}
+
+// visible objects in draw order. opaque ones are grouped by texture and mesh
+// and front to back within a group, translucent ones follow back to front
+void ObjectPipeline::buildQueue() {
+  PROFILE_ZONE("ObjectPipeline::buildQueue");
+  FrameVector<int> order(getFrameArena());
+  order.reserve(robjs.size());
+  for (RenderObject const &obj : robjs) {
+    if (!obj.visible || !inView(obj.id)) continue;
+    if (obj.vertexBuffer == NULL) {
+      SDL_Log("ERR: Missing vertex data for object %d", obj.id);
+      continue;
+    }
+    order.push_back(obj.id);
+  }
+  queue.resize(order.size());
+  glm::vec3 forward = glm::normalize(cam.lookAt - cam.pos);
+  getJobSystem()->parallelFor(order.size(), 1024, [this, &order, forward](Uint32 begin, Uint32 end) {
+    for (Uint32 i=begin; i < end; i++) queue.set(i, sortKey(robjs[order[i]], forward), order[i]);
+  });
+  queue.sort();
+}
+
+// move each object's bounds to world space and test them against the camera
+void ObjectPipeline::cullObjects() {
+  PROFILE_ZONE("ObjectPipeline::cullObjects");
+  Uint32 count = robjs.size();
+  culler.resize(count);
+  inFrustum.resize(count);
+  getJobSystem()->parallelFor(count, 256, [this](Uint32 begin, Uint32 end) {
+    for (Uint32 i=begin; i < end; i++) {
+      RenderObject const &obj = robjs[i];
+      glm::mat3x3 rs = glm::mat3x3(glm::rotate(glm::mat4x4(1.0f), obj.rotAngleRad, obj.rotAxis));
+      for (int c=0; c < 3; c++) rs[c] *= obj.scale[c];
+      // box of the rotated box, each column of |rs| spreads one extent over the world axes
+      glm::vec3 const &e = obj.bounds.extents;
+      glm::vec3 extents = glm::abs(rs[0]) * e.x + glm::abs(rs[1]) * e.y + glm::abs(rs[2]) * e.z;
+      glm::vec3 scale = glm::abs(obj.scale);
+      float radius = obj.bounds.radius * SDL_max(SDL_max(scale.x, scale.y), scale.z);
+      culler.set(i, obj.pos + rs * obj.bounds.center, radius, extents);
+    }
+  });
+  culler.cull(extractFrustum(projMatrix(cam) * viewMatrix(cam)), inFrustum.data());
+  culledCount = 0;
+  for (Uint32 i=0; i < count; i++) {
+    if (robjs[i].visible && inFrustum[i] == 0) culledCount++;
+  }
+}
+
+// pick detail levels and cull, then group visible objects by mesh + texture and
+// stage their instance data. must run before the frame flush when instancing is
+// enabled, and every frame for objects uploaded with a detail chain or culling
+void ObjectPipeline::prepare() {
+  PROFILE_ZONE("ObjectPipeline::prepare");
+  batches.clear();
+  selectLods();
+  if (frustumCulling) {
+    cullObjects();
+  } else {
+    inFrustum.clear();
+    culledCount = 0;
+  }
+  if (!instancing) return;
+
+  buildQueue();
+  if (queue.size() == 0) return;
+
+  // grow instance storage geometrically
+  Uint32 count = queue.size();
+  if (count > instanceCapacity) {
+    if (instanceBuf != NULL) getGPUBackend()->releaseBuffer(device, instanceBuf);
+    instanceCapacity = SDL_max(count, instanceCapacity * 2);
+    SDL_GPUBufferCreateInfo info = {
+      .usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+      .size = (Uint32)(sizeof(InstanceData) * instanceCapacity),
+    };
+    instanceBuf = getGPUBackend()->createBuffer(device, &info);
+  }
+  InstanceData *data = static_cast<InstanceData*>(getStagingRing(device)->stage(
+    instanceBuf, 0, sizeof(InstanceData) * count, true
+  ));
+  if (data == NULL) return;
+
+  getJobSystem()->parallelFor(count, 256, [this, data](Uint32 begin, Uint32 end) {
+    for (Uint32 i=begin; i < end; i++) {
+      RenderObject const &obj = robjs[queue[i]];
+      data[i] = InstanceData { modelMatrix(obj), obj.albedo };
+    }
+  });
+  // runs of the same mesh and texture in queue order become one draw
+  for (Uint32 i=0; i < count; i++) {
+    RenderObject const &obj = robjs[queue[i]];
+    if (!batches.empty()) {
+      RenderObject const &head = robjs[batches.back().objId];
+      if (head.meshId == obj.meshId && head.lod == obj.lod && head.texture == obj.texture) {
+        batches.back().count++;
+        continue;
+      }
+    }
+    batches.push_back(InstanceBatch { obj.id, i, 1 });
+  }
+}
+
+// binds the object's mesh and texture, skipping whatever the last draw already bound
+void ObjectPipeline::bindObject(SDL_GPURenderPass *pass, RenderObject const &obj, BoundState &bound) {
+  if (obj.vertexBuffer != bound.vertices) {
+    SDL_GPUBufferBinding vBinding = { .buffer = obj.vertexBuffer, .offset = 0 };
+    getGPUBackend()->bindVertexBuffers(pass, 0, &vBinding, 1);
+    bound.vertices = obj.vertexBuffer;
+    stats.binds++;
+  } else {
+    stats.bindsSkipped++;
+  }
+  if (obj.texture != bound.texture || obj.sampler != bound.sampler) {
+    SDL_GPUTextureSamplerBinding txBinding = { .texture = obj.texture, .sampler = obj.sampler };
+    getGPUBackend()->bindFragmentSamplers(pass, 0, &txBinding, 1);
+    bound.texture = obj.texture;
+    bound.sampler = obj.sampler;
+    stats.binds++;
+  } else {
+    stats.bindsSkipped++;
+  }
+  if (obj.indexCount == 0) return;
+  if (obj.indexBuffer != bound.indices) {
+    SDL_GPUBufferBinding iBinding = { .buffer = obj.indexBuffer, .offset = 0 };
+    getGPUBackend()->bindIndexBuffer(pass, &iBinding, obj.indexSize);
+    bound.indices = obj.indexBuffer;
+    stats.binds++;
+  } else {
+    stats.bindsSkipped++;
+  }
+}
+
 void ObjectPipeline::render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* target, LightMaterial const &light) {
-  SDL_GPURenderPass *pass = SDL_BeginGPURenderPass(cmdBuf, new SDL_GPUColorTargetInfo {
+  PROFILE_ZONE("ObjectPipeline::render");
+  stats = ObjectRenderStats {};
+  stats.culled = culledCount;
+  SDL_GPURenderPass *pass = getGPUBackend()->beginRenderPass(cmdBuf, getFrameArena()->make(SDL_GPUColorTargetInfo {
 		.texture = target,
 		.clear_color = SDL_FColor{ 0.02f, 0.02f, 0.08f, 1.0f },
 		.load_op = SDL_GPU_LOADOP_LOAD,
 		.store_op = SDL_GPU_STOREOP_STORE,
-	}, 1, new SDL_GPUDepthStencilTargetInfo {
+	}), 1, getFrameArena()->make(SDL_GPUDepthStencilTargetInfo {
     .texture = depthTx,
     .clear_depth = 1,
     .load_op = SDL_GPU_LOADOP_CLEAR,
     .store_op = SDL_GPU_STOREOP_STORE,
-  });
-  SDL_BindGPUGraphicsPipeline(pass, pipeline);
+  }));
   // build view/proj matrices early
   glm::mat4x4 view = viewMatrix(cam);
   glm::mat4x4 proj = projMatrix(cam);
+  PhongMaterial phong = PhongMaterial(light);
+  phong.cameraPos = cam.pos;
 
-  // handle each object separately
-  for (RenderObject const &obj : robjs) {
-    if (!obj.visible) continue;
-    if (obj.vertexBuffer == NULL) {
-      SDL_Log("ERR: Missing vertex data for object %d", obj.id);
-      continue;
+  BoundState bound;
+  if (instancing) {
+    getGPUBackend()->bindGraphicsPipeline(pass, instancedPipeline);
+    if (!batches.empty()) {
+      getGPUBackend()->bindVertexStorageBuffers(pass, 0, &instanceBuf, 1);
+      getGPUBackend()->pushFragmentUniformData(cmdBuf, 0, &phong, sizeof(PhongMaterial));
+      stats.uniformPushes++;
     }
-    SDL_BindGPUVertexBuffers(pass, 0, new SDL_GPUBufferBinding {
-      .buffer = obj.vertexBuffer,
-      .offset = 0,
-    }, 1);
+    InstanceUniforms uniforms = { view, proj };
+    // one draw per mesh/texture group
+    for (InstanceBatch const &batch : batches) {
+      RenderObject const &obj = robjs[batch.objId];
+      bindObject(pass, obj, bound);
+      uniforms.baseInstance = batch.first;
+      getGPUBackend()->pushVertexUniformData(cmdBuf, 0, &uniforms, sizeof(InstanceUniforms));
+      stats.uniformPushes++;
+      if (obj.indexCount > 0) {
+        getGPUBackend()->drawIndexedPrimitives(pass, obj.indexCount, batch.count, 0, 0, 0);
+        stats.vertices += obj.indexCount * batch.count;
+      } else {
+        getGPUBackend()->drawPrimitives(pass, obj.vertexCount, batch.count, 0, 0);
+        stats.vertices += obj.vertexCount * batch.count;
+      }
+      stats.drawCalls++;
+      stats.instances += batch.count;
+    }
+    getGPUBackend()->endRenderPass(pass);
+    return;
+  }
+
+  getGPUBackend()->bindGraphicsPipeline(pass, pipeline);
+  buildQueue();
+  // model matrices don't depend on each other, build them up front
+  models.resize(robjs.size());
+  getJobSystem()->parallelFor(robjs.size(), 256, [this](Uint32 begin, Uint32 end) {
+    for (Uint32 i=begin; i < end; i++) {
+      if (robjs[i].visible) models[i] = modelMatrix(robjs[i]);
+    }
+  });
+  // one draw per object in queue order, material only pushed when it changes
+  bool materialPushed = false;
+  for (Uint32 i=0; i < queue.size(); i++) {
+    RenderObject const &obj = robjs[queue[i]];
+    bindObject(pass, obj, bound);
     // build matrices
-    glm::mat4x4 matrices[3] = { modelMatrix(obj), view, proj };
-    SDL_PushGPUVertexUniformData(cmdBuf, 0, &matrices, sizeof(matrices));
-    // upload texture
-    SDL_BindGPUFragmentSamplers(pass, 0, new SDL_GPUTextureSamplerBinding {
-      .texture = obj.texture,
-      .sampler = obj.sampler
-    }, 1);
+    glm::mat4x4 matrices[3] = { models[obj.id], view, proj };
+    getGPUBackend()->pushVertexUniformData(cmdBuf, 0, &matrices, sizeof(matrices));
+    stats.uniformPushes++;
     // upload material
-    PhongMaterial phong = PhongMaterial(light);
-    phong.albedo = obj.albedo;
-    phong.cameraPos = cam.pos;
-    SDL_PushGPUFragmentUniformData(cmdBuf, 0, &phong, sizeof(PhongMaterial));
+    if (!materialPushed || SDL_memcmp(&phong.albedo, &obj.albedo, sizeof(SDL_FColor)) != 0) {
+      phong.albedo = obj.albedo;
+      getGPUBackend()->pushFragmentUniformData(cmdBuf, 0, &phong, sizeof(PhongMaterial));
+      stats.uniformPushes++;
+      materialPushed = true;
+    }
     // draw
     if (obj.indexCount > 0) {
-      SDL_BindGPUIndexBuffer(pass, new SDL_GPUBufferBinding {
-        .buffer = obj.indexBuffer,
-        .offset = 0,
-      }, SDL_GPU_INDEXELEMENTSIZE_16BIT);
-      SDL_DrawGPUIndexedPrimitives(pass, obj.indexCount, 1, 0, 0, 0);
+      getGPUBackend()->drawIndexedPrimitives(pass, obj.indexCount, 1, 0, 0, 0);
+      stats.vertices += obj.indexCount;
     } else {
-      SDL_DrawGPUPrimitives(pass, obj.vertexCount, 1, 0, 0);
+      getGPUBackend()->drawPrimitives(pass, obj.vertexCount, 1, 0, 0);
+      stats.vertices += obj.vertexCount;
     }
+    stats.drawCalls++;
+    stats.instances++;
   }
   // end pass
-  SDL_EndGPURenderPass(pass);
+  getGPUBackend()->endRenderPass(pass);
 }
 
 void ObjectPipeline::clearObjects() {
-  for (int i=0; i<robjs.size(); i++) {
-    if (robjs[i].vertexBuffer != NULL) SDL_ReleaseGPUBuffer(device, robjs[i].vertexBuffer);
-    if (robjs[i].indexBuffer != NULL) SDL_ReleaseGPUBuffer(device, robjs[i].indexBuffer);
-    if (robjs[i].texture != NULL) SDL_ReleaseGPUTexture(device, robjs[i].texture);
-    if (robjs[i].sampler != NULL) SDL_ReleaseGPUSampler(device, robjs[i].sampler);
+  // instances and chains hold their own references, whatever is shared
+  // goes with the last of them
+  GPUResourceRegistry *resources = getGPUResources(device);
+  for (RenderObject const &obj : robjs) {
+    resources->release(obj.vertexHandle);
+    resources->release(obj.indexHandle);
+    resources->release(obj.samplerHandle);
+    resources->release(obj.textureHandle);
+  }
+  for (auto const &chain : lodChains) {
+    for (MeshLevel const &level : chain.second) {
+      resources->release(level.vertexHandle);
+      resources->release(level.indexHandle);
+    }
   }
   robjs.clear();
+  meshCache.clear();
+  lodChains.clear();
+  inFrustum.clear();
+  textureIds.clear();
+  batches.clear();
 }
 
 void ObjectPipeline::destroy() {
   clearObjects();
-  SDL_ReleaseGPUTexture(device, depthTx);
-  SDL_ReleaseGPUGraphicsPipeline(device, pipeline);
+  if (instanceBuf != NULL) getGPUBackend()->releaseBuffer(device, instanceBuf);
+  getGPUBackend()->releaseTexture(device, depthTx);
+  getGPUBackend()->releaseGraphicsPipeline(device, pipeline);
+  getGPUBackend()->releaseGraphicsPipeline(device, instancedPipeline);
 }
\ No newline at end of file
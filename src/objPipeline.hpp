@@ -1,3 +1,4 @@
+#include <unordered_map>
 #include <vector>
 #include <SDL3/SDL.h>
 #include <glm/vec2.hpp>
@@ -7,6 +8,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "util.hpp"
+#include "meshFactory.hpp"
+#include "frustum.hpp"
+#include "renderQueue.hpp"
 
 namespace App {
   struct LightMaterial {
@@ -23,26 +27,116 @@ namespace App {
     glm::vec3 cameraPos = glm::vec3(0.0f);
     PhongMaterial(LightMaterial const &parent) : LightMaterial(parent) {};
   };
+  // per-instance data read by objInstanced.vert
+  struct InstanceData {
+    glm::mat4x4 model;
+    SDL_FColor albedo;
+  };
+  struct InstanceUniforms {
+    glm::mat4x4 view;
+    glm::mat4x4 proj;
+    Uint32 baseInstance = 0;
+    Uint32 padding[3] = {0, 0, 0};
+  };
+  struct InstanceBatch {
+    int objId; // first object in the batch, provides the mesh bindings
+    Uint32 first;
+    Uint32 count;
+  };
+  struct ObjectRenderStats {
+    Uint32 drawCalls = 0;
+    Uint32 instances = 0;
+    Uint32 uniformPushes = 0;
+    // vertices submitted over all draws and instances
+    Uint32 vertices = 0;
+    // visible objects left out for being outside the camera frustum
+    Uint32 culled = 0;
+    // vertex, index and sampler binds issued, and the ones the draw order made redundant
+    Uint32 binds = 0;
+    Uint32 bindsSkipped = 0;
+  };
+  // gpu buffers of one level in a mesh's detail chain
+  struct MeshLevel {
+    SDL_GPUBuffer *vertexBuffer = NULL;
+    SDL_GPUBuffer *indexBuffer = NULL;
+    GPUHandle vertexHandle;
+    GPUHandle indexHandle;
+    int vertexCount = 0;
+    int indexCount = 0;
+    SDL_GPUIndexElementSize indexSize = SDL_GPU_INDEXELEMENTSIZE_16BIT;
+    VertexQuantization quant;
+    float error = 0.0f;
+  };
   class ObjectPipeline {
   public:
     ObjectPipeline(
       SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu,
-      GPUPrimitiveType type, SDL_GPUCullMode cullMode, Uint32 sw, Uint32 sh
+      GPUPrimitiveType type, SDL_GPUCullMode cullMode, Uint32 sw, Uint32 sh,
+      VertexLayout layout = VL_Float
     );
     void resizeScreen(Uint32 w, Uint32 h);
     int uploadObject(std::vector<RenderVertex> const &vertices);
-    int uploadObject(std::vector<RenderVertex> const &vertices, std::vector<Uint16> const &indices);
+    int uploadObject(std::vector<RenderVertex> const &vertices, std::vector<Uint32> const &indices);
     int uploadObject(Primitive const &shape);
+    // uploads every level, prepare() then draws the coarsest one that fits the screen
+    int uploadObject(MeshLodChain const &lods);
+    int addInstance(int meshId);
     void addTextureToObject(int id, SDL_GPUTexture *texture);
     RenderObject& getObject(int id);
+    void prepare();
     void render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* target, LightMaterial const &light);
     void clearObjects();
     void destroy();
     RenderCamera cam;
+    // draw objects that share a mesh in one call, requires prepare() each frame
+    bool instancing = false;
+    ObjectRenderStats stats;
+    VertexLayout layout;
+    // a level is used while its error covers at most this many pixels on screen
+    float lodPixelError = 1.0f;
+    // going to a coarser level needs the error this much under the limit
+    float lodHysteresis = 0.25f;
+    // skip objects outside the camera frustum, tested in prepare()
+    bool frustumCulling = true;
   private:
+    GPUHandle uploadVertices(std::vector<RenderVertex> const &vertices, VertexQuantization &quant);
+    GPUHandle uploadIndices(std::vector<Uint32> const &indices, bool wide);
+    void attachDefaults(RenderObject &obj);
+    void uploadLevel(Primitive const &shape, MeshLevel &level);
+    void selectLods();
+    void cullObjects();
+    bool inView(int id) const { return id >= inFrustum.size() || inFrustum[id] != 0; }
+    // draw state of the current pass
+    struct BoundState {
+      SDL_GPUBuffer *vertices = NULL;
+      SDL_GPUBuffer *indices = NULL;
+      SDL_GPUTexture *texture = NULL;
+      SDL_GPUSampler *sampler = NULL;
+    };
+    void trackTexture(SDL_GPUTexture *texture);
+    Uint64 sortKey(RenderObject const &obj, glm::vec3 forward) const;
+    void buildQueue();
+    void bindObject(SDL_GPURenderPass *pass, RenderObject const &obj, BoundState &bound);
     std::vector<RenderObject> robjs;
+    // Primitive::key -> object owning the uploaded buffers
+    std::unordered_map<Uint64, int> meshCache;
+    // mesh owner -> detail chain, level 0 is the owner's own upload
+    std::unordered_map<int, std::vector<MeshLevel>> lodChains;
+    // world bounds of every object and the result of the last test, empty when not culling
+    FrustumCuller culler;
+    std::vector<Uint8> inFrustum;
+    Uint32 culledCount = 0;
+    // visible objects in draw order, rebuilt each frame
+    RenderQueue queue;
+    std::unordered_map<SDL_GPUTexture*, Uint32> textureIds;
     SDL_GPUDevice *device = NULL;
     SDL_GPUGraphicsPipeline *pipeline = NULL;
+    SDL_GPUGraphicsPipeline *instancedPipeline = NULL;
+    // instancing resources
+    SDL_GPUBuffer *instanceBuf = NULL;
+    Uint32 instanceCapacity = 0;
+    std::vector<InstanceBatch> batches;
+    std::vector<glm::mat4x4> models;
     SDL_GPUTexture *depthTx = NULL;
   };
 }
\ No newline at end of file
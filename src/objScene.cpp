@@ -11,13 +11,14 @@ ObjScene::ObjScene(SDL_GPUDevice *gpu, SDL_GPUTextureFormat targetFormat) : Scen
     .fovY = degToRad(60.0f),
   };
 
-  int obj1id = objPipe->uploadObject(tube(80.0f, 40.0f, 100.0f, 18));
+  // detail drops as the tube moves away (Q/E)
+  int obj1id = objPipe->uploadObject(getMeshFactory()->tubeLods(80.0f, 40.0f, 100.0f, 48));
   RenderObject &obj1 = objPipe->getObject(obj1id);
   obj1.albedo = CYAN;
   obj1.rotAxis = glm::vec3(0.0f, 1.0f, 0.0f);
   obj1.rotAngleRad = 0.5f;
 
-  int obj2id = objPipe->uploadObject(cube(150.0f, 100.0f, 100.0f));
+  int obj2id = objPipe->uploadObject(getMeshFactory()->cube(150.0f, 100.0f, 100.0f));
   RenderObject &obj2 = objPipe->getObject(obj2id);
   obj2.albedo = GREEN;
   obj2.pos = glm::vec3(200.0f, -200.0f, -100.0f);
@@ -59,6 +60,7 @@ SDL_AppResult ObjScene::update(SystemUpdates const &sys) {
     objPipe->cam.pos.x += 100.0f * sys.deltaTime;
     objPipe->cam.lookAt.x += 100.0f * sys.deltaTime;
   }
+  objPipe->prepare();
 
   return SDL_APP_CONTINUE;
 }
@@ -73,6 +75,15 @@ SDL_AppResult ObjScene::render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* scr
   return SDL_APP_CONTINUE;
 }
 
+std::string ObjScene::debugInfo() {
+  char str[100];
+  SDL_snprintf(
+    str, sizeof(str), "Tube LOD %d, %d vertices drawn",
+    objPipe->getObject(0).lod, objPipe->stats.vertices
+  );
+  return str;
+}
+
 void ObjScene::destroy() {
   objPipe->destroy();
   delete objPipe;
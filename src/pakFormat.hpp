@@ -0,0 +1,94 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+// on-disk layouts of assets.pak and the shader bundle, shared by the app and pack-tool.
+// all fields are little endian
+//
+// [PakHeader][PakEntry * entryCount][names][pad]
+// [payload 0][pad][payload 1][pad]...
+//
+// entries are sorted by name hash for binary search, names are
+// null terminated paths used to resolve hash collisions.
+// payloads start on an `alignment` boundary so they can be mapped directly.
+//
+// entries flagged PAK_FLAG_LZ store their payload as
+// [PakChunkTable][Uint32 chunkEnds * chunkCount][chunk 0][chunk 1]...
+// where every chunk holds chunkSize bytes of the asset (the last may be
+// shorter) as an independent LZ4 block. chunkEnds are byte offsets past the
+// end of each chunk, relative to the first chunk. a chunk whose stored size
+// equals its raw size didn't compress and is kept as is.
+// entry size is always the uncompressed size
+namespace App {
+  static const Uint32 PAK_MAGIC = 0x324B4150; // "PAK2"
+  static const Uint32 PAK_VERSION = 2;
+  static const Uint32 PAK_ALIGNMENT = 4096;
+  static const Uint32 PAK_FLAG_LZ = 1;
+  static const Uint32 PAK_CHUNK_SIZE = 64 * 1024;
+
+  struct PakHeader {
+    Uint32 magic = PAK_MAGIC;
+    Uint32 version = PAK_VERSION;
+    Uint32 entryCount = 0;
+    Uint32 alignment = PAK_ALIGNMENT;
+    Uint64 namesOffset = 0;
+    Uint64 namesSize = 0;
+  };
+
+  struct PakEntry {
+    Uint64 hash = 0;
+    Uint64 offset = 0;
+    Uint64 size = 0;
+    Uint32 nameOffset = 0;
+    Uint32 flags = 0;
+  };
+
+  struct PakChunkTable {
+    Uint32 chunkCount = 0;
+    Uint32 chunkSize = PAK_CHUNK_SIZE;
+  };
+
+  // compiled shaders for every stage and format in one blob, read once by
+  // ShaderRegistry. names are the shader source file ("obj.vert"), offsets are
+  // relative to the start of the bundle and identical bytecode is stored once
+  //
+  // [ShaderBundleHeader][ShaderBundleEntry * entryCount][names][code...]
+  static const Uint32 SHADER_BUNDLE_MAGIC = 0x31444853; // "SHD1"
+  static const Uint32 SHADER_BUNDLE_VERSION = 1;
+
+  struct ShaderBundleHeader {
+    Uint32 magic = SHADER_BUNDLE_MAGIC;
+    Uint32 version = SHADER_BUNDLE_VERSION;
+    Uint32 entryCount = 0;
+    Uint32 namesSize = 0;
+  };
+
+  struct ShaderBundleEntry {
+    Uint32 nameOffset = 0;
+    Uint32 stage = 0; // SDL_GPUShaderStage
+    Uint32 format = 0; // SDL_GPUShaderFormat
+    Uint32 reserved = 0;
+    Uint64 codeOffset = 0;
+    Uint64 codeSize = 0;
+  };
+
+  // 64 bit FNV-1a of the asset path
+  inline Uint64 pakHash(const char *name) {
+    Uint64 hash = 0xcbf29ce484222325ull;
+    for (const char *c = name; *c != '\0'; c++) {
+      hash ^= (Uint8)*c;
+      hash *= 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  inline Uint64 pakHash(void const *data, size_t size) {
+    Uint64 hash = 0xcbf29ce484222325ull;
+    Uint8 const *bytes = static_cast<Uint8 const*>(data);
+    for (size_t i=0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ull;
+    }
+    return hash;
+  }
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include "profiler.hpp"
+
+using namespace App;
+
+static const char *FRAME_ZONE = "frame";
+// slots next to the write head may be mid-overwrite, don't read them
+static const Uint32 RING_SLACK = 64;
+static const Uint32 RING_MASK = ProfileRing::SIZE - 1;
+
+static thread_local ProfileRing *localRing = NULL;
+
+ProfileZone::ProfileZone(const char *zoneName) {
+  name = zoneName;
+  ProfileRing *ring = localRing != NULL ? localRing : getProfiler()->threadRing();
+  ring->depth++;
+  start = SDL_GetPerformanceCounter();
+}
+
+ProfileZone::~ProfileZone() {
+  Uint64 end = SDL_GetPerformanceCounter();
+  ProfileRing *ring = localRing;
+  Uint32 head = SDL_GetAtomicU32(&ring->head);
+  ring->depth--;
+  ring->events[head & RING_MASK] = ProfileEvent { name, start, end, ring->depth };
+  SDL_MemoryBarrierRelease();
+  SDL_SetAtomicU32(&ring->head, head + 1);
+}
+
+Profiler::Profiler() {
+  frequency = SDL_GetPerformanceFrequency();
+}
+
+Profiler::~Profiler() {
+  for (ProfileRing *ring : rings) delete ring;
+  localRing = NULL;
+}
+
+// rings are created on a thread's first zone and live as long as the profiler
+ProfileRing* Profiler::threadRing() {
+  if (localRing != NULL) return localRing;
+  ProfileRing *ring = new ProfileRing();
+  SDL_SetAtomicU32(&ring->head, 0);
+  SDL_LockSpinlock(&ringLock);
+  ring->name = "thread " + std::to_string(rings.size());
+  rings.push_back(ring);
+  SDL_UnlockSpinlock(&ringLock);
+  localRing = ring;
+  return ring;
+}
+
+double Profiler::ticksToMs(Uint64 ticks) const {
+  return (double)ticks * 1000.0 / (double)frequency;
+}
+
+static void addToTotals(std::vector<ProfileZoneTotal> &totals, ProfileEvent const &ev, Uint32 depth) {
+  for (ProfileZoneTotal &t : totals) {
+    if (t.name != ev.name || t.depth != depth) continue;
+    t.ticks += ev.end - ev.start;
+    t.calls++;
+    t.firstStart = SDL_min(t.firstStart, ev.start);
+    return;
+  }
+  totals.push_back(ProfileZoneTotal { ev.name, depth, ev.start, ev.end - ev.start, 1 });
+}
+
+void Profiler::endFrame() {
+  Uint64 now = SDL_GetPerformanceCounter();
+  mainRing = threadRing();
+  if (frameStart != 0) {
+    Uint32 head = SDL_GetAtomicU32(&mainRing->head);
+    mainRing->events[head & RING_MASK] = ProfileEvent { FRAME_ZONE, frameStart, now, 0 };
+    SDL_SetAtomicU32(&mainRing->head, head + 1);
+  }
+  frameTicks = frameStart != 0 ? now - frameStart : 0;
+  frameStart = now;
+
+  mainTotals.clear();
+  workerTotals.clear();
+  workerThreads = 0;
+  SDL_LockSpinlock(&ringLock);
+  ringSnapshot.assign(rings.begin(), rings.end());
+  SDL_UnlockSpinlock(&ringLock);
+  for (ProfileRing *ring : ringSnapshot) {
+    Uint32 head = SDL_GetAtomicU32(&ring->head);
+    SDL_MemoryBarrierAcquire();
+    Uint32 from = head - ring->readHead > ProfileRing::SIZE - RING_SLACK ? head - (ProfileRing::SIZE - RING_SLACK) : ring->readHead;
+    bool isMain = ring == mainRing;
+    if (!isMain && from != head) workerThreads++;
+    for (Uint32 i=from; i != head; i++) {
+      ProfileEvent const &ev = ring->events[i & RING_MASK];
+      if (ev.name == FRAME_ZONE) continue;
+      if (isMain) addToTotals(mainTotals, ev, ev.depth);
+      else addToTotals(workerTotals, ev, 0);
+    }
+    ring->readHead = head;
+  }
+  std::sort(mainTotals.begin(), mainTotals.end(), [](ProfileZoneTotal const &a, ProfileZoneTotal const &b) {
+    return a.firstStart < b.firstStart;
+  });
+  std::sort(workerTotals.begin(), workerTotals.end(), [](ProfileZoneTotal const &a, ProfileZoneTotal const &b) {
+    return a.ticks > b.ticks;
+  });
+}
+
+std::string Profiler::breakdown() const {
+#ifdef NO_PROFILER
+  return "Profiler compiled out (NO_PROFILER)";
+#else
+  char line[160];
+  SDL_snprintf(line, sizeof(line), "Frame %.2f ms", ticksToMs(frameTicks));
+  std::string out = line;
+  for (ProfileZoneTotal const &t : mainTotals) {
+    std::string indent((t.depth + 1) * 2, ' ');
+    SDL_snprintf(line, sizeof(line), "\n%s%s %.2f ms", indent.c_str(), t.name, ticksToMs(t.ticks));
+    out += line;
+    if (t.calls > 1) out += " x" + std::to_string(t.calls);
+  }
+  if (!workerTotals.empty()) {
+    SDL_snprintf(line, sizeof(line), "\nJob threads (%d active)", workerThreads);
+    out += line;
+  }
+  for (ProfileZoneTotal const &t : workerTotals) {
+    SDL_snprintf(line, sizeof(line), "\n  %s %.2f ms x%d", t.name, ticksToMs(t.ticks), t.calls);
+    out += line;
+  }
+  return out;
+#endif
+}
+
+// one complete ("X") event per zone, timestamps in microseconds
+bool Profiler::dumpChromeTrace(const char *path) {
+  SDL_IOStream *io = SDL_IOFromFile(path, "w");
+  if (io == NULL) {
+    SDL_Log("ERR: Failed to open %s for the profile trace - %s", path, SDL_GetError());
+    return false;
+  }
+  SDL_LockSpinlock(&ringLock);
+  std::vector<ProfileRing*> current = rings;
+  SDL_UnlockSpinlock(&ringLock);
+
+  Uint64 base = ~0ull;
+  for (ProfileRing *ring : current) {
+    Uint32 head = SDL_GetAtomicU32(&ring->head);
+    Uint32 count = SDL_min(head, ProfileRing::SIZE - RING_SLACK);
+    if (count > 0) base = SDL_min(base, ring->events[(head - count) & RING_MASK].start);
+  }
+  SDL_IOprintf(io, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  Uint32 written = 0;
+  for (size_t tid=0; tid < current.size(); tid++) {
+    ProfileRing *ring = current[tid];
+    SDL_IOprintf(
+      io, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+      tid == 0 ? "" : ",\n", (int)tid, ring->name.c_str()
+    );
+    Uint32 head = SDL_GetAtomicU32(&ring->head);
+    Uint32 count = SDL_min(head, ProfileRing::SIZE - RING_SLACK);
+    for (Uint32 i=head - count; i != head; i++) {
+      ProfileEvent const &ev = ring->events[i & RING_MASK];
+      SDL_IOprintf(
+        io, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+        ev.name, (int)tid, ticksToMs(ev.start - base) * 1000.0, ticksToMs(ev.end - ev.start) * 1000.0
+      );
+      written++;
+    }
+  }
+  SDL_IOprintf(io, "\n]}\n");
+  bool closed = SDL_CloseIO(io);
+  if (!closed) {
+    SDL_Log("ERR: Failed to write profile trace %s - %s", path, SDL_GetError());
+    return false;
+  }
+  SDL_Log("Profiler: wrote %d events from %d threads to %s", written, (int)current.size(), path);
+  return true;
+}
+
+static Profiler *profiler = NULL;
+static SDL_SpinLock profilerLock = 0;
+
+Profiler* App::getProfiler() {
+  SDL_LockSpinlock(&profilerLock);
+  if (profiler == NULL) profiler = new Profiler();
+  SDL_UnlockSpinlock(&profilerLock);
+  return profiler;
+}
+
+// threads must not enter zones once the profiler is gone
+void App::destroyProfiler() {
+  delete profiler;
+  profiler = NULL;
+}
+
+// label for the calling thread in the trace
+void App::setProfileThreadName(const char *name) {
+  getProfiler()->threadRing()->name = name;
+}
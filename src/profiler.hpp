@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <SDL3/SDL.h>
+
+// scoped timing zones, compiled out with -DNO_PROFILER (release.bat)
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifndef NO_PROFILER
+#define PROFILE_ZONE(name) App::ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+namespace App {
+  // name must be a string literal (or otherwise outlive the profiler)
+  struct ProfileEvent {
+    const char *name;
+    Uint64 start;
+    Uint64 end;
+    Uint32 depth;
+  };
+  struct ProfileZoneTotal {
+    const char *name;
+    Uint32 depth;
+    Uint64 firstStart;
+    Uint64 ticks;
+    Uint32 calls;
+  };
+  // events of one thread, written only by that thread
+  struct ProfileRing {
+    static const Uint32 SIZE = 16384;
+    ProfileEvent events[SIZE];
+    SDL_AtomicU32 head;
+    Uint32 readHead = 0;
+    Uint32 depth = 0;
+    std::string name;
+  };
+  class ProfileZone {
+  public:
+    ProfileZone(const char *name);
+    ~ProfileZone();
+  private:
+    const char *name;
+    Uint64 start;
+  };
+  class Profiler {
+  public:
+    Profiler();
+    ~Profiler();
+    ProfileRing* threadRing();
+    // closes the frame zone on the calling (main) thread and totals up its events
+    void endFrame();
+    // per-zone breakdown of the last frame, main thread nested, job threads summed
+    std::string breakdown() const;
+    // every event still held in the rings as chrome://tracing / Perfetto JSON
+    bool dumpChromeTrace(const char *path);
+    std::vector<ProfileZoneTotal> mainTotals;
+    std::vector<ProfileZoneTotal> workerTotals;
+    Uint32 workerThreads = 0;
+  private:
+    double ticksToMs(Uint64 ticks) const;
+    std::vector<ProfileRing*> rings;
+    // copy of rings taken under the lock each frame, kept to reuse its storage
+    std::vector<ProfileRing*> ringSnapshot;
+    SDL_SpinLock ringLock = 0;
+    ProfileRing *mainRing = NULL;
+    Uint64 frameStart = 0;
+    Uint64 frameTicks = 0;
+    Uint64 frequency = 1;
+  };
+  Profiler* getProfiler();
+  void destroyProfiler();
+  void setProfileThreadName(const char *name);
+}
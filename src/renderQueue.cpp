@@ -0,0 +1,53 @@
+#include <utility>
+#include "renderQueue.hpp"
+
+using namespace App;
+
+// depth in [0, 1] from the camera to its far plane, clamped to 24 bits
+static Uint64 quantizeDepth(float depth) {
+  depth = SDL_clamp(depth, 0.0f, 1.0f);
+  return (Uint64)(depth * (float)0xFFFFFF);
+}
+
+Uint64 App::opaqueSortKey(Uint32 texture, Uint32 mesh, float depth) {
+  return ((Uint64)(texture & 0x3FFF) << 49) | ((Uint64)(mesh & 0x1FFFFFF) << 24) | quantizeDepth(depth);
+}
+
+Uint64 App::translucentSortKey(Uint32 texture, Uint32 mesh, float depth) {
+  Uint64 farFirst = 0xFFFFFF - quantizeDepth(depth);
+  return (1ull << 63) | (farFirst << 39) | ((Uint64)(texture & 0x3FFF) << 25) | (Uint64)(mesh & 0x1FFFFFF);
+}
+
+void RenderQueue::resize(Uint32 count) {
+  keys.resize(count);
+  items.resize(count);
+}
+
+void RenderQueue::sort() {
+  Uint32 count = keys.size();
+  if (count < 2) return;
+  scratchKeys.resize(count);
+  scratchItems.resize(count);
+  // histogram every byte in one read
+  Uint32 counts[8][256] = {};
+  for (Uint64 key : keys) {
+    for (int b=0; b < 8; b++) counts[b][(key >> (b * 8)) & 0xFF]++;
+  }
+  for (int b=0; b < 8; b++) {
+    Uint32 shift = b * 8;
+    if (counts[b][(keys[0] >> shift) & 0xFF] == count) continue;
+    Uint32 offsets[256];
+    Uint32 sum = 0;
+    for (int d=0; d < 256; d++) {
+      offsets[d] = sum;
+      sum += counts[b][d];
+    }
+    for (Uint32 i=0; i < count; i++) {
+      Uint32 dst = offsets[(keys[i] >> shift) & 0xFF]++;
+      scratchKeys[dst] = keys[i];
+      scratchItems[dst] = items[i];
+    }
+    std::swap(keys, scratchKeys);
+    std::swap(items, scratchItems);
+  }
+}
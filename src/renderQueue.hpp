@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+
+namespace App {
+  // draw order for one frame as (key, item) pairs sorted by key
+  class RenderQueue {
+  public:
+    void resize(Uint32 count);
+    void set(Uint32 i, Uint64 key, Uint32 item) {
+      keys[i] = key;
+      items[i] = item;
+    }
+    // stable LSD radix sort, 8 bits per pass. bytes that are the same in
+    // every key are skipped, so the depth bits cost nothing when unused
+    void sort();
+    Uint32 size() const { return items.size(); }
+    Uint32 operator[](Uint32 i) const { return items[i]; }
+    Uint64 key(Uint32 i) const { return keys[i]; }
+  private:
+    std::vector<Uint64> keys;
+    std::vector<Uint32> items;
+    std::vector<Uint64> scratchKeys;
+    std::vector<Uint32> scratchItems;
+  };
+  // opaque draws go state first, then front to back for early depth rejection
+  //   63: 0 | 62-49: texture | 48-24: mesh | 23-0: depth
+  Uint64 opaqueSortKey(Uint32 texture, Uint32 mesh, float depth);
+  // translucent draws go after every opaque one, back to front
+  //   63: 1 | 62-39: inverted depth | 38-25: texture | 24-0: mesh
+  Uint64 translucentSortKey(Uint32 texture, Uint32 mesh, float depth);
+}
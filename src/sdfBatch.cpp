@@ -0,0 +1,542 @@
+#include <initializer_list>
+#include "sdfBatch.hpp"
+
+using namespace App;
+
+#pragma region Snapshot
+
+static void clearArrays(std::initializer_list<std::vector<float>*> arrays) {
+  for (std::vector<float> *a : arrays) a->clear();
+}
+
+void SDFBatch::Modifiers::push(SDFRenderObject const &obj) {
+  corner.push_back(obj.cornerRadius);
+  thickness.push_back(obj.thickness);
+}
+
+void SDFBatch::Modifiers::clear() {
+  corner.clear();
+  thickness.clear();
+}
+
+void SDFBatch::build(std::vector<SDFObject> &objs) {
+  circles.clear();
+  lines.clear();
+  triangles.clear();
+  rects.clear();
+  others.clear();
+  clearArrays({ &circles.cx, &circles.cy, &circles.r });
+  clearArrays({ &lines.ax, &lines.ay, &lines.bx, &lines.by, &lines.bax, &lines.bay, &lines.invBB });
+  clearArrays({
+    &triangles.p0x, &triangles.p0y, &triangles.p1x, &triangles.p1y, &triangles.p2x, &triangles.p2y,
+    &triangles.e0x, &triangles.e0y, &triangles.e1x, &triangles.e1y, &triangles.e2x, &triangles.e2y,
+    &triangles.inv0, &triangles.inv1, &triangles.inv2, &triangles.orient
+  });
+  clearArrays({ &rects.cx, &rects.cy, &rects.sx, &rects.sy });
+  objCount = objs.size();
+
+  for (SDFObject &o : objs) {
+    SDFRenderObject obj = o.renderObject();
+    switch (obj.objType) {
+      case 1: {
+        circles.cx.push_back(obj.center.x);
+        circles.cy.push_back(obj.center.y);
+        circles.r.push_back(obj.radius);
+        circles.push(obj);
+        break;
+      }
+      case 2: {
+        glm::vec2 ba = obj.v2 - obj.center;
+        lines.ax.push_back(obj.center.x);
+        lines.ay.push_back(obj.center.y);
+        lines.bx.push_back(obj.v2.x);
+        lines.by.push_back(obj.v2.y);
+        lines.bax.push_back(ba.x);
+        lines.bay.push_back(ba.y);
+        lines.invBB.push_back(1.0f / glm::dot(ba, ba));
+        lines.push(obj);
+        break;
+      }
+      case 3: {
+        glm::vec2 p0 = obj.center;
+        glm::vec2 p1 = obj.v2;
+        glm::vec2 p2 = obj.v3;
+        glm::vec2 e0 = p1 - p0;
+        glm::vec2 e1 = p2 - p1;
+        glm::vec2 e2 = p0 - p2;
+        triangles.p0x.push_back(p0.x); triangles.p0y.push_back(p0.y);
+        triangles.p1x.push_back(p1.x); triangles.p1y.push_back(p1.y);
+        triangles.p2x.push_back(p2.x); triangles.p2y.push_back(p2.y);
+        triangles.e0x.push_back(e0.x); triangles.e0y.push_back(e0.y);
+        triangles.e1x.push_back(e1.x); triangles.e1y.push_back(e1.y);
+        triangles.e2x.push_back(e2.x); triangles.e2y.push_back(e2.y);
+        triangles.inv0.push_back(1.0f / glm::dot(e0, e0));
+        triangles.inv1.push_back(1.0f / glm::dot(e1, e1));
+        triangles.inv2.push_back(1.0f / glm::dot(e2, e2));
+        triangles.orient.push_back(e0.x * e2.y - e0.y * e2.x);
+        triangles.push(obj);
+        break;
+      }
+      case 4: {
+        rects.cx.push_back(obj.center.x);
+        rects.cy.push_back(obj.center.y);
+        rects.sx.push_back(obj.v2.x);
+        rects.sy.push_back(obj.v2.y);
+        rects.push(obj);
+        break;
+      }
+      default:
+        others.push(obj);
+        break;
+    }
+  }
+}
+
+// matches calculateSdf for shapes it has no distance function for
+float SDFBatch::constantDist(float maxDist) const {
+  float sdf = maxDist;
+  for (int i=0; i < others.corner.size(); i++) {
+    float d = maxDist;
+    if (others.corner[i] > 0.0f) d = sdfWithCorner(d, others.corner[i]);
+    if (others.thickness[i] > 0.0f) d = sdfAsOutline(d, others.thickness[i]);
+    if (d < sdf) sdf = d;
+  }
+  return sdf;
+}
+
+#pragma endregion Snapshot
+
+#pragma region Dispatch
+
+SDFSimdLevel SDFBatch::bestLevel() {
+#ifdef SDL_AVX2_INTRINSICS
+  if (SDL_HasAVX2()) return SDF_AVX2;
+#endif
+#ifdef SDL_SSE2_INTRINSICS
+  if (SDL_HasSSE2()) return SDF_SSE;
+#endif
+  return SDF_Scalar;
+}
+
+// evaluate the scene sdf at count points, levels not supported here fall back
+void SDFBatch::evaluate(
+  float const *px, float const *py, float *out, Uint32 count,
+  float maxDist, SDFSimdLevel level
+) const {
+  SDFSimdLevel best = bestLevel();
+  if (level > best) level = best;
+  switch (level) {
+    case SDF_AVX2:
+      evaluateAVX2(px, py, out, count, maxDist);
+      break;
+    case SDF_SSE:
+      evaluateSSE(px, py, out, count, maxDist);
+      break;
+    default:
+      evaluateScalar(px, py, out, count, maxDist);
+      break;
+  }
+}
+
+void SDFBatch::evaluate(std::vector<glm::vec2> const &points, std::vector<float> &out, float maxDist) const {
+  std::vector<float> px(points.size());
+  std::vector<float> py(points.size());
+  for (int i=0; i < points.size(); i++) {
+    px[i] = points[i].x;
+    py[i] = points[i].y;
+  }
+  out.resize(points.size());
+  evaluate(px.data(), py.data(), out.data(), points.size(), maxDist, bestLevel());
+}
+
+#pragma endregion Dispatch
+
+#pragma region Scalar kernels
+
+static inline float applyModifiers(float d, float corner, float thickness) {
+  if (corner > 0.0f) d = sdfWithCorner(d, corner);
+  if (thickness > 0.0f) d = sdfAsOutline(d, thickness);
+  return d;
+}
+
+void SDFBatch::evaluateScalar(float const *px, float const *py, float *out, Uint32 count, float maxDist) const {
+  float base = constantDist(maxDist);
+  for (Uint32 i=0; i < count; i++) {
+    glm::vec2 p = glm::vec2(px[i], py[i]);
+    float sdf = base;
+    for (int j=0; j < circles.cx.size(); j++) {
+      float d = sdfToCir(p, glm::vec2(circles.cx[j], circles.cy[j]), circles.r[j]);
+      d = applyModifiers(d, circles.corner[j], circles.thickness[j]);
+      if (d < sdf) sdf = d;
+    }
+    for (int j=0; j < lines.ax.size(); j++) {
+      float d = sdfToLine(p, glm::vec2(lines.ax[j], lines.ay[j]), glm::vec2(lines.bx[j], lines.by[j]));
+      d = applyModifiers(d, lines.corner[j], lines.thickness[j]);
+      if (d < sdf) sdf = d;
+    }
+    for (int j=0; j < triangles.p0x.size(); j++) {
+      float d = sdfToTriangle(
+        p,
+        glm::vec2(triangles.p0x[j], triangles.p0y[j]),
+        glm::vec2(triangles.p1x[j], triangles.p1y[j]),
+        glm::vec2(triangles.p2x[j], triangles.p2y[j])
+      );
+      d = applyModifiers(d, triangles.corner[j], triangles.thickness[j]);
+      if (d < sdf) sdf = d;
+    }
+    for (int j=0; j < rects.cx.size(); j++) {
+      float d = sdfToRect(p, glm::vec2(rects.cx[j], rects.cy[j]), glm::vec2(rects.sx[j], rects.sy[j]));
+      d = applyModifiers(d, rects.corner[j], rects.thickness[j]);
+      if (d < sdf) sdf = d;
+    }
+    out[i] = sdf;
+  }
+}
+
+#pragma endregion Scalar kernels
+
+#pragma region SSE kernels
+
+#ifdef SDL_SSE2_INTRINSICS
+
+static inline SDL_TARGETING("sse2") __m128 absSSE(__m128 v) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+static inline SDL_TARGETING("sse2") __m128 clamp01SSE(__m128 v) {
+  return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+static inline SDL_TARGETING("sse2") __m128 modifiersSSE(__m128 d, float corner, float thickness) {
+  if (corner > 0.0f) d = _mm_sub_ps(d, _mm_set1_ps(corner));
+  if (thickness > 0.0f) d = _mm_sub_ps(absSSE(d), _mm_set1_ps(thickness));
+  return d;
+}
+
+// squared distance to one triangle edge + the winding term used for the sign
+static inline SDL_TARGETING("sse2") void triEdgeSSE(
+  __m128 x, __m128 y, float vx, float vy, float ex, float ey, float inv, float o,
+  __m128 &dist2, __m128 &side
+) {
+  __m128 ex4 = _mm_set1_ps(ex);
+  __m128 ey4 = _mm_set1_ps(ey);
+  __m128 v0 = _mm_sub_ps(x, _mm_set1_ps(vx));
+  __m128 v1 = _mm_sub_ps(y, _mm_set1_ps(vy));
+  __m128 h = _mm_add_ps(_mm_mul_ps(v0, ex4), _mm_mul_ps(v1, ey4));
+  h = clamp01SSE(_mm_mul_ps(h, _mm_set1_ps(inv)));
+  __m128 d0 = _mm_sub_ps(v0, _mm_mul_ps(ex4, h));
+  __m128 d1 = _mm_sub_ps(v1, _mm_mul_ps(ey4, h));
+  dist2 = _mm_add_ps(_mm_mul_ps(d0, d0), _mm_mul_ps(d1, d1));
+  side = _mm_mul_ps(_mm_set1_ps(o), _mm_sub_ps(_mm_mul_ps(v0, ey4), _mm_mul_ps(v1, ex4)));
+}
+
+// kernels are free functions so the target attribute doesn't turn the
+// member functions into multiversioned declarations
+static SDL_TARGETING("sse2") Uint32 evaluateBlocksSSE(
+  SDFBatch::Circles const &circles, SDFBatch::Lines const &lines,
+  SDFBatch::Triangles const &triangles, SDFBatch::Rects const &rects,
+  float const *px, float const *py, float *out, Uint32 count, float baseDist
+) {
+  __m128 base = _mm_set1_ps(baseDist);
+  __m128 zero = _mm_setzero_ps();
+  __m128 signBit = _mm_set1_ps(-0.0f);
+  Uint32 i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(px + i);
+    __m128 y = _mm_loadu_ps(py + i);
+    __m128 sdf = base;
+    for (int j=0; j < circles.cx.size(); j++) {
+      __m128 dx = _mm_sub_ps(_mm_set1_ps(circles.cx[j]), x);
+      __m128 dy = _mm_sub_ps(_mm_set1_ps(circles.cy[j]), y);
+      __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+      d = _mm_sub_ps(d, _mm_set1_ps(circles.r[j]));
+      d = modifiersSSE(d, circles.corner[j], circles.thickness[j]);
+      sdf = _mm_min_ps(d, sdf);
+    }
+    for (int j=0; j < lines.ax.size(); j++) {
+      __m128 bax = _mm_set1_ps(lines.bax[j]);
+      __m128 bay = _mm_set1_ps(lines.bay[j]);
+      __m128 pax = _mm_sub_ps(x, _mm_set1_ps(lines.ax[j]));
+      __m128 pay = _mm_sub_ps(y, _mm_set1_ps(lines.ay[j]));
+      __m128 h = _mm_add_ps(_mm_mul_ps(pax, bax), _mm_mul_ps(pay, bay));
+      h = clamp01SSE(_mm_mul_ps(h, _mm_set1_ps(lines.invBB[j])));
+      __m128 dx = _mm_sub_ps(pax, _mm_mul_ps(bax, h));
+      __m128 dy = _mm_sub_ps(pay, _mm_mul_ps(bay, h));
+      __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+      d = modifiersSSE(d, lines.corner[j], lines.thickness[j]);
+      sdf = _mm_min_ps(d, sdf);
+    }
+    for (int j=0; j < triangles.p0x.size(); j++) {
+      __m128 d0, d1, d2, y0, y1, y2;
+      float o = triangles.orient[j];
+      triEdgeSSE(x, y, triangles.p0x[j], triangles.p0y[j], triangles.e0x[j], triangles.e0y[j], triangles.inv0[j], o, d0, y0);
+      triEdgeSSE(x, y, triangles.p1x[j], triangles.p1y[j], triangles.e1x[j], triangles.e1y[j], triangles.inv1[j], o, d1, y1);
+      triEdgeSSE(x, y, triangles.p2x[j], triangles.p2y[j], triangles.e2x[j], triangles.e2y[j], triangles.inv2[j], o, d2, y2);
+      __m128 minD = _mm_min_ps(d2, _mm_min_ps(d1, d0));
+      __m128 minY = _mm_min_ps(y2, _mm_min_ps(y1, y0));
+      __m128 inside = _mm_cmpgt_ps(minY, zero);
+      __m128 d = _mm_xor_ps(_mm_sqrt_ps(minD), _mm_and_ps(inside, signBit));
+      d = modifiersSSE(d, triangles.corner[j], triangles.thickness[j]);
+      sdf = _mm_min_ps(d, sdf);
+    }
+    for (int j=0; j < rects.cx.size(); j++) {
+      __m128 dx = _mm_sub_ps(absSSE(_mm_sub_ps(x, _mm_set1_ps(rects.cx[j]))), _mm_set1_ps(rects.sx[j]));
+      __m128 dy = _mm_sub_ps(absSSE(_mm_sub_ps(y, _mm_set1_ps(rects.cy[j]))), _mm_set1_ps(rects.sy[j]));
+      __m128 ox = _mm_max_ps(dx, zero);
+      __m128 oy = _mm_max_ps(dy, zero);
+      __m128 outer = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)));
+      __m128 inner = _mm_min_ps(_mm_max_ps(dx, dy), zero);
+      __m128 d = modifiersSSE(_mm_add_ps(outer, inner), rects.corner[j], rects.thickness[j]);
+      sdf = _mm_min_ps(d, sdf);
+    }
+    _mm_storeu_ps(out + i, sdf);
+  }
+  return i;
+}
+
+void SDFBatch::evaluateSSE(float const *px, float const *py, float *out, Uint32 count, float maxDist) const {
+  Uint32 done = evaluateBlocksSSE(
+    circles, lines, triangles, rects, px, py, out, count, constantDist(maxDist)
+  );
+  // remaining points
+  evaluateScalar(px + done, py + done, out + done, count - done, maxDist);
+}
+
+#else
+
+void SDFBatch::evaluateSSE(float const *px, float const *py, float *out, Uint32 count, float maxDist) const {
+  evaluateScalar(px, py, out, count, maxDist);
+}
+
+#endif
+
+#pragma endregion SSE kernels
+
+#pragma region AVX2 kernels
+
+#ifdef SDL_AVX2_INTRINSICS
+
+static inline SDL_TARGETING("avx2") __m256 absAVX(__m256 v) {
+  return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+static inline SDL_TARGETING("avx2") __m256 clamp01AVX(__m256 v) {
+  return _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+static inline SDL_TARGETING("avx2") __m256 modifiersAVX(__m256 d, float corner, float thickness) {
+  if (corner > 0.0f) d = _mm256_sub_ps(d, _mm256_set1_ps(corner));
+  if (thickness > 0.0f) d = _mm256_sub_ps(absAVX(d), _mm256_set1_ps(thickness));
+  return d;
+}
+
+static inline SDL_TARGETING("avx2") void triEdgeAVX(
+  __m256 x, __m256 y, float vx, float vy, float ex, float ey, float inv, float o,
+  __m256 &dist2, __m256 &side
+) {
+  __m256 ex8 = _mm256_set1_ps(ex);
+  __m256 ey8 = _mm256_set1_ps(ey);
+  __m256 v0 = _mm256_sub_ps(x, _mm256_set1_ps(vx));
+  __m256 v1 = _mm256_sub_ps(y, _mm256_set1_ps(vy));
+  __m256 h = _mm256_add_ps(_mm256_mul_ps(v0, ex8), _mm256_mul_ps(v1, ey8));
+  h = clamp01AVX(_mm256_mul_ps(h, _mm256_set1_ps(inv)));
+  __m256 d0 = _mm256_sub_ps(v0, _mm256_mul_ps(ex8, h));
+  __m256 d1 = _mm256_sub_ps(v1, _mm256_mul_ps(ey8, h));
+  dist2 = _mm256_add_ps(_mm256_mul_ps(d0, d0), _mm256_mul_ps(d1, d1));
+  side = _mm256_mul_ps(_mm256_set1_ps(o), _mm256_sub_ps(_mm256_mul_ps(v0, ey8), _mm256_mul_ps(v1, ex8)));
+}
+
+static SDL_TARGETING("avx2") Uint32 evaluateBlocksAVX2(
+  SDFBatch::Circles const &circles, SDFBatch::Lines const &lines,
+  SDFBatch::Triangles const &triangles, SDFBatch::Rects const &rects,
+  float const *px, float const *py, float *out, Uint32 count, float baseDist
+) {
+  __m256 base = _mm256_set1_ps(baseDist);
+  __m256 zero = _mm256_setzero_ps();
+  __m256 signBit = _mm256_set1_ps(-0.0f);
+  Uint32 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_loadu_ps(px + i);
+    __m256 y = _mm256_loadu_ps(py + i);
+    __m256 sdf = base;
+    for (int j=0; j < circles.cx.size(); j++) {
+      __m256 dx = _mm256_sub_ps(_mm256_set1_ps(circles.cx[j]), x);
+      __m256 dy = _mm256_sub_ps(_mm256_set1_ps(circles.cy[j]), y);
+      __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+      d = _mm256_sub_ps(d, _mm256_set1_ps(circles.r[j]));
+      d = modifiersAVX(d, circles.corner[j], circles.thickness[j]);
+      sdf = _mm256_min_ps(d, sdf);
+    }
+    for (int j=0; j < lines.ax.size(); j++) {
+      __m256 bax = _mm256_set1_ps(lines.bax[j]);
+      __m256 bay = _mm256_set1_ps(lines.bay[j]);
+      __m256 pax = _mm256_sub_ps(x, _mm256_set1_ps(lines.ax[j]));
+      __m256 pay = _mm256_sub_ps(y, _mm256_set1_ps(lines.ay[j]));
+      __m256 h = _mm256_add_ps(_mm256_mul_ps(pax, bax), _mm256_mul_ps(pay, bay));
+      h = clamp01AVX(_mm256_mul_ps(h, _mm256_set1_ps(lines.invBB[j])));
+      __m256 dx = _mm256_sub_ps(pax, _mm256_mul_ps(bax, h));
+      __m256 dy = _mm256_sub_ps(pay, _mm256_mul_ps(bay, h));
+      __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+      d = modifiersAVX(d, lines.corner[j], lines.thickness[j]);
+      sdf = _mm256_min_ps(d, sdf);
+    }
+    for (int j=0; j < triangles.p0x.size(); j++) {
+      __m256 d0, d1, d2, y0, y1, y2;
+      float o = triangles.orient[j];
+      triEdgeAVX(x, y, triangles.p0x[j], triangles.p0y[j], triangles.e0x[j], triangles.e0y[j], triangles.inv0[j], o, d0, y0);
+      triEdgeAVX(x, y, triangles.p1x[j], triangles.p1y[j], triangles.e1x[j], triangles.e1y[j], triangles.inv1[j], o, d1, y1);
+      triEdgeAVX(x, y, triangles.p2x[j], triangles.p2y[j], triangles.e2x[j], triangles.e2y[j], triangles.inv2[j], o, d2, y2);
+      __m256 minD = _mm256_min_ps(d2, _mm256_min_ps(d1, d0));
+      __m256 minY = _mm256_min_ps(y2, _mm256_min_ps(y1, y0));
+      __m256 inside = _mm256_cmp_ps(minY, zero, _CMP_GT_OQ);
+      __m256 d = _mm256_xor_ps(_mm256_sqrt_ps(minD), _mm256_and_ps(inside, signBit));
+      d = modifiersAVX(d, triangles.corner[j], triangles.thickness[j]);
+      sdf = _mm256_min_ps(d, sdf);
+    }
+    for (int j=0; j < rects.cx.size(); j++) {
+      __m256 dx = _mm256_sub_ps(absAVX(_mm256_sub_ps(x, _mm256_set1_ps(rects.cx[j]))), _mm256_set1_ps(rects.sx[j]));
+      __m256 dy = _mm256_sub_ps(absAVX(_mm256_sub_ps(y, _mm256_set1_ps(rects.cy[j]))), _mm256_set1_ps(rects.sy[j]));
+      __m256 ox = _mm256_max_ps(dx, zero);
+      __m256 oy = _mm256_max_ps(dy, zero);
+      __m256 outer = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)));
+      __m256 inner = _mm256_min_ps(_mm256_max_ps(dx, dy), zero);
+      __m256 d = modifiersAVX(_mm256_add_ps(outer, inner), rects.corner[j], rects.thickness[j]);
+      sdf = _mm256_min_ps(d, sdf);
+    }
+    _mm256_storeu_ps(out + i, sdf);
+  }
+  return i;
+}
+
+void SDFBatch::evaluateAVX2(float const *px, float const *py, float *out, Uint32 count, float maxDist) const {
+  Uint32 done = evaluateBlocksAVX2(
+    circles, lines, triangles, rects, px, py, out, count, constantDist(maxDist)
+  );
+  // remaining points
+  evaluateSSE(px + done, py + done, out + done, count - done, maxDist);
+}
+
+#else
+
+void SDFBatch::evaluateAVX2(float const *px, float const *py, float *out, Uint32 count, float maxDist) const {
+  evaluateSSE(px, py, out, count, maxDist);
+}
+
+#endif
+
+#pragma endregion AVX2 kernels
+
+#pragma region Benchmark
+
+static float relativeError(float value, float expected) {
+  return SDL_fabsf(value - expected) / SDL_max(1.0f, SDL_fabsf(expected));
+}
+
+// time calculateSdf against every batch level on random points in area,
+// reporting the worst deviation from the per-point results
+void App::benchmarkSdfBatch(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 pointCount) {
+  const float maxDist = 10000.0f;
+  std::vector<float> px(pointCount);
+  std::vector<float> py(pointCount);
+  for (Uint32 i=0; i < pointCount; i++) {
+    px[i] = SDL_randf() * area.x;
+    py[i] = SDL_randf() * area.y;
+  }
+  double freq = (double)SDL_GetPerformanceFrequency();
+
+  // reference: one point at a time
+  std::vector<float> expected(pointCount);
+  Uint64 t0 = SDL_GetPerformanceCounter();
+  for (Uint32 i=0; i < pointCount; i++) {
+    expected[i] = calculateSdf(glm::vec2(px[i], py[i]), maxDist, &objs);
+  }
+  double refMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+  SDL_Log(
+    "SDF benchmark: %d objects, %d points - calculateSdf %.3f ms (%.1f ns/query)",
+    (int)objs.size(), pointCount, refMs, refMs * 1000000.0 / pointCount
+  );
+
+  SDFBatch batch;
+  t0 = SDL_GetPerformanceCounter();
+  batch.build(objs);
+  double buildMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+  SDL_Log("SDF benchmark: snapshot built in %.3f ms", buildMs);
+
+  const char *names[3] = { "scalar", "SSE", "AVX2" };
+  std::vector<float> out(pointCount);
+  for (int level = SDF_Scalar; level <= SDF_AVX2; level++) {
+    if (level > SDFBatch::bestLevel()) {
+      SDL_Log("SDF benchmark: %s not supported on this cpu", names[level]);
+      continue;
+    }
+    t0 = SDL_GetPerformanceCounter();
+    batch.evaluate(px.data(), py.data(), out.data(), pointCount, maxDist, (SDFSimdLevel)level);
+    double ms = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+    float maxErr = 0.0f;
+    for (Uint32 i=0; i < pointCount; i++) {
+      // relative tolerance, distances grow with the screen size
+      float err = relativeError(out[i], expected[i]);
+      if (err > maxErr) maxErr = err;
+    }
+    SDL_Log(
+      "SDF benchmark: batch %-6s %.3f ms (%.1f ns/query, %.2fx) - max rel error %g%s",
+      names[level], ms, ms * 1000000.0 / pointCount, refMs / ms, maxErr,
+      maxErr > SDFBatch::TOLERANCE ? " (OUT OF TOLERANCE)" : ""
+    );
+  }
+}
+
+#pragma endregion Benchmark
+
+#pragma region Validation
+
+// headless check of every kernel this cpu runs against calculateSdf. half the
+// points are spread over area, the rest land close to the objects so each
+// shape decides the distance somewhere. the count leaves a tail for the
+// narrower kernels after the avx2 and sse blocks
+bool App::validateSdfBatch(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 pointCount) {
+  const float maxDist = 10000.0f;
+  Uint32 count = pointCount - pointCount % 8 + 7;
+  Uint64 seed = 1;
+  std::vector<float> px(count);
+  std::vector<float> py(count);
+  for (Uint32 i=0; i < count; i++) {
+    glm::vec2 p = glm::vec2(SDL_randf_r(&seed) * area.x, SDL_randf_r(&seed) * area.y);
+    if (i % 2 == 1 && !objs.empty()) {
+      SDFRenderObject obj = objs[SDL_rand_r(&seed, (Sint32)objs.size())].renderObject();
+      p = obj.center + glm::vec2(SDL_randf_r(&seed) - 0.5f, SDL_randf_r(&seed) - 0.5f) * 80.0f;
+    }
+    px[i] = p.x;
+    py[i] = p.y;
+  }
+  std::vector<float> expected(count);
+  for (Uint32 i=0; i < count; i++) {
+    expected[i] = calculateSdf(glm::vec2(px[i], py[i]), maxDist, &objs);
+  }
+
+  SDFBatch batch;
+  batch.build(objs);
+  const char *names[3] = { "scalar", "SSE", "AVX2" };
+  std::vector<float> out(count);
+  Uint32 failures = 0;
+  for (int level = SDF_Scalar; level <= SDFBatch::bestLevel(); level++) {
+    batch.evaluate(px.data(), py.data(), out.data(), count, maxDist, (SDFSimdLevel)level);
+    float maxErr = 0.0f;
+    for (Uint32 i=0; i < count; i++) {
+      float err = relativeError(out[i], expected[i]);
+      if (err > maxErr) maxErr = err;
+      if (err <= SDFBatch::TOLERANCE) continue;
+      if (failures < 8) {
+        SDL_Log(
+          "ERR: SDF batch: %s gives %g at (%.1f, %.1f), calculateSdf %g",
+          names[level], out[i], px[i], py[i], expected[i]
+        );
+      }
+      failures++;
+    }
+    SDL_Log("SDF batch: %s on %d objects, %d points - max rel error %g", names[level], (int)objs.size(), count, maxErr);
+  }
+  return failures == 0;
+}
+
+#pragma endregion Validation
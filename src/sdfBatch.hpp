@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+#include <glm/vec2.hpp>
+#include "sdfPipeline.hpp"
+
+namespace App {
+  enum SDFSimdLevel { SDF_Scalar, SDF_SSE, SDF_AVX2 };
+  // structure-of-arrays snapshot of an SDF scene for batched distance queries.
+  // shapes are split by type so each kernel walks a contiguous set of arrays
+  class SDFBatch {
+  public:
+    // largest deviation from calculateSdf a kernel may show, relative to
+    // the distance once that is past 1
+    static constexpr float TOLERANCE = 1e-4f;
+    void build(std::vector<SDFObject> &objs);
+    void evaluate(
+      float const *px, float const *py, float *out, Uint32 count,
+      float maxDist, SDFSimdLevel level
+    ) const;
+    void evaluate(std::vector<glm::vec2> const &points, std::vector<float> &out, float maxDist) const;
+    static SDFSimdLevel bestLevel();
+    Uint32 size() const { return objCount; }
+    // snapshot arrays, one entry per shape
+    struct Modifiers {
+      std::vector<float> corner;
+      std::vector<float> thickness;
+      void push(SDFRenderObject const &obj);
+      void clear();
+    };
+    struct Circles : Modifiers {
+      std::vector<float> cx, cy, r;
+    };
+    struct Lines : Modifiers {
+      std::vector<float> ax, ay, bx, by;
+      std::vector<float> bax, bay, invBB;
+    };
+    struct Triangles : Modifiers {
+      std::vector<float> p0x, p0y, p1x, p1y, p2x, p2y;
+      std::vector<float> e0x, e0y, e1x, e1y, e2x, e2y;
+      std::vector<float> inv0, inv1, inv2, orient;
+    };
+    struct Rects : Modifiers {
+      std::vector<float> cx, cy, sx, sy;
+    };
+  private:
+    float constantDist(float maxDist) const;
+    void evaluateScalar(float const *px, float const *py, float *out, Uint32 count, float maxDist) const;
+    void evaluateSSE(float const *px, float const *py, float *out, Uint32 count, float maxDist) const;
+    void evaluateAVX2(float const *px, float const *py, float *out, Uint32 count, float maxDist) const;
+    Uint32 objCount = 0;
+    Circles circles;
+    Lines lines;
+    Triangles triangles;
+    Rects rects;
+    // shapes without a CPU distance function, only their modifiers apply
+    Modifiers others;
+  };
+  void benchmarkSdfBatch(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 pointCount);
+  bool validateSdfBatch(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 pointCount);
+}
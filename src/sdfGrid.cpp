@@ -0,0 +1,417 @@
+#include "sdfGrid.hpp"
+
+using namespace App;
+
+#pragma region Build
+
+void SDFGrid::build(std::vector<SDFObject> &objs, float size) {
+  objects = &objs;
+  minCellSize = size;
+  rebuild();
+}
+
+// size the grid around every bounded shape and re-bin all of them
+void SDFGrid::rebuild() {
+  stats.rebuilds++;
+  entries.clear();
+  unbounded.clear();
+  cellSize = minCellSize;
+  cols = 0;
+  rows = 0;
+
+  bool any = false;
+  glm::vec2 lo = glm::vec2(0.0f);
+  glm::vec2 hi = glm::vec2(0.0f);
+  for (int i=0; i < objects->size(); i++) {
+    glm::vec2 oLo, oHi;
+    if (!sdfBounds(objects->at(i).renderObject(), oLo, oHi)) continue;
+    if (!any) {
+      lo = oLo;
+      hi = oHi;
+      any = true;
+    }
+    lo = glm::vec2(SDL_min(lo.x, oLo.x), SDL_min(lo.y, oLo.y));
+    hi = glm::vec2(SDL_max(hi.x, oHi.x), SDL_max(hi.y, oHi.y));
+  }
+
+  // roughly one bounded shape per cell, sparse scenes get coarser cells
+  glm::vec2 extent = hi - lo;
+  float longest = SDL_max(extent.x, extent.y);
+  int count = SDL_max((int)objects->size(), 1);
+  cellSize = SDL_max(cellSize, SDL_sqrtf(extent.x * extent.y / count));
+  // leave a margin so small movements don't force a rebuild
+  if (longest / cellSize > MAX_CELLS_PER_AXIS - 4) {
+    cellSize = longest / (MAX_CELLS_PER_AXIS - 4);
+  }
+  origin = lo - glm::vec2(cellSize * 2.0f);
+  cols = (int)SDL_floorf(extent.x / cellSize) + 5;
+  rows = (int)SDL_floorf(extent.y / cellSize) + 5;
+
+  cells.assign(cols * rows, std::vector<int>());
+  clearance.assign(cols * rows, 0);
+  clearanceDirty = true;
+  visited.assign(objects->size(), 0);
+  stamp = 0;
+  for (int i=0; i < objects->size(); i++) {
+    entries.push_back(makeEntry(i));
+    insert(i);
+  }
+}
+
+SDFGrid::Entry SDFGrid::makeEntry(int id) {
+  Entry e;
+  e.obj = objects->at(id).renderObject();
+  glm::vec2 lo, hi;
+  e.bounded = sdfBounds(e.obj, lo, hi);
+  if (!e.bounded) return e;
+  e.x0 = (int)SDL_floorf((lo.x - origin.x) / cellSize);
+  e.y0 = (int)SDL_floorf((lo.y - origin.y) / cellSize);
+  e.x1 = (int)SDL_floorf((hi.x - origin.x) / cellSize);
+  e.y1 = (int)SDL_floorf((hi.y - origin.y) / cellSize);
+  return e;
+}
+
+bool SDFGrid::fits(Entry const &e) const {
+  if (!e.bounded) return true;
+  return e.x0 >= 0 && e.y0 >= 0 && e.x1 < cols && e.y1 < rows;
+}
+
+void SDFGrid::insert(int id) {
+  Entry const &e = entries[id];
+  if (!e.bounded) {
+    unbounded.push_back(id);
+    return;
+  }
+  for (int y = e.y0; y <= e.y1; y++) {
+    for (int x = e.x0; x <= e.x1; x++) {
+      cells[y * cols + x].push_back(id);
+    }
+  }
+  clearanceDirty = true;
+}
+
+void SDFGrid::erase(int id) {
+  Entry const &e = entries[id];
+  if (!e.bounded) {
+    for (int i=0; i < unbounded.size(); i++) {
+      if (unbounded[i] != id) continue;
+      unbounded.erase(unbounded.begin() + i);
+      break;
+    }
+    return;
+  }
+  for (int y = e.y0; y <= e.y1; y++) {
+    for (int x = e.x0; x <= e.x1; x++) {
+      std::vector<int> &cell = cells[y * cols + x];
+      for (int i=0; i < cell.size(); i++) {
+        if (cell[i] != id) continue;
+        cell[i] = cell.back();
+        cell.pop_back();
+        break;
+      }
+    }
+  }
+  clearanceDirty = true;
+}
+
+// re-bin a single object after it changed. objects appended to the vector are
+// picked up by any call, whatever id it names. the grid is rebuilt if an
+// object left its extent or objects were removed
+void SDFGrid::update(int id) {
+  if (objects == NULL) return;
+  if (objects->size() < entries.size()) {
+    rebuild();
+    return;
+  }
+  int known = entries.size();
+  if (objects->size() > known) {
+    visited.resize(objects->size(), 0);
+    for (int i = known; i < objects->size(); i++) {
+      entries.push_back(makeEntry(i));
+      if (!fits(entries[i])) {
+        rebuild();
+        return;
+      }
+      insert(i);
+    }
+  }
+  if (id < 0 || id >= known) return;
+  erase(id);
+  entries[id] = makeEntry(id);
+  if (!fits(entries[id])) {
+    rebuild();
+    return;
+  }
+  insert(id);
+}
+
+// two pass chessboard distance transform over cell occupancy
+void SDFGrid::refreshClearance() {
+  clearanceDirty = false;
+  const Uint16 far = (Uint16)SDL_min(cols + rows, 65535);
+  for (int i=0; i < cells.size(); i++) {
+    clearance[i] = cells[i].empty() ? far : 0;
+  }
+  for (int y=0; y < rows; y++) {
+    for (int x=0; x < cols; x++) {
+      Uint16 &c = clearance[y * cols + x];
+      if (x > 0) c = SDL_min(c, clearance[y * cols + x - 1] + 1);
+      if (y > 0) {
+        c = SDL_min(c, clearance[(y - 1) * cols + x] + 1);
+        if (x > 0) c = SDL_min(c, clearance[(y - 1) * cols + x - 1] + 1);
+        if (x < cols - 1) c = SDL_min(c, clearance[(y - 1) * cols + x + 1] + 1);
+      }
+    }
+  }
+  for (int y = rows - 1; y >= 0; y--) {
+    for (int x = cols - 1; x >= 0; x--) {
+      Uint16 &c = clearance[y * cols + x];
+      if (x < cols - 1) c = SDL_min(c, clearance[y * cols + x + 1] + 1);
+      if (y < rows - 1) {
+        c = SDL_min(c, clearance[(y + 1) * cols + x] + 1);
+        if (x > 0) c = SDL_min(c, clearance[(y + 1) * cols + x - 1] + 1);
+        if (x < cols - 1) c = SDL_min(c, clearance[(y + 1) * cols + x + 1] + 1);
+      }
+    }
+  }
+}
+
+#pragma endregion Build
+
+#pragma region Queries
+
+// lower bound on the distance from point to any cell outside the
+// (2 * ring - 1) block already visited around (cx, cy)
+float SDFGrid::ringBound(glm::vec2 point, int cx, int cy, int ring) const {
+  float bound = 1e30f;
+  if (cx - ring >= 0) {
+    float edge = origin.x + (cx - ring + 1) * cellSize;
+    bound = SDL_min(bound, SDL_max(point.x - edge, 0.0f));
+  }
+  if (cx + ring < cols) {
+    float edge = origin.x + (cx + ring) * cellSize;
+    bound = SDL_min(bound, SDL_max(edge - point.x, 0.0f));
+  }
+  if (cy - ring >= 0) {
+    float edge = origin.y + (cy - ring + 1) * cellSize;
+    bound = SDL_min(bound, SDL_max(point.y - edge, 0.0f));
+  }
+  if (cy + ring < rows) {
+    float edge = origin.y + (cy + ring) * cellSize;
+    bound = SDL_min(bound, SDL_max(edge - point.y, 0.0f));
+  }
+  return bound;
+}
+
+void SDFGrid::testCell(int cell, glm::vec2 point, float maxDist, float &sdf) {
+  stats.cellsVisited++;
+  for (int id : cells[cell]) {
+    // large shapes span several cells
+    if (visited[id] == stamp) continue;
+    visited[id] = stamp;
+    stats.objectsTested++;
+    float d = sdfToObject(point, maxDist, entries[id].obj);
+    if (d < sdf) sdf = d;
+  }
+}
+
+// same result as calculateSdf, only evaluating shapes near the point
+float SDFGrid::calculateSdf(glm::vec2 point, float maxDist) {
+  stats.queries++;
+  float sdf = maxDist;
+  for (int id : unbounded) {
+    stats.objectsTested++;
+    float d = sdfToObject(point, maxDist, entries[id].obj);
+    if (d < sdf) sdf = d;
+  }
+  if (cols == 0 || rows == 0) return sdf;
+  if (clearanceDirty) refreshClearance();
+  if (++stamp == 0) {
+    SDL_memset(visited.data(), 0, visited.size() * sizeof(Uint32));
+    stamp = 1;
+  }
+
+  float fx = SDL_floorf((point.x - origin.x) / cellSize);
+  float fy = SDL_floorf((point.y - origin.y) / cellSize);
+  bool inside = fx >= 0.0f && fy >= 0.0f && fx < cols && fy < rows;
+  int cx = (int)SDL_clamp(fx, 0.0f, (float)(cols - 1));
+  int cy = (int)SDL_clamp(fy, 0.0f, (float)(rows - 1));
+  int lastRing = SDL_max(SDL_max(cx, cols - 1 - cx), SDL_max(cy, rows - 1 - cy));
+
+  // skip the rings around empty cells that are known to hold nothing
+  int ring = inside ? clearance[cy * cols + cx] : 0;
+  for (; ring <= lastRing; ring++) {
+    if (ring > 0 && ringBound(point, cx, cy, ring) >= sdf) break;
+    int y0 = SDL_max(cy - ring, 0);
+    int y1 = SDL_min(cy + ring, rows - 1);
+    for (int y = y0; y <= y1; y++) {
+      if (y == cy - ring || y == cy + ring) {
+        int x0 = SDL_max(cx - ring, 0);
+        int x1 = SDL_min(cx + ring, cols - 1);
+        for (int x = x0; x <= x1; x++) testCell(y * cols + x, point, maxDist, sdf);
+      } else {
+        if (cx - ring >= 0) testCell(y * cols + cx - ring, point, maxDist, sdf);
+        if (cx + ring < cols) testCell(y * cols + cx + ring, point, maxDist, sdf);
+      }
+    }
+  }
+  return sdf;
+}
+
+// same march as calculateRayMarch, every step is a bounded grid query
+float SDFGrid::calculateRayMarch(glm::vec2 point, glm::vec2 target, float maxDist) {
+  glm::vec2 dir = glm::normalize(target - point);
+  glm::vec2 p = point;
+  float sdf = calculateSdf(p, maxDist);
+  float rayDist = sdf;
+  for (int i=0; i < 1000; i++) {
+    p = p + dir * sdf;
+    sdf = calculateSdf(p, maxDist);
+    rayDist += sdf;
+    if (rayDist > maxDist || sdf < 0.01f) break;
+  }
+  if (rayDist > maxDist) rayDist = maxDist;
+  return rayDist;
+}
+
+#pragma endregion Queries
+
+#pragma region Benchmark
+
+// time linear scans against grid queries on random points/rays in area,
+// results should match exactly since both run the same distance functions
+void App::benchmarkSdfGrid(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 queryCount) {
+  const float maxDist = 800.0f;
+  const Uint32 rayCount = SDL_max(queryCount / 100, 1);
+  std::vector<glm::vec2> points(queryCount);
+  for (Uint32 i=0; i < queryCount; i++) {
+    points[i] = glm::vec2(SDL_randf() * area.x, SDL_randf() * area.y);
+  }
+  double freq = (double)SDL_GetPerformanceFrequency();
+
+  SDFGrid grid;
+  Uint64 t0 = SDL_GetPerformanceCounter();
+  grid.build(objs);
+  double buildMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+
+  std::vector<float> expected(queryCount);
+  t0 = SDL_GetPerformanceCounter();
+  for (Uint32 i=0; i < queryCount; i++) {
+    expected[i] = App::calculateSdf(points[i], maxDist, &objs);
+  }
+  double linearMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+
+  float maxErr = 0.0f;
+  t0 = SDL_GetPerformanceCounter();
+  for (Uint32 i=0; i < queryCount; i++) {
+    float d = grid.calculateSdf(points[i], maxDist);
+    maxErr = SDL_max(maxErr, SDL_fabsf(d - expected[i]));
+  }
+  double gridMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+  SDL_Log(
+    "SDF grid: %d objects, built in %.3f ms - %d queries linear %.3f ms, grid %.3f ms (%.2fx) - max error %g",
+    (int)objs.size(), buildMs, queryCount, linearMs, gridMs, linearMs / gridMs, maxErr
+  );
+  SDL_Log(
+    "SDF grid: %.1f cells, %.1f objects tested per query",
+    (float)grid.stats.cellsVisited / grid.stats.queries, (float)grid.stats.objectsTested / grid.stats.queries
+  );
+
+  // rays towards the next point, like line of sight checks
+  maxErr = 0.0f;
+  std::vector<float> rays(rayCount);
+  t0 = SDL_GetPerformanceCounter();
+  for (Uint32 i=0; i < rayCount; i++) {
+    rays[i] = App::calculateRayMarch(points[i], points[(i + 1) % queryCount], maxDist, &objs);
+  }
+  linearMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+  t0 = SDL_GetPerformanceCounter();
+  for (Uint32 i=0; i < rayCount; i++) {
+    float d = grid.calculateRayMarch(points[i], points[(i + 1) % queryCount], maxDist);
+    maxErr = SDL_max(maxErr, SDL_fabsf(d - rays[i]));
+  }
+  gridMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+  SDL_Log(
+    "SDF grid: %d ray marches linear %.3f ms, grid %.3f ms (%.2fx) - max error %g",
+    rayCount, linearMs, gridMs, linearMs / gridMs, maxErr
+  );
+
+  // incremental updates, moving every object on a copy
+  std::vector<SDFObject> moved = objs;
+  grid.build(moved);
+  Uint32 rebuilds = grid.stats.rebuilds;
+  t0 = SDL_GetPerformanceCounter();
+  for (int i=0; i < moved.size(); i++) {
+    moved[i].updatePositionDelta(glm::vec2(SDL_randf() * 20.0f - 10.0f, SDL_randf() * 20.0f - 10.0f));
+    grid.update(i);
+  }
+  double updateMs = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+  SDL_Log(
+    "SDF grid: moved %d objects in %.3f ms (%d rebuilds)",
+    (int)moved.size(), updateMs, grid.stats.rebuilds - rebuilds
+  );
+}
+
+#pragma endregion Benchmark
+
+#pragma region Validation
+
+static Uint32 countMismatches(const char *what, float value, float expected, glm::vec2 point, Uint32 failures) {
+  if (value == expected) return 0;
+  if (failures < 8) {
+    SDL_Log("ERR: SDF grid: %s gives %g at (%.1f, %.1f), linear scan %g", what, value, point.x, point.y, expected);
+  }
+  return 1;
+}
+
+// headless check of grid queries and ray marches against the linear scans.
+// both take the minimum over the same distance functions, so they have to
+// agree exactly. the grid is checked once built, again after every object
+// moved, and again after objects were appended behind an update of an
+// existing id
+bool App::validateSdfGrid(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 queryCount) {
+  const float maxDist = 800.0f;
+  const Uint32 rayCount = SDL_max(queryCount / 100, 1);
+  Uint64 seed = 1;
+  std::vector<glm::vec2> points(queryCount);
+  for (Uint32 i=0; i < queryCount; i++) {
+    points[i] = glm::vec2(SDL_randf_r(&seed) * area.x, SDL_randf_r(&seed) * area.y);
+  }
+
+  std::vector<SDFObject> moved = objs;
+  SDFGrid grid;
+  grid.build(moved);
+  Uint32 failures = 0;
+  const char *stages[3] = { "built", "moved", "appended" };
+  for (int stage=0; stage < 3; stage++) {
+    if (stage == 1) {
+      for (int i=0; i < moved.size(); i++) {
+        // far enough for some objects to leave the grid's extent
+        moved[i].updatePositionDelta(glm::vec2(SDL_randf_r(&seed) * 80.0f - 40.0f, SDL_randf_r(&seed) * 80.0f - 40.0f));
+        grid.update(i);
+      }
+    }
+    if (stage == 2) {
+      for (int i=0; i < objs.size(); i += 4) moved.push_back(objs[i]);
+      moved[0].updatePositionDelta(glm::vec2(1.0f, 1.0f));
+      grid.update(0);
+    }
+    Uint32 before = failures;
+    for (Uint32 i=0; i < queryCount; i++) {
+      float expected = App::calculateSdf(points[i], maxDist, &moved);
+      failures += countMismatches("query", grid.calculateSdf(points[i], maxDist), expected, points[i], failures);
+    }
+    for (Uint32 i=0; i < rayCount; i++) {
+      glm::vec2 target = points[(i + 1) % queryCount];
+      float expected = App::calculateRayMarch(points[i], target, maxDist, &moved);
+      failures += countMismatches("ray march", grid.calculateRayMarch(points[i], target, maxDist), expected, points[i], failures);
+    }
+    SDL_Log(
+      "SDF grid: %s, %d objects - %d queries and %d ray marches, %d mismatches",
+      stages[stage], (int)moved.size(), queryCount, rayCount, failures - before
+    );
+  }
+  return failures == 0;
+}
+
+#pragma endregion Validation
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+#include <glm/vec2.hpp>
+#include "sdfPipeline.hpp"
+
+namespace App {
+  struct SDFGridStats {
+    Uint32 queries = 0;
+    Uint32 cellsVisited = 0;
+    Uint32 objectsTested = 0;
+    Uint32 rebuilds = 0;
+  };
+  // uniform grid over SDFObject bounds for CPU distance queries.
+  // a query walks rings of cells outward from the point and stops once
+  // the nearest unvisited cell is further away than the closest hit
+  class SDFGrid {
+  public:
+    static constexpr float DEFAULT_CELL_SIZE = 64.0f;
+    static const int MAX_CELLS_PER_AXIS = 256;
+    void build(std::vector<SDFObject> &objs, float cellSize = DEFAULT_CELL_SIZE);
+    void update(int id);
+    float calculateSdf(glm::vec2 point, float maxDist);
+    float calculateRayMarch(glm::vec2 point, glm::vec2 target, float maxDist);
+    SDFGridStats stats;
+  private:
+    struct Entry {
+      SDFRenderObject obj;
+      bool bounded = false;
+      int x0 = 0, y0 = 0, x1 = -1, y1 = -1;
+    };
+    Entry makeEntry(int id);
+    bool fits(Entry const &e) const;
+    void insert(int id);
+    void erase(int id);
+    void rebuild();
+    void refreshClearance();
+    float ringBound(glm::vec2 point, int cx, int cy, int ring) const;
+    void testCell(int cell, glm::vec2 point, float maxDist, float &sdf);
+    std::vector<SDFObject> *objects = NULL;
+    std::vector<Entry> entries;
+    std::vector<std::vector<int>> cells;
+    // chebyshev distance in cells to the nearest occupied cell,
+    // rings closer than this are known to be empty
+    std::vector<Uint16> clearance;
+    bool clearanceDirty = true;
+    // shapes without bounds are tested by every query
+    std::vector<int> unbounded;
+    std::vector<Uint32> visited;
+    Uint32 stamp = 0;
+    glm::vec2 origin = glm::vec2(0.0f);
+    float cellSize = DEFAULT_CELL_SIZE;
+    float minCellSize = DEFAULT_CELL_SIZE;
+    int cols = 0;
+    int rows = 0;
+  };
+  void benchmarkSdfGrid(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 queryCount);
+  bool validateSdfGrid(std::vector<SDFObject> &objs, glm::vec2 area, Uint32 queryCount);
+}
@@ -1,4 +1,10 @@
 #include "sdfPipeline.hpp"
+#include "gpuBackend.hpp"
+#include "frameArena.hpp"
+#include "profiler.hpp"
+#include "stagingRing.hpp"
+#include "sdfTiles.hpp"
+#include "jobSystem.hpp"
 
 using namespace App;
 
@@ -47,14 +53,17 @@ SDFObject SDFObject::rect(glm::vec2 center, glm::vec2 size, float rotateDeg) {
 
 void SDFObject::withColor(SDL_FColor color) {
 	this->color = color;
+	dirty = true;
 }
 
 void SDFObject::withRoundCorner(float radius) {
 	this->cornerRadius = radius;
+	dirty = true;
 }
 
 void SDFObject::asOutline(float thickness) {
 	this->thickness = thickness;
+	dirty = true;
 }
 
 void SDFObject::updatePositionDelta(glm::vec2 delta) {
@@ -63,6 +72,7 @@ void SDFObject::updatePositionDelta(glm::vec2 delta) {
 		v3 = v3 + delta;
 	}
 	center = center + delta;
+	dirty = true;
 }
 
 void SDFObject::updatePosition(glm::vec2 newCenter) {
@@ -111,9 +121,9 @@ SDFPipeline::SDFPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu)
   device = gpu;
   // create shaders
   SDL_GPUShader *vertShader = App::loadShader(device, "fullScreenQuad.vert", 0, 0, 0, 0);
-  SDL_GPUShader *fragShader = App::loadShader(device, "sdf.frag", 0, 1, 1, 0);
+  SDL_GPUShader *fragShader = App::loadShader(device, "sdf.frag", 0, 1, 3, 0);
   // create pipeline
-	pipeline = SDL_CreateGPUGraphicsPipeline(device, new SDL_GPUGraphicsPipelineCreateInfo {
+	pipeline = getGPUBackend()->createGraphicsPipeline(device, getFrameArena()->make(SDL_GPUGraphicsPipelineCreateInfo {
 		.vertex_shader = vertShader,
 		.fragment_shader = fragShader,
 		.primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
@@ -122,7 +132,7 @@ SDFPipeline::SDFPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu)
 			.cull_mode = SDL_GPU_CULLMODE_NONE,
 		},
 		.target_info = SDL_GPUGraphicsPipelineTargetInfo {
-			.color_target_descriptions = new SDL_GPUColorTargetDescription {
+			.color_target_descriptions = getFrameArena()->make(SDL_GPUColorTargetDescription {
 				.format = targetFormat,
 				.blend_state = SDL_GPUColorTargetBlendState {
 					.src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
@@ -133,86 +143,134 @@ SDFPipeline::SDFPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu)
 					.alpha_blend_op = SDL_GPU_BLENDOP_ADD,
 					.enable_blend = true,
 				},
-			},
+			}),
 			.num_color_targets = 1,
 		},
-	});
-	// create storage buffer for objects
-	objsBuffer = SDL_CreateGPUBuffer(device, new SDL_GPUBufferCreateInfo {
-		.usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
-		.size = 1000 * sizeof(SDFRenderObject),
-	});
+	}));
+	binner = new SDFTileBinner();
 	// release shaders
-	SDL_ReleaseGPUShader(device, vertShader);
-  SDL_ReleaseGPUShader(device, fragShader);
+	getGPUBackend()->releaseShader(device, vertShader);
+  getGPUBackend()->releaseShader(device, fragShader);
+}
+
+// grow a storage buffer used by the fragment shader, contents are discarded
+static SDL_GPUBuffer* growStorage(SDL_GPUDevice *device, SDL_GPUBuffer *buf, Uint32 &capacity, Uint32 count, Uint32 stride) {
+	if (buf != NULL && count <= capacity) return buf;
+	if (buf != NULL) getGPUBackend()->releaseBuffer(device, buf);
+	capacity = SDL_max(SDL_max(count, capacity * 2), 1024);
+	SDL_GPUBufferCreateInfo info = {
+		.usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ,
+		.size = capacity * stride,
+	};
+	return getGPUBackend()->createBuffer(device, &info);
 }
 
+// repack dirty objects and stage only the index ranges that changed.
+// the object buffer keeps its contents between frames, so static scenes upload nothing
 void SDFPipeline::refreshObjects(std::vector<SDFObject> &objs) {
-	Uint32 objsSize = sizeof(SDFRenderObject) * objs.size();
-	// update object buffer with new data
-	SDL_GPUTransferBuffer *transferBuf = SDL_CreateGPUTransferBuffer(
-		device,
-		new SDL_GPUTransferBufferCreateInfo {
-			.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-			.size = objsSize,
-		}
-	);
-	SDFRenderObject* objData = static_cast<SDFRenderObject*>(SDL_MapGPUTransferBuffer(
-		device, transferBuf, false
-	));
-	for (int i=0; i < objs.size(); i++) {
-		objData[i] = objs.at(i).renderObject();
+	PROFILE_ZONE("SDFPipeline::refreshObjects");
+	Uint32 count = objs.size();
+	uploadStats = SDFUploadStats {};
+	uploadStats.objects = count;
+	// appended objects always go up, a new buffer starts empty so everything does
+	Uint32 firstNew = renderObjs.size();
+	if (objsBuffer == NULL || count > objsCapacity) {
+		objsBuffer = growStorage(device, objsBuffer, objsCapacity, SDL_max(count, INITIAL_OBJECT_CAPACITY), sizeof(SDFRenderObject));
+		firstNew = 0;
 	}
-	SDL_UnmapGPUTransferBuffer(device, transferBuf);
-
-	// create cmd buffer + copy pass
-	SDL_GPUCommandBuffer *cmdBuf = SDL_AcquireGPUCommandBuffer(device);
-	SDL_GPUCopyPass *copyPass = SDL_BeginGPUCopyPass(cmdBuf);
+	if (objsBuffer == NULL) {
+		SDL_Log("ERR: Failed to create SDF object buffer for %d objects", count);
+		objsCapacity = 0;
+		return;
+	}
+	renderObjs.resize(count);
+	changed.assign(count, 0);
+	getJobSystem()->parallelFor(count, 512, [this, &objs, firstNew](Uint32 begin, Uint32 end) {
+		for (Uint32 i=begin; i < end; i++) {
+			if (!objs[i].dirty && i < firstNew) continue;
+			renderObjs[i] = objs[i].renderObject();
+			objs[i].dirty = false;
+			changed[i] = 1;
+		}
+	});
 
-	SDL_UploadToGPUBuffer(
-		copyPass,
-		new SDL_GPUTransferBufferLocation {
-			.transfer_buffer = transferBuf,
-			.offset = 0,
-		},
-		new SDL_GPUBufferRegion {
-			.buffer = objsBuffer,
-			.offset = 0,
-			.size = objsSize,
-		},
-		false
-	);
+	// coalesce nearby changes so scattered edits don't turn into one copy each
+	StagingRing *staging = getStagingRing(device);
+	Uint32 i = 0;
+	while (i < count) {
+		if (!changed[i]) {
+			i++;
+			continue;
+		}
+		Uint32 first = i;
+		Uint32 last = i;
+		for (i++; i < count && i - last <= MERGE_GAP; i++) {
+			if (changed[i]) last = i;
+		}
+		Uint32 n = last - first + 1;
+		staging->upload(objsBuffer, first * sizeof(SDFRenderObject), &renderObjs[first], n * sizeof(SDFRenderObject), false);
+		uploadStats.uploadedObjects += n;
+		uploadStats.ranges++;
+		i = last + 1;
+	}
+}
 
-	// clean up
-	SDL_EndGPUCopyPass(copyPass);
-	SDL_SubmitGPUCommandBuffer(cmdBuf);
-	SDL_ReleaseGPUTransferBuffer(device, transferBuf);
+// bin the last refreshed objects into screen tiles for this frame's
+// screen size/light and stage the lists. fills in the tile fields of sys
+void SDFPipeline::prepare(SDFSysData &sys) {
+	PROFILE_ZONE("SDFPipeline::prepare");
+	binner->bin(renderObjs, sys);
+	tileSize = binner->tileSize;
+	tileCols = binner->cols;
+	sys.tileSize = tileSize;
+	sys.tileCols = tileCols;
+
+	Uint32 tileCount = binner->tiles.size();
+	Uint32 indexCount = binner->indices.size();
+	tileBuffer = growStorage(device, tileBuffer, tileCapacity, tileCount, sizeof(SDFTile));
+	tileIndexBuffer = growStorage(device, tileIndexBuffer, tileIndexCapacity, indexCount, sizeof(Uint32));
+	StagingRing *staging = getStagingRing(device);
+	staging->upload(tileBuffer, 0, binner->tiles.data(), tileCount * sizeof(SDFTile), true);
+	staging->upload(tileIndexBuffer, 0, binner->indices.data(), indexCount * sizeof(Uint32), true);
 }
 
 void SDFPipeline::render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPURenderPass *pass, SDL_GPUTexture* target, SDFSysData sys) {
+	PROFILE_ZONE("SDFPipeline::render");
 	bool internalPass = pass == NULL;
 	if (internalPass) {
-		pass = SDL_BeginGPURenderPass(cmdBuf, new SDL_GPUColorTargetInfo {
+		pass = getGPUBackend()->beginRenderPass(cmdBuf, getFrameArena()->make(SDL_GPUColorTargetInfo {
 			.texture = target,
 			.clear_color = SDL_FColor{ 0.02f, 0.02f, 0.08f, 1.0f },
 			.load_op = SDL_GPU_LOADOP_LOAD,
 			.store_op = SDL_GPU_STOREOP_STORE,
-		}, 1, NULL);
+		}), 1, NULL);
 	}
 
-	SDL_BindGPUGraphicsPipeline(pass, pipeline);
-	SDL_PushGPUFragmentUniformData(cmdBuf, 0, &sys, sizeof(SDFSysData));
-	SDL_BindGPUFragmentStorageBuffers(pass, 0, &objsBuffer, 1);
-	SDL_DrawGPUPrimitives(pass, 6, 1, 0, 0);
+	// tile lists are only valid for the layout they were binned with
+	if (objsBuffer == NULL || tileBuffer == NULL || tileIndexBuffer == NULL) {
+		SDL_Log("ERR: SDF tiles not prepared");
+		if (internalPass) getGPUBackend()->endRenderPass(pass);
+		return;
+	}
+	sys.tileSize = tileSize;
+	sys.tileCols = tileCols;
+	getGPUBackend()->bindGraphicsPipeline(pass, pipeline);
+	getGPUBackend()->pushFragmentUniformData(cmdBuf, 0, &sys, sizeof(SDFSysData));
+	SDL_GPUBuffer *buffers[3] = { objsBuffer, tileBuffer, tileIndexBuffer };
+	getGPUBackend()->bindFragmentStorageBuffers(pass, 0, buffers, 3);
+	getGPUBackend()->drawPrimitives(pass, 6, 1, 0, 0);
 
 	if (internalPass) {
-		SDL_EndGPURenderPass(pass);
+		getGPUBackend()->endRenderPass(pass);
 	}
 }
 
 void SDFPipeline::destroy() {
-	SDL_ReleaseGPUBuffer(device, objsBuffer);
-  SDL_ReleaseGPUGraphicsPipeline(device, pipeline);
+	if (objsBuffer != NULL) getGPUBackend()->releaseBuffer(device, objsBuffer);
+	if (tileBuffer != NULL) getGPUBackend()->releaseBuffer(device, tileBuffer);
+	if (tileIndexBuffer != NULL) getGPUBackend()->releaseBuffer(device, tileIndexBuffer);
+	delete binner;
+  getGPUBackend()->releaseGraphicsPipeline(device, pipeline);
 }
 
 #pragma endregion SDFRenderer
@@ -281,29 +339,71 @@ float App::sdfAsOutline(float sdf, float thickness) {
 	return SDL_fabsf(sdf) - thickness;
 }
 
+// world space bounds of a shape, including corner and outline modifiers.
+// returns false for shapes without a usable bound (angled rects, none)
+bool App::sdfBounds(SDFRenderObject const &obj, glm::vec2 &lo, glm::vec2 &hi) {
+	switch (obj.objType) {
+		case 1:
+			lo = obj.center - glm::vec2(obj.radius);
+			hi = obj.center + glm::vec2(obj.radius);
+			break;
+		case 2:
+			lo = glm::vec2(SDL_min(obj.center.x, obj.v2.x), SDL_min(obj.center.y, obj.v2.y));
+			hi = glm::vec2(SDL_max(obj.center.x, obj.v2.x), SDL_max(obj.center.y, obj.v2.y));
+			break;
+		case 3:
+			lo = glm::vec2(
+				SDL_min(obj.center.x, SDL_min(obj.v2.x, obj.v3.x)),
+				SDL_min(obj.center.y, SDL_min(obj.v2.y, obj.v3.y))
+			);
+			hi = glm::vec2(
+				SDL_max(obj.center.x, SDL_max(obj.v2.x, obj.v3.x)),
+				SDL_max(obj.center.y, SDL_max(obj.v2.y, obj.v3.y))
+			);
+			break;
+		case 4:
+			lo = obj.center - obj.v2;
+			hi = obj.center + obj.v2;
+			break;
+		default:
+			return false;
+	}
+	// both modifiers only ever pull the surface outward by their amount
+	float pad = 0.0f;
+	if (obj.cornerRadius > 0.0f) pad += obj.cornerRadius;
+	if (obj.thickness > 0.0f) pad += obj.thickness;
+	lo = lo - glm::vec2(pad);
+	hi = hi + glm::vec2(pad);
+	return true;
+}
+
+float App::sdfToObject(glm::vec2 point, float maxDist, SDFRenderObject const &obj) {
+	float d = maxDist;
+	switch (obj.objType) {
+		case 1:
+			d = sdfToCir(point, obj.center, obj.radius);
+			break;
+		case 2:
+			d = sdfToLine(point, obj.center, obj.v2);
+			break;
+		case 3:
+			d = sdfToTriangle(point, obj.center, obj.v2, obj.v3);
+			break;
+		case 4:
+			d = sdfToRect(point, obj.center, obj.v2);
+			break;
+		default:
+			break;
+	}
+	if (obj.cornerRadius > 0.0f) d = sdfWithCorner(d, obj.cornerRadius);
+	if (obj.thickness > 0.0f) d = sdfAsOutline(d, obj.thickness);
+	return d;
+}
+
 float App::calculateSdf(glm::vec2 point, float maxDist, std::vector<SDFObject> *objs) {
 	float sdf = maxDist;
 	for (int i=0; i < objs->size(); i++) {
-		SDFRenderObject obj = objs->at(i).renderObject();
-		float d = maxDist;
-		switch (obj.objType) {
-			case 1:
-				d = sdfToCir(point, obj.center, obj.radius);
-				break;
-			case 2:
-				d = sdfToLine(point, obj.center, obj.v2);
-				break;
-			case 3:
-				d = sdfToTriangle(point, obj.center, obj.v2, obj.v3);
-				break;
-			case 4:
-				d = sdfToRect(point, obj.center, obj.v2);
-				break;
-			default:
-				break;
-		}
-		if (obj.cornerRadius > 0.0f) d = sdfWithCorner(d, obj.cornerRadius);
-		if (obj.thickness > 0.0f) d = sdfAsOutline(d, obj.thickness);
+		float d = sdfToObject(point, maxDist, objs->at(i).renderObject());
 		if (d < sdf) sdf = d;
 	}
 	return sdf;
@@ -36,6 +36,10 @@ namespace App {
     void updatePositionDelta(glm::vec2 delta);
     void updatePosition(glm::vec2 center);
     SDFRenderObject renderObject();
+    // set by every modifier and cleared once SDFPipeline has staged the object.
+    // objects shifted by erasing from the middle of the list need markDirty()
+    void markDirty() { dirty = true; }
+    bool dirty = true;
   protected:
     SDFObjectType type = SDF_None;
     glm::vec2 center = glm::vec2(0.0f);
@@ -53,20 +57,45 @@ namespace App {
     SDL_FColor lightColor;
     float lightDist;
     Uint32 objCount;
+    Uint32 tileSize;
+    Uint32 tileCols;
   };
+  struct SDFUploadStats {
+    Uint32 objects = 0;
+    Uint32 uploadedObjects = 0;
+    Uint32 ranges = 0;
+  };
+  class SDFTileBinner;
   class SDFPipeline {
   public:
+    static const Uint32 INITIAL_OBJECT_CAPACITY = 1024;
+    // dirty objects closer than this are uploaded as one range
+    static const Uint32 MERGE_GAP = 8;
     SDFPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu);
     void refreshObjects(std::vector<SDFObject> &objs);
+    void prepare(SDFSysData &sys);
     void render(
       SDL_GPUCommandBuffer *cmdBuf, SDL_GPURenderPass *pass,
       SDL_GPUTexture* target, SDFSysData sys
     );
     void destroy();
+    SDFUploadStats uploadStats;
   private:
     SDL_GPUDevice *device;
     SDL_GPUGraphicsPipeline *pipeline = NULL;
+    // persistent copy of renderObjs, only dirty ranges are rewritten
     SDL_GPUBuffer *objsBuffer = NULL;
+    Uint32 objsCapacity = 0;
+    std::vector<Uint8> changed;
+    // per tile object lists, see SDFTileBinner
+    SDFTileBinner *binner = NULL;
+    std::vector<SDFRenderObject> renderObjs;
+    SDL_GPUBuffer *tileBuffer = NULL;
+    SDL_GPUBuffer *tileIndexBuffer = NULL;
+    Uint32 tileCapacity = 0;
+    Uint32 tileIndexCapacity = 0;
+    Uint32 tileSize = 0;
+    Uint32 tileCols = 0;
   };
   // sdf math
   float sdfToCir(glm::vec2 point, glm::vec2 center, float radius);
@@ -75,6 +104,8 @@ namespace App {
   float sdfToRect(glm::vec2 point, glm::vec2 center, glm::vec2 size);
   float sdfWithCorner(float sdf, float radius);
   float sdfAsOutline(float sdf, float thickness);
+  float sdfToObject(glm::vec2 point, float maxDist, SDFRenderObject const &obj);
+  bool sdfBounds(SDFRenderObject const &obj, glm::vec2 &lo, glm::vec2 &hi);
   float calculateSdf(glm::vec2 point, float maxDist, std::vector<SDFObject> *objs);
   float calculateRayMarch(glm::vec2 point, glm::vec2 direction, float maxDist, std::vector<SDFObject> *objs);
 }
\ No newline at end of file
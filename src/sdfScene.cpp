@@ -24,22 +24,41 @@ SdfScene::SdfScene(SDL_GPUDevice *gpu, SDL_GPUTextureFormat targetFormat) : Scen
 SDL_AppResult SdfScene::update(SystemUpdates const &sys) {
   screenSize = sys.winSize;
   sdfLightPos = sys.mousePosScreenSpace;
-
-  return SDL_APP_CONTINUE;
-}
-
-SDL_AppResult SdfScene::render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* screen) {
-  sdfPipe->refreshObjects(objects);
-  sdfPipe->render(cmdBuf, NULL, screen, SDFSysData {
+  sysData = SDFSysData {
     .screenSize = screenSize,
     .lightPos = sdfLightPos,
     .lightColor = SDL_FColor{0.8f, 0.8f, 0.2f, 0.8f},
     .lightDist = 800.0f,
     .objCount = (Uint32)objects.size()
-  });
+  };
+  // F2 - compare batched/grid cpu sdf queries against calculateSdf,
+  // and check the tile binning against a brute force reference
+  bool benchKey = sys.kbStates != NULL && sys.kbStates[SDL_SCANCODE_F2];
+  if (benchKey && !benchKeyHeld) {
+    benchmarkSdfBatch(objects, screenSize, 100000);
+    benchmarkSdfGrid(objects, screenSize, 100000);
+    validateSdfTiles(objects, sysData, 10000);
+  }
+  benchKeyHeld = benchKey;
+  // stage object data and tile lists ahead of the frame's copy pass
+  sdfPipe->refreshObjects(objects);
+  sdfPipe->prepare(sysData);
+
   return SDL_APP_CONTINUE;
 }
 
+SDL_AppResult SdfScene::render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* screen) {
+  sdfPipe->render(cmdBuf, NULL, screen, sysData);
+  return SDL_APP_CONTINUE;
+}
+
+std::string SdfScene::debugInfo() {
+  SDFUploadStats const &st = sdfPipe->uploadStats;
+  char str[100];
+  SDL_snprintf(str, sizeof(str), "SDF: %d objects, %d uploaded in %d ranges", st.objects, st.uploadedObjects, st.ranges);
+  return str;
+}
+
 void SdfScene::destroy() {
   objects.clear();
   sdfPipe->destroy();
@@ -0,0 +1,231 @@
+#include "sdfTiles.hpp"
+#include "profiler.hpp"
+
+using namespace App;
+
+#pragma region Binning
+
+// separating axis test between a box and the convex hull of another box
+// and the light. hull edges are the box edges plus segments from the light
+// to the box corners, testing every one of those axes is exact
+static bool hullOverlaps(glm::vec2 bLo, glm::vec2 bHi, glm::vec2 light, glm::vec2 aLo, glm::vec2 aHi) {
+  if (aHi.x < SDL_min(bLo.x, light.x) || aLo.x > SDL_max(bHi.x, light.x)) return false;
+  if (aHi.y < SDL_min(bLo.y, light.y) || aLo.y > SDL_max(bHi.y, light.y)) return false;
+
+  glm::vec2 corners[4] = {
+    bLo, glm::vec2(bHi.x, bLo.y), bHi, glm::vec2(bLo.x, bHi.y)
+  };
+  glm::vec2 aCenter = (aLo + aHi) * 0.5f;
+  glm::vec2 aHalf = (aHi - aLo) * 0.5f;
+  for (glm::vec2 const &c : corners) {
+    glm::vec2 axis = glm::vec2(light.y - c.y, c.x - light.x);
+    if (axis.x == 0.0f && axis.y == 0.0f) continue;
+    float hMin = glm::dot(axis, light);
+    float hMax = hMin;
+    for (glm::vec2 const &v : corners) {
+      float d = glm::dot(axis, v);
+      hMin = SDL_min(hMin, d);
+      hMax = SDL_max(hMax, d);
+    }
+    float center = glm::dot(axis, aCenter);
+    float radius = aHalf.x * SDL_fabsf(axis.x) + aHalf.y * SDL_fabsf(axis.y);
+    if (center + radius < hMin || center - radius > hMax) return false;
+  }
+  return true;
+}
+
+void SDFTileBinner::bin(std::vector<SDFRenderObject> const &objs, SDFSysData const &sys, Uint32 size) {
+  PROFILE_ZONE("SDFTileBinner::bin");
+  tileSize = size;
+  float ts = (float)tileSize;
+  cols = SDL_max((Uint32)SDL_ceilf(sys.screenSize.x / ts), 1);
+  rows = SDL_max((Uint32)SDL_ceilf(sys.screenSize.y / ts), 1);
+  Uint32 tileCount = cols * rows;
+  tiles.assign(tileCount, SDFTile {});
+  lit.assign(tileCount, 0);
+  entries.clear();
+  stats = SDFTileStats {};
+  stats.tiles = tileCount;
+
+  // tiles that ray march towards the light
+  glm::vec2 light = sys.lightPos;
+  int lx0 = cols, ly0 = rows, lx1 = -1, ly1 = -1;
+  if (sys.lightDist > 0.01f) {
+    for (int y=0; y < rows; y++) {
+      for (int x=0; x < cols; x++) {
+        glm::vec2 lo = glm::vec2(x * ts, y * ts);
+        glm::vec2 nearest = glm::vec2(
+          SDL_clamp(light.x, lo.x, lo.x + ts),
+          SDL_clamp(light.y, lo.y, lo.y + ts)
+        );
+        if (glm::length(nearest - light) >= sys.lightDist) continue;
+        lit[y * cols + x] = 1;
+        stats.litTiles++;
+        lx0 = SDL_min(lx0, x);
+        ly0 = SDL_min(ly0, y);
+        lx1 = SDL_max(lx1, x);
+        ly1 = SDL_max(ly1, y);
+      }
+    }
+  }
+
+  for (Uint32 i=0; i < objs.size(); i++) {
+    glm::vec2 lo, hi;
+    if (!sdfBounds(objs[i], lo, hi)) {
+      for (Uint32 t=0; t < tileCount; t++) entries.push_back(Entry { t, i });
+      continue;
+    }
+    // tiles the shape colors
+    glm::vec2 cLo = lo - glm::vec2(COLOR_MARGIN);
+    glm::vec2 cHi = hi + glm::vec2(COLOR_MARGIN);
+    int cx0 = SDL_max((int)SDL_floorf(cLo.x / ts), 0);
+    int cy0 = SDL_max((int)SDL_floorf(cLo.y / ts), 0);
+    int cx1 = SDL_min((int)SDL_floorf(cHi.x / ts), (int)cols - 1);
+    int cy1 = SDL_min((int)SDL_floorf(cHi.y / ts), (int)rows - 1);
+    // lit tiles it may shadow, which lie beyond the shape as seen from the light
+    glm::vec2 sLo = lo - glm::vec2(SHADOW_MARGIN);
+    glm::vec2 sHi = hi + glm::vec2(SHADOW_MARGIN);
+    int sx0 = lx0, sy0 = ly0, sx1 = lx1, sy1 = ly1;
+    if (sLo.x > light.x) sx0 = SDL_max(sx0, (int)SDL_floorf(sLo.x / ts));
+    if (sHi.x < light.x) sx1 = SDL_min(sx1, (int)SDL_floorf(sHi.x / ts));
+    if (sLo.y > light.y) sy0 = SDL_max(sy0, (int)SDL_floorf(sLo.y / ts));
+    if (sHi.y < light.y) sy1 = SDL_min(sy1, (int)SDL_floorf(sHi.y / ts));
+
+    int x0 = cx0, y0 = cy0, x1 = cx1, y1 = cy1;
+    if (sx0 <= sx1 && sy0 <= sy1) {
+      x0 = SDL_min(x0, sx0);
+      y0 = SDL_min(y0, sy0);
+      x1 = SDL_max(x1, sx1);
+      y1 = SDL_max(y1, sy1);
+    }
+    for (int y = y0; y <= y1; y++) {
+      for (int x = x0; x <= x1; x++) {
+        Uint32 t = y * cols + x;
+        bool hit = x >= cx0 && x <= cx1 && y >= cy0 && y <= cy1;
+        if (!hit && lit[t] && x >= sx0 && x <= sx1 && y >= sy0 && y <= sy1) {
+          glm::vec2 tLo = glm::vec2(x * ts, y * ts) - glm::vec2(SHADOW_OFFSET);
+          glm::vec2 tHi = glm::vec2((x + 1) * ts, (y + 1) * ts) + glm::vec2(SHADOW_OFFSET);
+          hit = hullOverlaps(tLo, tHi, light, sLo, sHi);
+        }
+        if (hit) entries.push_back(Entry { t, i });
+      }
+    }
+  }
+
+  // stable counting sort into one compact list per tile
+  for (Entry const &e : entries) tiles[e.tile].count++;
+  Uint32 offset = 0;
+  for (SDFTile &tile : tiles) {
+    tile.offset = offset;
+    offset += tile.count;
+    stats.maxPerTile = SDL_max(stats.maxPerTile, tile.count);
+    tile.count = 0;
+  }
+  indices.resize(entries.size());
+  for (Entry const &e : entries) {
+    SDFTile &tile = tiles[e.tile];
+    indices[tile.offset + tile.count] = e.obj;
+    tile.count++;
+  }
+  stats.entries = entries.size();
+}
+
+#pragma endregion Binning
+
+#pragma region Validation
+
+// slab test of a segment against a box
+static bool segmentHitsBox(glm::vec2 a, glm::vec2 b, glm::vec2 lo, glm::vec2 hi) {
+  glm::vec2 d = b - a;
+  float tMin = 0.0f;
+  float tMax = 1.0f;
+  for (int axis=0; axis < 2; axis++) {
+    float o = axis == 0 ? a.x : a.y;
+    float dir = axis == 0 ? d.x : d.y;
+    float bLo = axis == 0 ? lo.x : lo.y;
+    float bHi = axis == 0 ? hi.x : hi.y;
+    if (SDL_fabsf(dir) < 1e-6f) {
+      if (o < bLo || o > bHi) return false;
+      continue;
+    }
+    float t0 = (bLo - o) / dir;
+    float t1 = (bHi - o) / dir;
+    if (t0 > t1) {
+      float tmp = t0;
+      t0 = t1;
+      t1 = tmp;
+    }
+    tMin = SDL_max(tMin, t0);
+    tMax = SDL_min(tMax, t1);
+    if (tMin > tMax) return false;
+  }
+  return true;
+}
+
+// headless check of the binner against a brute force reference. every object
+// left out of a sampled pixel's tile must neither color that pixel nor come
+// near its shadow ray. every other sample sits within a few pixels of the
+// light radius, where marching starts and stops
+bool App::validateSdfTiles(std::vector<SDFObject> &objs, SDFSysData sys, Uint32 sampleCount) {
+  std::vector<SDFRenderObject> renderObjs;
+  for (SDFObject &o : objs) renderObjs.push_back(o.renderObject());
+
+  SDFTileBinner binner;
+  Uint64 t0 = SDL_GetPerformanceCounter();
+  binner.bin(renderObjs, sys);
+  double ms = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+  SDFTileStats const &st = binner.stats;
+  SDL_Log(
+    "SDF tiles: %dx%d tiles (%d lit), %d entries, %.1f per tile (max %d) vs %d objects - binned in %.3f ms",
+    binner.cols, binner.rows, st.litTiles, st.entries,
+    (float)st.entries / st.tiles, st.maxPerTile, (int)objs.size(), ms
+  );
+
+  Uint32 failures = 0;
+  Uint64 seed = 1;
+  std::vector<Uint8> listed(renderObjs.size());
+  for (Uint32 s=0; s < sampleCount; s++) {
+    glm::vec2 p = glm::vec2(SDL_randf_r(&seed) * sys.screenSize.x, SDL_randf_r(&seed) * sys.screenSize.y);
+    if (s % 2 == 1 && sys.lightDist > 0.01f) {
+      float angle = SDL_randf_r(&seed) * 2.0f * SDL_PI_F;
+      float r = sys.lightDist + SDL_randf_r(&seed) * 8.0f - 4.0f;
+      p = sys.lightPos + glm::vec2(SDL_cosf(angle), SDL_sinf(angle)) * r;
+      p.x = SDL_clamp(p.x, 0.0f, sys.screenSize.x - 1.0f);
+      p.y = SDL_clamp(p.y, 0.0f, sys.screenSize.y - 1.0f);
+    }
+    // pixel centers, like gl_FragCoord
+    p = glm::vec2(SDL_floorf(p.x) + 0.5f, SDL_floorf(p.y) + 0.5f);
+    Uint32 tx = SDL_min((Uint32)(p.x / binner.tileSize), binner.cols - 1);
+    Uint32 ty = SDL_min((Uint32)(p.y / binner.tileSize), binner.rows - 1);
+    Uint32 t = ty * binner.cols + tx;
+    SDFTile tile = binner.tiles[t];
+    SDL_memset(listed.data(), 0, listed.size());
+    for (Uint32 i=0; i < tile.count; i++) listed[binner.indices[tile.offset + i]] = 1;
+
+    float distFromLight = glm::length(p - sys.lightPos);
+    bool marches = sys.lightDist > 0.01f && distFromLight < sys.lightDist && distFromLight > 0.001f;
+    glm::vec2 start = p;
+    if (marches) start = p - glm::normalize(p - sys.lightPos) * SDFTileBinner::SHADOW_OFFSET;
+
+    for (Uint32 i=0; i < renderObjs.size(); i++) {
+      if (listed[i]) continue;
+      glm::vec2 lo, hi;
+      bool bad = !sdfBounds(renderObjs[i], lo, hi);
+      if (!bad) bad = sdfToObject(p, 10000.0f, renderObjs[i]) < SDFTileBinner::COLOR_MARGIN;
+      if (!bad && marches) {
+        // objects within the shadow smoothing distance still soften the ray
+        glm::vec2 pad = glm::vec2(SDFTileBinner::SHADOW_OFFSET);
+        bad = !binner.isLit(t) || segmentHitsBox(start, sys.lightPos, lo - pad, hi + pad);
+      }
+      if (!bad) continue;
+      if (failures < 8) {
+        SDL_Log("ERR: SDF tiles: object %d missing from tile %d (pixel %.1f, %.1f)", i, t, p.x, p.y);
+      }
+      failures++;
+    }
+  }
+  SDL_Log("SDF tiles: %d samples checked, %d failures", sampleCount, failures);
+  return failures == 0;
+}
+
+#pragma endregion Validation
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+#include <glm/vec2.hpp>
+#include "sdfPipeline.hpp"
+
+namespace App {
+  // matches uvec2 tiles[] in sdf.frag
+  struct SDFTile {
+    Uint32 offset = 0;
+    Uint32 count = 0;
+  };
+  struct SDFTileStats {
+    Uint32 tiles = 0;
+    Uint32 litTiles = 0;
+    Uint32 entries = 0;
+    Uint32 maxPerTile = 0;
+  };
+  // assigns objects to screen tiles for sdf.frag. a tile lists every object
+  // that can color its pixels or sit on a shadow ray from them to the light.
+  // lists keep the original object order so colors blend the same way
+  class SDFTileBinner {
+  public:
+    static const Uint32 DEFAULT_TILE_SIZE = 32;
+    // edge smoothing in sdf.frag reaches 1px outside a shape
+    static constexpr float COLOR_MARGIN = 1.0f;
+    // shadow rays start 2px behind the pixel and soften within 2px of a shape
+    static constexpr float SHADOW_OFFSET = 2.0f;
+    static constexpr float SHADOW_MARGIN = 3.0f;
+    void bin(std::vector<SDFRenderObject> const &objs, SDFSysData const &sys, Uint32 size = DEFAULT_TILE_SIZE);
+    bool isLit(Uint32 tile) const { return lit[tile] != 0; }
+    std::vector<SDFTile> tiles;
+    std::vector<Uint32> indices;
+    Uint32 tileSize = DEFAULT_TILE_SIZE;
+    Uint32 cols = 0;
+    Uint32 rows = 0;
+    SDFTileStats stats;
+  private:
+    struct Entry {
+      Uint32 tile;
+      Uint32 obj;
+    };
+    std::vector<Entry> entries;
+    std::vector<Uint8> lit;
+  };
+  bool validateSdfTiles(std::vector<SDFObject> &objs, SDFSysData sys, Uint32 sampleCount);
+}
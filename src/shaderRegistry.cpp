@@ -0,0 +1,223 @@
+#include "shaderRegistry.hpp"
+#include "gpuBackend.hpp"
+#include "assetPak.hpp"
+#include "pakFormat.hpp"
+
+using namespace App;
+
+struct ShaderFormatInfo {
+  SDL_GPUShaderFormat format;
+  const char *dir;
+  const char *ext;
+  const char *entrypoint;
+};
+
+// in order of preference when a device supports several
+static const ShaderFormatInfo SHADER_FORMATS[] = {
+  { SDL_GPU_SHADERFORMAT_SPIRV, "SPIRV", "spv", "main" },
+  { SDL_GPU_SHADERFORMAT_MSL, "MSL", "msl", "main0" },
+  { SDL_GPU_SHADERFORMAT_DXIL, "DXIL", "dxil", "main" },
+};
+
+static std::string moduleKey(const char *name, SDL_GPUShaderFormat format) {
+  return std::string(name) + "|" + std::to_string(format);
+}
+
+// the stage is part of the source file name
+static bool stageFromName(const char *name, SDL_GPUShaderStage *stage) {
+  if (SDL_strstr(name, ".vert")) {
+    *stage = SDL_GPU_SHADERSTAGE_VERTEX;
+    return true;
+  }
+  if (SDL_strstr(name, ".frag")) {
+    *stage = SDL_GPU_SHADERSTAGE_FRAGMENT;
+    return true;
+  }
+  return false;
+}
+
+// bytecode matching a blob already held is dropped in favour of that blob
+Uint8 const* ShaderRegistry::keepUnique(void const *data, size_t size, bool owned) {
+  Uint64 hash = pakHash(data, size);
+  for (Blob const &b : blobs) {
+    if (b.hash != hash || b.size != size || SDL_memcmp(b.data, data, size) != 0) continue;
+    if (owned) SDL_free((void*)data);
+    stats.duplicates++;
+    return static_cast<Uint8 const*>(b.data);
+  }
+  blobs.push_back(Blob{ data, size, hash, owned });
+  stats.residentBytes += size;
+  return static_cast<Uint8 const*>(data);
+}
+
+// registers every shader in the bundle, the blob stays resident until clear()
+bool ShaderRegistry::loadBundle(const char *path) {
+  Uint64 t0 = SDL_GetTicksNS();
+  size_t size = 0;
+  bool owned = false;
+  Uint8 const *base = static_cast<Uint8 const*>(loadAsset(path, &size, &owned));
+  stats.ioNS += SDL_GetTicksNS() - t0;
+  if (base == NULL) {
+    SDL_Log("Shader bundle %s not found, shaders are loaded individually", path);
+    return false;
+  }
+
+  ShaderBundleHeader const *header = reinterpret_cast<ShaderBundleHeader const*>(base);
+  Uint64 namesOffset = sizeof(ShaderBundleHeader);
+  bool valid = size >= sizeof(ShaderBundleHeader) &&
+    header->magic == SHADER_BUNDLE_MAGIC && header->version == SHADER_BUNDLE_VERSION;
+  if (valid) {
+    namesOffset += (Uint64)header->entryCount * sizeof(ShaderBundleEntry);
+    valid = namesOffset + header->namesSize <= size && header->namesSize > 0 &&
+      base[namesOffset + header->namesSize - 1] == '\0';
+  }
+  ShaderBundleEntry const *entries = reinterpret_cast<ShaderBundleEntry const*>(base + sizeof(ShaderBundleHeader));
+  for (Uint32 i=0; valid && i < header->entryCount; i++) {
+    ShaderBundleEntry const &e = entries[i];
+    valid = e.nameOffset < header->namesSize && e.codeOffset <= size && e.codeSize <= size - e.codeOffset;
+  }
+  if (!valid) {
+    SDL_Log("ERR: Shader bundle %s is corrupt", path);
+    if (owned) SDL_free((void*)base);
+    return false;
+  }
+
+  char const *names = reinterpret_cast<char const*>(base + namesOffset);
+  for (Uint32 i=0; i < header->entryCount; i++) {
+    ShaderBundleEntry const &e = entries[i];
+    ShaderCode code;
+    code.code = keepUnique(base + e.codeOffset, e.codeSize, false);
+    code.size = e.codeSize;
+    code.format = e.format;
+    code.stage = (SDL_GPUShaderStage)e.stage;
+    // loose files and earlier bundles win
+    modules.emplace(moduleKey(names + e.nameOffset, code.format), code);
+  }
+  bundles.push_back({ base, owned });
+  stats.bundleEntries += header->entryCount;
+  stats.bundleBytes += size;
+  return true;
+}
+
+ShaderCode const* ShaderRegistry::find(const char *name, SDL_GPUShaderFormat format) {
+  stats.lookups++;
+  std::string key = moduleKey(name, format);
+  auto it = modules.find(key);
+  if (it != modules.end()) {
+    stats.cacheHits++;
+    return &it->second;
+  }
+
+  ShaderCode code;
+  code.format = format;
+  if (!stageFromName(name, &code.stage)) {
+    SDL_Log("ERR: Invalid shader stage for %s", name);
+    return NULL;
+  }
+  ShaderFormatInfo const *info = NULL;
+  for (ShaderFormatInfo const &f : SHADER_FORMATS) {
+    if (f.format == format) info = &f;
+  }
+  if (info == NULL) {
+    SDL_Log("ERR: Unrecognized shader format %x", format);
+    return NULL;
+  }
+
+  // not bundled, fall back to the compiled file
+  char fullPath[256];
+  SDL_snprintf(fullPath, sizeof(fullPath), "assets/%s/%s.%s", info->dir, name, info->ext);
+  Uint64 t0 = SDL_GetTicksNS();
+  bool owned = false;
+  void const *data = loadAsset(fullPath, &code.size, &owned);
+  stats.ioNS += SDL_GetTicksNS() - t0;
+  if (data == NULL) {
+    SDL_Log("ERR: Failed to load shader from disk! %s", fullPath);
+    return NULL;
+  }
+  stats.filesLoaded++;
+  code.code = keepUnique(data, code.size, owned);
+  return &modules.emplace(key, code).first->second;
+}
+
+// based on the utility function from https://github.com/TheSpydog/SDL_gpu_examples/blob/main/Examples/Common.c
+SDL_GPUShader* ShaderRegistry::createShader(
+  SDL_GPUDevice *device,
+  const char *name,
+  Uint32 samplerCount,
+  Uint32 uniformBufferCount,
+  Uint32 storageBufferCount,
+  Uint32 storageTextureCount
+) {
+  SDL_GPUShaderFormat backendFormats = getGPUBackend()->getShaderFormats(device);
+  ShaderFormatInfo const *info = NULL;
+  for (ShaderFormatInfo const &f : SHADER_FORMATS) {
+    if (info == NULL && (backendFormats & f.format)) info = &f;
+  }
+  if (info == NULL) {
+    SDL_Log("%s", "Unrecognized backend shader format!");
+    return NULL;
+  }
+  ShaderCode const *code = find(name, info->format);
+  if (code == NULL) return NULL;
+
+  SDL_GPUShaderCreateInfo shaderInfo = {
+    .code_size = code->size,
+    .code = code->code,
+    .entrypoint = info->entrypoint,
+    .format = code->format,
+    .stage = code->stage,
+    .num_samplers = samplerCount,
+    .num_storage_textures = storageTextureCount,
+    .num_storage_buffers = storageBufferCount,
+    .num_uniform_buffers = uniformBufferCount
+  };
+  Uint64 t0 = SDL_GetTicksNS();
+  SDL_GPUShader *shader = getGPUBackend()->createShader(device, &shaderInfo);
+  stats.createNS += SDL_GetTicksNS() - t0;
+  if (shader == NULL) {
+    SDL_Log("Failed to create shader %s: %s", name, SDL_GetError());
+    return NULL;
+  }
+  stats.modulesCreated++;
+  return shader;
+}
+
+// shader I/O is reported apart from module creation for startup profiles
+void ShaderRegistry::logStats() const {
+  SDL_Log(
+    "Shaders: bundle %d entries (%.1f KB), %d loose files, I/O %.2f ms | "
+    "%d lookups (%d cached), %d duplicates dropped, %.1f KB resident | %d modules created in %.2f ms",
+    stats.bundleEntries, stats.bundleBytes / 1024.0f, stats.filesLoaded, stats.ioNS / 1e6,
+    stats.lookups, stats.cacheHits, stats.duplicates, stats.residentBytes / 1024.0f,
+    stats.modulesCreated, stats.createNS / 1e6
+  );
+}
+
+void ShaderRegistry::clear() {
+  for (Blob const &b : blobs) {
+    if (b.owned) SDL_free((void*)b.data);
+  }
+  for (auto const &bundle : bundles) {
+    if (bundle.second) SDL_free((void*)bundle.first);
+  }
+  blobs.clear();
+  bundles.clear();
+  modules.clear();
+  stats = ShaderLoadStats();
+}
+
+static ShaderRegistry *shaderRegistry = NULL;
+
+// bytecode doesn't depend on the device, one registry serves all of them
+ShaderRegistry* App::getShaderRegistry() {
+  if (shaderRegistry == NULL) shaderRegistry = new ShaderRegistry();
+  return shaderRegistry;
+}
+
+// bundled bytecode may point into the mounted asset pak, destroy before unmounting
+void App::destroyShaderRegistry() {
+  if (shaderRegistry == NULL) return;
+  shaderRegistry->clear();
+  delete shaderRegistry;
+  shaderRegistry = NULL;
+}
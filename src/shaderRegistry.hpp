@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+
+namespace App {
+  struct ShaderCode {
+    Uint8 const *code = NULL;
+    size_t size = 0;
+    SDL_GPUShaderFormat format = SDL_GPU_SHADERFORMAT_INVALID;
+    SDL_GPUShaderStage stage = SDL_GPU_SHADERSTAGE_VERTEX;
+  };
+  struct ShaderLoadStats {
+    Uint32 bundleEntries = 0;
+    Uint64 bundleBytes = 0;
+    Uint32 filesLoaded = 0;
+    Uint32 lookups = 0;
+    Uint32 cacheHits = 0;
+    Uint32 duplicates = 0;
+    Uint32 modulesCreated = 0;
+    Uint64 residentBytes = 0;
+    Uint64 ioNS = 0;
+    Uint64 createNS = 0;
+  };
+  // resident shader bytecode keyed by source name ("obj.vert") and format.
+  // the shader bundle is read once at startup, shaders missing from it are
+  // loaded from loose files on first use. identical bytecode is kept once
+  class ShaderRegistry {
+  public:
+    bool loadBundle(const char *path);
+    ShaderCode const* find(const char *name, SDL_GPUShaderFormat format);
+    SDL_GPUShader* createShader(
+      SDL_GPUDevice *device, const char *name, Uint32 samplerCount,
+      Uint32 uniformBufferCount, Uint32 storageBufferCount, Uint32 storageTextureCount
+    );
+    ShaderLoadStats const &loadStats() const { return stats; }
+    void logStats() const;
+    void clear();
+  private:
+    struct Blob {
+      void const *data;
+      size_t size;
+      Uint64 hash;
+      bool owned;
+    };
+    Uint8 const* keepUnique(void const *data, size_t size, bool owned);
+    std::unordered_map<std::string, ShaderCode> modules;
+    std::vector<Blob> blobs;
+    std::vector<std::pair<void const*, bool>> bundles;
+    ShaderLoadStats stats;
+  };
+  ShaderRegistry* getShaderRegistry();
+  void destroyShaderRegistry();
+}
@@ -0,0 +1,287 @@
+#include <unordered_map>
+#include "stagingRing.hpp"
+#include "gpuBackend.hpp"
+#include "profiler.hpp"
+
+using namespace App;
+
+StagingRing::StagingRing(SDL_GPUDevice *gpu, Uint32 size) {
+  device = gpu;
+  capacity = size;
+  SDL_GPUTransferBufferCreateInfo info = {
+    .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+    .size = capacity,
+  };
+  ringBuf = getGPUBackend()->createTransferBuffer(device, &info);
+  if (ringBuf == NULL) {
+    SDL_Log("ERR: Failed to create staging ring - %s", SDL_GetError());
+    capacity = 0;
+  }
+}
+
+// reserve space for an upload and return a pointer to write it into.
+// the copy into dst is recorded on the next flush/submit
+void* StagingRing::stage(SDL_GPUBuffer *dst, Uint32 dstOffset, Uint32 size, bool cycle) {
+  if (size == 0 || dst == NULL) return NULL;
+  Uint32 aligned = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  if (aligned > capacity) {
+    return stageOversized(dst, dstOffset, size, cycle);
+  }
+  Uint32 claimed = 0;
+  Sint64 offset = reserve(aligned, claimed);
+  if (offset < 0) {
+    return stageOversized(dst, dstOffset, size, cycle);
+  }
+
+  // reserve may have submitted and unmapped the ring, so map after it
+  if (mapped == NULL) {
+    mapped = static_cast<Uint8*>(getGPUBackend()->mapTransferBuffer(device, ringBuf, false));
+    if (mapped == NULL) {
+      SDL_Log("ERR: Failed to map staging ring - %s", SDL_GetError());
+      // nothing was written, hand the claim back
+      used -= claimed;
+      batchBytes -= claimed;
+      head = (offset + aligned + capacity - claimed) % capacity;
+      return NULL;
+    }
+  }
+  pending.push_back(PendingCopy { ringBuf, (Uint32)offset, dst, dstOffset, size, cycle });
+  stats.bytesStaged += size;
+  return mapped + offset;
+}
+
+void StagingRing::upload(SDL_GPUBuffer *dst, Uint32 dstOffset, void const *data, Uint32 size, bool cycle) {
+  void *ptr = stage(dst, dstOffset, size, cycle);
+  if (ptr == NULL) return;
+  SDL_memcpy(ptr, data, size);
+}
+
+// uploads larger than the whole ring get a one-off transfer buffer
+void* StagingRing::stageOversized(SDL_GPUBuffer *dst, Uint32 dstOffset, Uint32 size, bool cycle) {
+  SDL_GPUTransferBufferCreateInfo info = {
+    .usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+    .size = size,
+  };
+  SDL_GPUTransferBuffer *tBuf = getGPUBackend()->createTransferBuffer(device, &info);
+  if (tBuf == NULL) {
+    SDL_Log("ERR: Failed to create transfer buffer - %s", SDL_GetError());
+    return NULL;
+  }
+  void *ptr = getGPUBackend()->mapTransferBuffer(device, tBuf, false);
+  if (ptr == NULL) {
+    SDL_Log("ERR: Failed to map transfer buffer - %s", SDL_GetError());
+    getGPUBackend()->releaseTransferBuffer(device, tBuf);
+    return NULL;
+  }
+  oversizedMapped.push_back(tBuf);
+  pending.push_back(PendingCopy { tBuf, 0, dst, dstOffset, size, cycle });
+  stats.bytesStaged += size;
+  stats.oversized++;
+  return ptr;
+}
+
+// claim aligned bytes at the head, waiting on older batches if necessary.
+// returns the offset into the ring or -1 if the space can't be freed.
+// claimed is the space taken, including any tail skipped to fit
+Sint64 StagingRing::reserve(Uint32 aligned, Uint32 &claimed) {
+  retire();
+  while (true) {
+    // ring is idle, restart from the front to avoid wrapping
+    if (used == 0) head = 0;
+    // skip the tail end of the ring if the upload doesn't fit there
+    Uint32 waste = head + aligned > capacity ? capacity - head : 0;
+    if (capacity - used >= waste + aligned) {
+      Uint32 offset = waste > 0 ? 0 : head;
+      claimed = waste + aligned;
+      used += claimed;
+      batchBytes += claimed;
+      head = (offset + aligned) % capacity;
+      return offset;
+    }
+    if (inFlightHead < inFlight.size()) {
+      Uint64 t0 = SDL_GetTicksNS();
+      Batch &oldest = inFlight[inFlightHead];
+      if (oldest.fence != NULL) {
+        getGPUBackend()->waitForFences(device, true, &oldest.fence, 1);
+      }
+      stats.stalls++;
+      stats.stallTimeNS += SDL_GetTicksNS() - t0;
+      retire();
+    } else if (batchBytes > 0) {
+      // current batch alone fills the ring - push it out early
+      submit();
+    } else {
+      // remaining space is held by the frame that hasn't been submitted yet
+      return -1;
+    }
+  }
+}
+
+// release batches whose fences have signalled
+void StagingRing::retire() {
+  while (inFlightHead < inFlight.size()) {
+    Batch &oldest = inFlight[inFlightHead];
+    if (oldest.fence != NULL) {
+      if (!getGPUBackend()->queryFence(device, oldest.fence)) return;
+      getGPUBackend()->releaseFence(device, oldest.fence);
+    }
+    used -= oldest.bytes;
+    inFlightHead++;
+  }
+  inFlight.clear();
+  inFlightHead = 0;
+}
+
+void StagingRing::pushBatch(Batch batch) {
+  if (inFlightHead > 0 && inFlight.size() == inFlight.capacity()) {
+    inFlight.erase(inFlight.begin(), inFlight.begin() + inFlightHead);
+    inFlightHead = 0;
+  }
+  inFlight.push_back(batch);
+}
+
+Uint32 StagingRing::recordCopies(SDL_GPUCommandBuffer *cmdBuf) {
+  if (pending.empty()) return 0;
+  if (mapped != NULL) {
+    getGPUBackend()->unmapTransferBuffer(device, ringBuf);
+    mapped = NULL;
+  }
+  for (SDL_GPUTransferBuffer *tBuf : oversizedMapped) {
+    getGPUBackend()->unmapTransferBuffer(device, tBuf);
+    oversizedInFlight.push_back(tBuf);
+  }
+  oversizedMapped.clear();
+
+  SDL_GPUCopyPass *copyPass = getGPUBackend()->beginCopyPass(cmdBuf);
+  for (PendingCopy const &cp : pending) {
+    SDL_GPUTransferBufferLocation src = {
+      .transfer_buffer = cp.src,
+      .offset = cp.srcOffset,
+    };
+    SDL_GPUBufferRegion dst = {
+      .buffer = cp.dst,
+      .offset = cp.dstOffset,
+      .size = cp.size,
+    };
+    getGPUBackend()->uploadToBuffer(copyPass, &src, &dst, cp.cycle);
+  }
+  getGPUBackend()->endCopyPass(copyPass);
+  stats.copies += pending.size();
+  stats.copyPasses++;
+  pending.clear();
+
+  Uint32 bytes = batchBytes;
+  batchBytes = 0;
+  return bytes;
+}
+
+// record every staged upload into a single copy pass on the frame's cmd buffer
+void StagingRing::flush(SDL_GPUCommandBuffer *cmdBuf) {
+  PROFILE_ZONE("StagingRing::flush");
+  recorded.insert(recorded.end(), pending.begin(), pending.end());
+  frameBytes += recordCopies(cmdBuf);
+}
+
+// the copies never ran, but their source bytes are still in the ring.
+// they go back in front of anything staged since and out with the next flush.
+// oversized sources stay in oversizedInFlight, that flush comes before endFrame releases them
+void StagingRing::cancel() {
+  if (recorded.empty()) return;
+  pending.insert(pending.begin(), recorded.begin(), recorded.end());
+  batchBytes += frameBytes;
+  frameBytes = 0;
+  recorded.clear();
+}
+
+// upload everything staged so far on a dedicated cmd buffer
+void StagingRing::submit() {
+  PROFILE_ZONE("StagingRing::submit");
+  if (pending.empty()) return;
+  SDL_GPUCommandBuffer *cmdBuf = getGPUBackend()->acquireCommandBuffer(device);
+  Uint32 bytes = recordCopies(cmdBuf);
+  SDL_GPUFence *fence = getGPUBackend()->submitCommandBufferAndAcquireFence(cmdBuf);
+  if (fence == NULL) {
+    SDL_Log("Failed to upload to buffers - %s", SDL_GetError());
+    getGPUBackend()->waitForIdle(device);
+  }
+  pushBatch(Batch { bytes, fence });
+}
+
+// hand over the fence of the frame cmd buffer so its space can be recycled
+void StagingRing::endFrame(SDL_GPUFence *fence) {
+  if (frameBytes > 0) {
+    if (fence == NULL) getGPUBackend()->waitForIdle(device);
+    pushBatch(Batch { frameBytes, fence });
+    frameBytes = 0;
+  } else if (fence != NULL) {
+    getGPUBackend()->releaseFence(device, fence);
+  }
+  recorded.clear();
+  // release is deferred by SDL until the copies have executed
+  for (SDL_GPUTransferBuffer *tBuf : oversizedInFlight) {
+    getGPUBackend()->releaseTransferBuffer(device, tBuf);
+  }
+  oversizedInFlight.clear();
+  retire();
+
+  // every stall is in frameStats, the log only sums them up once a second
+  unloggedStalls += stats.stalls;
+  unloggedStallNS += stats.stallTimeNS;
+  Uint64 now = SDL_GetTicksNS();
+  if (unloggedStalls > 0 && now - lastStallLog >= SDL_NS_PER_SECOND) {
+    SDL_Log(
+      "Staging ring stalled %d times (%.2f ms) since the last report",
+      unloggedStalls, (float)unloggedStallNS / 1000000.0f
+    );
+    unloggedStalls = 0;
+    unloggedStallNS = 0;
+    lastStallLog = now;
+  }
+  lastStats = stats;
+  stats = StagingStats {};
+}
+
+void StagingRing::destroy() {
+  if (mapped != NULL) getGPUBackend()->unmapTransferBuffer(device, ringBuf);
+  mapped = NULL;
+  for (SDL_GPUTransferBuffer *tBuf : oversizedMapped) {
+    getGPUBackend()->unmapTransferBuffer(device, tBuf);
+    getGPUBackend()->releaseTransferBuffer(device, tBuf);
+  }
+  for (SDL_GPUTransferBuffer *tBuf : oversizedInFlight) {
+    getGPUBackend()->releaseTransferBuffer(device, tBuf);
+  }
+  oversizedMapped.clear();
+  oversizedInFlight.clear();
+  pending.clear();
+  recorded.clear();
+  for (Uint32 i=inFlightHead; i < inFlight.size(); i++) {
+    Batch &b = inFlight[i];
+    if (b.fence == NULL) continue;
+    getGPUBackend()->waitForFences(device, true, &b.fence, 1);
+    getGPUBackend()->releaseFence(device, b.fence);
+  }
+  inFlight.clear();
+  inFlightHead = 0;
+  if (ringBuf != NULL) getGPUBackend()->releaseTransferBuffer(device, ringBuf);
+  ringBuf = NULL;
+}
+
+static std::unordered_map<SDL_GPUDevice*, StagingRing*> stagingRings;
+
+// one ring per device, created on first use
+StagingRing* App::getStagingRing(SDL_GPUDevice *device) {
+  auto it = stagingRings.find(device);
+  if (it != stagingRings.end()) return it->second;
+  StagingRing *ring = new StagingRing(device, StagingRing::DEFAULT_CAPACITY);
+  stagingRings[device] = ring;
+  return ring;
+}
+
+void App::destroyStagingRing(SDL_GPUDevice *device) {
+  auto it = stagingRings.find(device);
+  if (it == stagingRings.end()) return;
+  it->second->destroy();
+  delete it->second;
+  stagingRings.erase(it);
+}
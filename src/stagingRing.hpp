@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <SDL3/SDL.h>
+
+namespace App {
+  struct StagingStats {
+    Uint32 bytesStaged = 0;
+    Uint32 copies = 0;
+    Uint32 copyPasses = 0;
+    Uint32 stalls = 0;
+    Uint64 stallTimeNS = 0;
+    Uint32 oversized = 0;
+  };
+  // persistent upload ring shared by every pipeline on a device.
+  // uploads are suballocated from a single transfer buffer, recorded into
+  // one copy pass per frame and recycled once that frame's fence signals
+  class StagingRing {
+  public:
+    static const Uint32 DEFAULT_CAPACITY = 8 * 1024 * 1024;
+    static const Uint32 ALIGNMENT = 16;
+    StagingRing(SDL_GPUDevice *gpu, Uint32 capacity);
+    void* stage(SDL_GPUBuffer *dst, Uint32 dstOffset, Uint32 size, bool cycle);
+    void upload(SDL_GPUBuffer *dst, Uint32 dstOffset, void const *data, Uint32 size, bool cycle);
+    void flush(SDL_GPUCommandBuffer *cmdBuf);
+    void submit();
+    // the frame cmd buffer was cancelled after flush, requeue what it carried
+    void cancel();
+    void endFrame(SDL_GPUFence *fence);
+    StagingStats const &frameStats() const { return lastStats; }
+    void destroy();
+  private:
+    struct PendingCopy {
+      SDL_GPUTransferBuffer *src;
+      Uint32 srcOffset;
+      SDL_GPUBuffer *dst;
+      Uint32 dstOffset;
+      Uint32 size;
+      bool cycle;
+    };
+    struct Batch {
+      Uint32 bytes;
+      SDL_GPUFence *fence;
+    };
+    Uint32 recordCopies(SDL_GPUCommandBuffer *cmdBuf);
+    Sint64 reserve(Uint32 aligned, Uint32 &claimed);
+    void retire();
+    void pushBatch(Batch batch);
+    void* stageOversized(SDL_GPUBuffer *dst, Uint32 dstOffset, Uint32 size, bool cycle);
+    SDL_GPUDevice *device = NULL;
+    SDL_GPUTransferBuffer *ringBuf = NULL;
+    Uint8 *mapped = NULL;
+    Uint32 capacity = 0;
+    Uint32 head = 0;
+    Uint32 used = 0;
+    Uint32 batchBytes = 0; // staged, not yet recorded
+    Uint32 frameBytes = 0; // recorded into the frame cmd buffer, waiting on its fence
+    std::vector<PendingCopy> pending;
+    // flushed into the frame cmd buffer, kept until endFrame in case it's cancelled
+    std::vector<PendingCopy> recorded;
+    std::vector<SDL_GPUTransferBuffer*> oversizedMapped;
+    std::vector<SDL_GPUTransferBuffer*> oversizedInFlight;
+    // oldest first from inFlightHead. retired slots are compacted away
+    // instead of freed so the queue stops allocating at its peak depth
+    std::vector<Batch> inFlight;
+    Uint32 inFlightHead = 0;
+    StagingStats stats;
+    StagingStats lastStats;
+    // stalls not logged yet, reported at most once a second
+    Uint32 unloggedStalls = 0;
+    Uint64 unloggedStallNS = 0;
+    Uint64 lastStallLog = 0;
+  };
+  StagingRing* getStagingRing(SDL_GPUDevice *device);
+  void destroyStagingRing(SDL_GPUDevice *device);
+}
@@ -0,0 +1,79 @@
+#include "app.hpp"
+
+using namespace App;
+
+// grid of identical meshes to measure draw submission cost.
+// left click draws instanced, right click draws one object at a time
+StressScene::StressScene(SDL_GPUDevice *gpu, SDL_GPUTextureFormat targetFormat) : Scene() {
+  objPipe = new ObjectPipeline(targetFormat, gpu, PT_Tri, SDL_GPU_CULLMODE_BACK, 800, 600, VL_Compact);
+  objPipe->cam = RenderCamera {
+    .pos = glm::vec3(0.0f, 0.0f, 2200.0f),
+    .perspective = true,
+    .far = 5000.0f,
+    .viewWidth = 800.0f,
+    .viewHeight = 600.0f,
+    .fovY = degToRad(60.0f),
+  };
+  objPipe->instancing = true;
+
+  // repeated shapes come back from uploadObject as instances of the first upload
+  MeshFactory *meshes = getMeshFactory();
+  float spacing = 30.0f;
+  float offset = spacing * (float)(GRID_SIZE - 1) / 2.0f;
+  for (int y=0; y < GRID_SIZE; y++) {
+    for (int x=0; x < GRID_SIZE; x++) {
+      int id = objPipe->uploadObject((x + y) % 2 == 0 ? meshes->cube(12.0f, 12.0f, 12.0f) : meshes->sphere(8.0f, 12, 8));
+      RenderObject &obj = objPipe->getObject(id);
+      obj.pos = glm::vec3(x * spacing - offset, y * spacing - offset, 0.0f);
+      obj.rotAxis = glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f));
+      obj.albedo = hsv((float)(x + y * GRID_SIZE) / (float)(GRID_SIZE * GRID_SIZE), 0.8f, 0.9f);
+    }
+  }
+}
+
+SDL_AppResult StressScene::update(SystemUpdates const &sys) {
+  // resize if necessary
+  if (sys.winSize.x != screenSize.x || sys.winSize.y != screenSize.y) {
+    objPipe->resizeScreen((Uint32)sys.winSize.x, (Uint32)sys.winSize.y);
+    screenSize = sys.winSize;
+  }
+  if (getMouseBtnClicked(sys.mFlags, SDL_BUTTON_LEFT)) objPipe->instancing = true;
+  if (getMouseBtnClicked(sys.mFlags, SDL_BUTTON_RIGHT)) objPipe->instancing = false;
+
+  spin += sys.deltaTime;
+  getJobSystem()->parallelFor(GRID_SIZE * GRID_SIZE, 1024, [this](Uint32 begin, Uint32 end) {
+    for (Uint32 i=begin; i < end; i++) {
+      objPipe->getObject(i).rotAngleRad = spin + (float)i * 0.01f;
+    }
+  });
+  objPipe->prepare();
+
+  return SDL_APP_CONTINUE;
+}
+
+SDL_AppResult StressScene::render(SDL_GPUCommandBuffer *cmdBuf, SDL_GPUTexture* screen) {
+  objPipe->render(cmdBuf, screen, LightMaterial {
+    .lightColor = rgba(200, 200, 200, 255),
+    .lightPos = glm::vec3(0.0f, 0.0f, 1000.0f),
+    .lightMaxDist = 4000.0f,
+    .ambientIntensity = 0.2f,
+    .specularIntensity = 0.5f,
+  });
+  return SDL_APP_CONTINUE;
+}
+
+std::string StressScene::debugInfo() {
+  char str[160];
+  SDL_snprintf(
+    str, sizeof(str), "%s: %d draws, %d objects, %d uniform pushes, %d culled, %d binds (%d skipped)",
+    objPipe->instancing ? "Instanced" : "Per object",
+    objPipe->stats.drawCalls, objPipe->stats.instances, objPipe->stats.uniformPushes, objPipe->stats.culled,
+    objPipe->stats.binds, objPipe->stats.bindsSkipped
+  );
+  return str;
+}
+
+void StressScene::destroy() {
+  objPipe->destroy();
+  delete objPipe;
+}
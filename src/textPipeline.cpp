@@ -1,4 +1,8 @@
 #include "textPipeline.hpp"
+#include "gpuBackend.hpp"
+#include "frameArena.hpp"
+#include "profiler.hpp"
+#include "stagingRing.hpp"
 
 using namespace App;
 
@@ -17,25 +21,71 @@ void StringObject::updateText(std::string text) {
 	if (!success) {
 		SDL_Log("Failed to update text string: %s", SDL_GetError());
 	}
+	this->text = text;
+	dirty = true;
+}
+
+// position, uv and color
+static SDL_GPUVertexInputState createTextInputState() {
+	SDL_GPUVertexInputState state = {};
+	state.vertex_buffer_descriptions = getFrameArena()->make(SDL_GPUVertexBufferDescription {
+		.slot = 0,
+		.pitch = sizeof(TextVertex),
+		.input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+		.instance_step_rate = 0,
+	});
+	state.num_vertex_buffers = 1;
+	SDL_GPUVertexAttribute *attrs = getFrameArena()->allocArray<SDL_GPUVertexAttribute>(3);
+	attrs[0] = SDL_GPUVertexAttribute {
+		.location = 0,
+		.buffer_slot = 0,
+		.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+		.offset = offsetof(TextVertex, pos),
+	};
+	attrs[1] = SDL_GPUVertexAttribute {
+		.location = 1,
+		.buffer_slot = 0,
+		.format = SDL_GPU_VERTEXELEMENTFORMAT_USHORT2_NORM,
+		.offset = offsetof(TextVertex, uv),
+	};
+	attrs[2] = SDL_GPUVertexAttribute {
+		.location = 2,
+		.buffer_slot = 0,
+		.format = SDL_GPU_VERTEXELEMENTFORMAT_UBYTE4_NORM,
+		.offset = offsetof(TextVertex, color),
+	};
+	state.vertex_attributes = attrs;
+	state.num_vertex_attributes = 3;
+	return state;
+}
+
+static SDL_GPUBuffer* createTextBuffer(SDL_GPUDevice *device, SDL_GPUBufferUsageFlags usage, Uint32 size) {
+	return getGPUBackend()->createBuffer(device, getFrameArena()->make(SDL_GPUBufferCreateInfo {
+		.usage = usage,
+		.size = size
+	}));
 }
 
-TextPipeline::TextPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu) {
+TextPipeline::TextPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu, TextMode mode) {
   device = gpu;
-  // create shaders
+  this->mode = mode;
+  // create shaders, the vertex stage is shared by both modes
   SDL_GPUShader *vertShader = App::loadShader(device, "ttfRects.vert", 0, 1, 0, 0);
-  SDL_GPUShader *fragShader = App::loadShader(device, "ttfRects.frag", 1, 1, 0, 0);
+  SDL_GPUShader *fragShader = mode == TM_SDF ?
+    App::loadShader(device, "ttfSdf.frag", 1, 1, 0, 0) :
+    App::loadShader(device, "ttfRects.frag", 1, 0, 0, 0);
   // create pipeline
-	pipeline = SDL_CreateGPUGraphicsPipeline(device, new SDL_GPUGraphicsPipelineCreateInfo {
+	pipeline = getGPUBackend()->createGraphicsPipeline(device, getFrameArena()->make(SDL_GPUGraphicsPipelineCreateInfo {
 		.vertex_shader = vertShader,
 		.fragment_shader = fragShader,
-    .vertex_input_state = createVertexInputState(),
+    .vertex_input_state = createTextInputState(),
 		.primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
 		.rasterizer_state = SDL_GPURasterizerState {
 			.fill_mode = SDL_GPU_FILLMODE_FILL,
 			.cull_mode = SDL_GPU_CULLMODE_NONE,
 		},
 		.target_info = SDL_GPUGraphicsPipelineTargetInfo {
-			.color_target_descriptions = new SDL_GPUColorTargetDescription {
+			.color_target_descriptions = getFrameArena()->make(SDL_GPUColorTargetDescription {
 				.format = targetFormat,
 				.blend_state = SDL_GPUColorTargetBlendState {
 					.src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
@@ -46,122 +96,265 @@ TextPipeline::TextPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu
 					.alpha_blend_op = SDL_GPU_BLENDOP_ADD,
 					.enable_blend = true,
 				},
-			},
+			}),
 			.num_color_targets = 1,
 		},
-	});
+	}));
   // create sampler
-  sampler = SDL_CreateGPUSampler(device, new SDL_GPUSamplerCreateInfo {
+  sampler = getGPUBackend()->createSampler(device, getFrameArena()->make(SDL_GPUSamplerCreateInfo {
     .min_filter = SDL_GPU_FILTER_LINEAR,
     .mag_filter = SDL_GPU_FILTER_LINEAR,
     .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_LINEAR,
     .address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
     .address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
     .address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE
-  });
-  // create vertex buffer
-  vertBuf = SDL_CreateGPUBuffer(device, new SDL_GPUBufferCreateInfo {
-		.usage = SDL_GPU_BUFFERUSAGE_VERTEX,
-		.size = sizeof(RenderVertex) * MAX_VERT_COUNT
-	});
-  // create index buffer
-  indexBuf = SDL_CreateGPUBuffer(device, new SDL_GPUBufferCreateInfo {
-		.usage = SDL_GPU_BUFFERUSAGE_INDEX,
-		.size = sizeof(Uint16) * MAX_INDEX_COUNT
-	});
+  }));
+  // create vertex and index buffers, both grow when the text no longer fits
+  vertBuf = createTextBuffer(device, SDL_GPU_BUFFERUSAGE_VERTEX, sizeof(TextVertex) * INITIAL_VERT_COUNT);
+  vertCapacity = INITIAL_VERT_COUNT;
+  indexBuf = createTextBuffer(device, SDL_GPU_BUFFERUSAGE_INDEX, sizeof(Uint32) * INITIAL_INDEX_COUNT);
+  indexCapacity = INITIAL_INDEX_COUNT;
 
   // release shaders
-	SDL_ReleaseGPUShader(device, vertShader);
-  SDL_ReleaseGPUShader(device, fragShader);
+	getGPUBackend()->releaseShader(device, vertShader);
+  getGPUBackend()->releaseShader(device, fragShader);
 }
 
-void addGlyphToVertices(
-	TTF_GPUAtlasDrawSequence *sequence,
-	std::vector<RenderVertex> *vertices,
-	std::vector<Uint16> *indices,
-	SDL_FColor color,
-	glm::vec3 origin
-) {
-  for (int i=0; i < sequence->num_vertices; i++) {
-		RenderVertex vert;
-		const SDL_FPoint pos = sequence->xy[i];
-		const SDL_FPoint uv = sequence->uv[i];
-		vert.pos.x = origin.x + pos.x; vert.pos.y = pos.y - origin.y; vert.pos.z = origin.z;
-		vert.uv.x = uv.x; vert.uv.y = uv.y;
-		vertices->push_back(vert);
+// expand SDL_ttf draw data into geometry the string keeps until it changes
+static void buildGlyphs(StringObject *str) {
+	str->vertices.clear();
+	str->indices.clear();
+	str->spans.clear();
+	glm::vec3 origin = str->origin;
+	SDL_FColor color = str->color;
+	Uint8 packed[4] = { packUnorm8(color.r), packUnorm8(color.g), packUnorm8(color.b), packUnorm8(color.a) };
+	float c = SDL_cosf(str->rotation) * str->scale;
+	float s = SDL_sinf(str->rotation) * str->scale;
+	for (TTF_GPUAtlasDrawSequence *seq = TTF_GetGPUTextDrawData(str->ttfText); seq != NULL; seq = seq->next) {
+		str->spans.push_back(GlyphSpan {
+			seq->atlas_texture, (Uint32)str->vertices.size(), (Uint32)str->indices.size(), (Uint32)seq->num_indices
+		});
+		for (int i=0; i < seq->num_vertices; i++) {
+			str->vertices.push_back(TextVertex {
+				.pos = glm::vec2(
+					origin.x + c * seq->xy[i].x - s * seq->xy[i].y,
+					s * seq->xy[i].x + c * seq->xy[i].y - origin.y
+				),
+				.uv = { packUnorm16(seq->uv[i].x), packUnorm16(seq->uv[i].y) },
+				.color = { packed[0], packed[1], packed[2], packed[3] },
+			});
+		}
+		str->indices.insert(str->indices.end(), seq->indices, seq->indices + seq->num_indices);
+	}
+	str->builtOrigin = origin;
+	str->builtColor = color;
+	str->builtScale = str->scale;
+	str->builtRotation = str->rotation;
+	str->dirty = false;
+	str->uploadPending = true;
+}
+
+static bool needsRebuild(StringObject const *str) {
+	SDL_FColor const &a = str->color;
+	SDL_FColor const &b = str->builtColor;
+	return str->dirty || str->origin != str->builtOrigin || str->scale != str->builtScale ||
+		str->rotation != str->builtRotation || a.r != b.r || a.g != b.g || a.b != b.b || a.a != b.a;
+}
+
+static bool slotValid(StringObject const *str, TextPipeline const *owner, Uint32 generation) {
+	return str->slotOwner == owner && str->slotGeneration == generation && str->vertices.size() <= str->slotVertexCap;
+}
+
+// vertices reserved for a string, with headroom so text that grows by a few
+// glyphs stays in place
+static Uint32 slotCapacity(StringObject const *str) {
+	Uint32 granule = TextPipeline::SLOT_GRANULE * 4;
+	return (str->vertices.size() + granule - 1) / granule * granule;
+}
+
+// claim a range at the end of the vertex buffer
+bool TextPipeline::place(StringObject *str) {
+	Uint32 cap = slotCapacity(str);
+	if (vertHead + cap > vertCapacity) return false;
+	str->slotOwner = this;
+	str->slotGeneration = generation;
+	str->slotVertex = vertHead;
+	str->slotVertexCap = cap;
+	str->uploadPending = true;
+	vertHead += cap;
+	return true;
+}
+
+// drop every slot and place the visible strings again from the start,
+// growing the vertex buffer first if they can't all fit
+void TextPipeline::repack(std::vector<StringObject*> const &strings) {
+	Uint32 needed = 0;
+	for (StringObject *str : strings) {
+		if (str->visible) needed += slotCapacity(str);
 	}
-	for (int i=0; i < sequence->num_indices; i++) {
-		indices->push_back(sequence->indices[i]);
+	if (needed > vertCapacity) {
+		Uint32 cap = SDL_max(vertCapacity * 2, needed);
+		SDL_GPUBuffer *buf = createTextBuffer(device, SDL_GPU_BUFFERUSAGE_VERTEX, sizeof(TextVertex) * cap);
+		if (buf == NULL) {
+			SDL_Log("ERR: Failed to grow text vertex buffer to %d vertices: %s", cap, SDL_GetError());
+		} else {
+			getGPUBackend()->releaseBuffer(device, vertBuf);
+			vertBuf = buf;
+			vertCapacity = cap;
+			stats.grown++;
+		}
+	}
+	generation++;
+	vertHead = 0;
+	for (StringObject *str : strings) {
+		if (!str->visible || place(str)) continue;
+		if (str->uploadPending) SDL_Log("ERR: Text buffer full, skipping string of %d glyphs", (int)str->indices.size() / 6);
+		str->uploadPending = false;
+	}
+}
+
+// write the indices of every drawn string into one range per atlas. indices are
+// absolute so a whole atlas draws in one call whatever slots its strings are in
+void TextPipeline::buildBatches(std::vector<StringObject*> const &strings) {
+	batches.clear();
+	drawn.clear();
+	Uint32 total = 0;
+	for (StringObject *str : strings) {
+		if (!str->visible || !slotValid(str, this, generation)) continue;
+		drawn.push_back(str);
+		total += str->indices.size();
+	}
+	if (total == 0) return;
+	if (total > indexCapacity) {
+		Uint32 cap = SDL_max(indexCapacity * 2, total);
+		SDL_GPUBuffer *buf = createTextBuffer(device, SDL_GPU_BUFFERUSAGE_INDEX, sizeof(Uint32) * cap);
+		if (buf == NULL) {
+			SDL_Log("ERR: Failed to grow text index buffer to %d indices: %s", cap, SDL_GetError());
+			return;
+		}
+		getGPUBackend()->releaseBuffer(device, indexBuf);
+		indexBuf = buf;
+		indexCapacity = cap;
+		stats.grown++;
+	}
+	Uint32 *out = (Uint32*)getStagingRing(device)->stage(indexBuf, 0, sizeof(Uint32) * total, true);
+	if (out == NULL) return;
+	stats.uploadedBytes += sizeof(Uint32) * total;
+
+	// atlases in the order they're first used, each gathering its glyphs from every string
+	Uint32 written = 0;
+	for (Uint32 i=0; i < drawn.size(); i++) {
+		for (GlyphSpan const &span : drawn[i]->spans) {
+			bool batched = false;
+			for (AtlasBatch const &batch : batches) batched = batched || batch.atlas == span.atlas;
+			if (batched) continue;
+			AtlasBatch batch { span.atlas, written, 0 };
+			for (Uint32 j=i; j < drawn.size(); j++) {
+				StringObject *str = drawn[j];
+				for (GlyphSpan const &s : str->spans) {
+					if (s.atlas != span.atlas) continue;
+					Uint32 base = str->slotVertex + s.firstVertex;
+					Uint16 const *src = str->indices.data() + s.firstIndex;
+					for (Uint32 k=0; k < s.indexCount; k++) out[written++] = base + src[k];
+				}
+			}
+			batch.indexCount = written - batch.firstIndex;
+			batches.push_back(batch);
+		}
+	}
+}
+
+// rebuild strings whose text, transform or color changed, stage only their vertex
+// ranges and regroup the indices if anything moved. must run before the frame flush
+void TextPipeline::prepare(std::vector<StringObject*> const &strings) {
+	PROFILE_ZONE("TextPipeline::prepare");
+	stats = TextStats {};
+	bool layoutChanged = false;
+	for (StringObject *str : strings) {
+		if (!str->visible) continue;
+		stats.strings++;
+		if (!needsRebuild(str)) continue;
+		buildGlyphs(str);
+		stats.rebuilt++;
+		layoutChanged = true;
+	}
+	for (StringObject *str : strings) {
+		if (!str->visible || slotValid(str, this, generation)) continue;
+		layoutChanged = true;
+		if (!place(str)) {
+			repack(strings);
+			break;
+		}
+	}
+
+	StagingRing *staging = getStagingRing(device);
+	for (StringObject *str : strings) {
+		if (!str->visible || !str->uploadPending) continue;
+		Uint32 size = sizeof(TextVertex) * str->vertices.size();
+		staging->upload(vertBuf, sizeof(TextVertex) * str->slotVertex, str->vertices.data(), size, false);
+		str->uploadPending = false;
+		stats.uploadedBytes += size;
 	}
+
+	// showing or hiding a string changes the batches too
+	Uint32 n = 0;
+	for (StringObject *str : strings) {
+		if (layoutChanged) break;
+		if (!str->visible) continue;
+		layoutChanged = n >= drawn.size() || drawn[n] != str;
+		n++;
+	}
+	if (layoutChanged || n != drawn.size()) buildBatches(strings);
 }
 
 void TextPipeline::render(
   SDL_GPUCommandBuffer *cmdBuf, SDL_GPURenderPass *pass,
 	SDL_GPUTexture* target, glm::vec2 targetSize,
-	std::vector<StringObject> &strings
+	std::vector<StringObject*> const &strings
 ) {
-	if (strings.empty()) { return; }
-	std::vector<RenderVertex> vertices;
-	std::vector<Uint16> indices;
-	SDL_GPUTexture *atlas = NULL;
-	// process each StringObject individually
-	for (int i=0; i<strings.size(); i++) {
-		if (!strings[i].visible) continue;
-		// move through sequence of glyphs
-		strings[i].sequence = TTF_GetGPUTextDrawData(strings[i].ttfText);
-		if (atlas == NULL) atlas = strings[i].sequence->atlas_texture;
-		for (TTF_GPUAtlasDrawSequence *seq = strings[i].sequence; seq != NULL; seq = seq->next) {
-			addGlyphToVertices(seq, &vertices, &indices, strings[i].color, strings[i].origin);
-		}
-	}
-	if (vertices.size() < 1) { return; }
-	copyVertexDataIntoBuffer(device, vertBuf, indexBuf, &vertices, &indices);
+	PROFILE_ZONE("TextPipeline::render");
+	if (batches.empty()) { return; }
 
 	bool internalPass = pass == NULL;
 	if (internalPass) {
-		pass = SDL_BeginGPURenderPass(cmdBuf, new SDL_GPUColorTargetInfo {
+		pass = getGPUBackend()->beginRenderPass(cmdBuf, getFrameArena()->make(SDL_GPUColorTargetInfo {
 			.texture = target,
 			.clear_color = SDL_FColor{ 0.02f, 0.02f, 0.08f, 1.0f },
 			.load_op = SDL_GPU_LOADOP_LOAD,
 			.store_op = SDL_GPU_STOREOP_STORE,
-		}, 1, NULL);
+		}), 1, NULL);
 	}
 
 	// draw pipeline
-  SDL_BindGPUGraphicsPipeline(pass, pipeline);
-	SDL_BindGPUFragmentSamplers(pass, 0, new SDL_GPUTextureSamplerBinding {
-    .texture = atlas,
-    .sampler = sampler
-  }, 1);
-	SDL_BindGPUVertexBuffers(pass, 0, new SDL_GPUBufferBinding {
+  getGPUBackend()->bindGraphicsPipeline(pass, pipeline);
+	getGPUBackend()->bindVertexBuffers(pass, 0, getFrameArena()->make(SDL_GPUBufferBinding {
 		.buffer = vertBuf,
 		.offset = 0,
-	}, 1);
-	SDL_BindGPUIndexBuffer(pass, new SDL_GPUBufferBinding {
+	}), 1);
+	getGPUBackend()->bindIndexBuffer(pass, getFrameArena()->make(SDL_GPUBufferBinding {
 		.buffer = indexBuf,
 		.offset = 0,
-	}, SDL_GPU_INDEXELEMENTSIZE_16BIT);
-	SDL_PushGPUVertexUniformData(cmdBuf, 0, &targetSize, sizeof(glm::vec2));
-	int index_offset = 0, vertex_offset = 0;
-	// dynamically offset buffers for each glyph
-	for (int i=0; i<strings.size(); i++) {
-		if (!strings[i].visible) continue;
-		SDL_PushGPUFragmentUniformData(cmdBuf, 0, &strings[i].color, sizeof(SDL_FColor));
-		for (TTF_GPUAtlasDrawSequence *seq = strings[i].sequence; seq != NULL; seq = seq->next) {
-			SDL_DrawGPUIndexedPrimitives(pass, seq->num_indices, 1, index_offset, vertex_offset, 0);
-			index_offset += seq->num_indices;
-			vertex_offset += seq->num_vertices;
-		}
+	}), SDL_GPU_INDEXELEMENTSIZE_32BIT);
+	getGPUBackend()->pushVertexUniformData(cmdBuf, 0, &targetSize, sizeof(glm::vec2));
+	if (mode == TM_SDF) getGPUBackend()->pushFragmentUniformData(cmdBuf, 0, &sdfStyle, sizeof(SDFTextStyle));
+	// one draw per atlas, color comes from the vertices
+	for (AtlasBatch const &batch : batches) {
+		getGPUBackend()->bindFragmentSamplers(pass, 0, getFrameArena()->make(SDL_GPUTextureSamplerBinding {
+			.texture = batch.atlas,
+			.sampler = sampler
+		}), 1);
+		getGPUBackend()->drawIndexedPrimitives(pass, batch.indexCount, 1, batch.firstIndex, 0, 0);
+		stats.drawCalls++;
 	}
 
 	if (internalPass) {
-		SDL_EndGPURenderPass(pass);
+		getGPUBackend()->endRenderPass(pass);
 	}
 }
 
 void TextPipeline::destroy() {
-  SDL_ReleaseGPUBuffer(device, vertBuf);
-  SDL_ReleaseGPUBuffer(device, indexBuf);
-  SDL_ReleaseGPUSampler(device, sampler);
-  SDL_ReleaseGPUGraphicsPipeline(device, pipeline);
+  getGPUBackend()->releaseBuffer(device, vertBuf);
+  getGPUBackend()->releaseBuffer(device, indexBuf);
+  getGPUBackend()->releaseSampler(device, sampler);
+  getGPUBackend()->releaseGraphicsPipeline(device, pipeline);
 }
\ No newline at end of file
@@ -10,36 +10,109 @@
 
 // generic render pipeline
 namespace App {
+  class TextPipeline;
+  // TM_SDF expects strings made with a font that has TTF_SetFontSDF enabled,
+  // its atlas holds distances so glyphs stay sharp at any scale
+  enum TextMode { TM_Bitmap, TM_SDF };
+  // fragment uniform for TM_SDF. widths are in distance field units, the edge sits at 0.5
+  struct SDFTextStyle {
+    SDL_FColor outlineColor = BLACK;
+    float outlineWidth = 0.0f;
+    float softness = 1.0f;
+    float padding[2] = {0.0f, 0.0f};
+  };
+  // text vertices carry their color so strings sharing an atlas draw together.
+  // 16 bytes: screen position, unorm16 atlas uv and unorm8 color
+  struct TextVertex {
+    glm::vec2 pos;
+    Uint16 uv[2];
+    Uint8 color[4];
+  };
+  // glyphs of a string from one atlas, relative to the string's own geometry
+  struct GlyphSpan {
+    SDL_GPUTexture *atlas;
+    Uint32 firstVertex;
+    Uint32 firstIndex;
+    Uint32 indexCount;
+  };
   class StringObject {
   public:
     StringObject(TTF_TextEngine *textEngine, TTF_Font* font, std::string text);
     std::string text;
     TTF_Text *ttfText = NULL;
-    TTF_GPUAtlasDrawSequence *sequence = NULL;
     SDL_FColor color = WHITE;
+    // text is flat and drawn without depth, z is ignored
     glm::vec3 origin {0.0f, 0.0f, 0.0f};
+    // applied around origin, mainly for TM_SDF where scaling doesn't blur
+    float scale = 1.0f;
+    float rotation = 0.0f;
     bool visible = true;
     void updateText(std::string text);
+    // glyph geometry already transformed and colored, rebuilt when the
+    // text, transform or color changes
+    std::vector<TextVertex> vertices;
+    std::vector<Uint16> indices;
+    std::vector<GlyphSpan> spans;
+    bool dirty = true;
+    bool uploadPending = false;
+    glm::vec3 builtOrigin {0.0f, 0.0f, 0.0f};
+    SDL_FColor builtColor = WHITE;
+    float builtScale = 1.0f;
+    float builtRotation = 0.0f;
+    // vertex range held in the pipeline buffer, valid while slotGeneration matches
+    TextPipeline *slotOwner = NULL;
+    Uint32 slotGeneration = 0;
+    Uint32 slotVertex = 0;
+    Uint32 slotVertexCap = 0;
+  };
+  struct TextStats {
+    Uint32 strings = 0;
+    Uint32 rebuilt = 0;
+    Uint32 uploadedBytes = 0;
+    Uint32 drawCalls = 0;
+    Uint32 grown = 0;
   };
   class TextPipeline {
   public:
-    static const int MAX_VERT_COUNT = 2000;
-    static const int MAX_INDEX_COUNT = 4000;
-    TextPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu);
+    static const Uint32 INITIAL_VERT_COUNT = 8000;
+    static const Uint32 INITIAL_INDEX_COUNT = 12000;
+    // slots are rounded up to this many glyph quads
+    static const Uint32 SLOT_GRANULE = 16;
+    TextPipeline(SDL_GPUTextureFormat targetFormat, SDL_GPUDevice *gpu, TextMode mode = TM_Bitmap);
+    void prepare(std::vector<StringObject*> const &strings);
     void render(
       SDL_GPUCommandBuffer *cmdBuf, SDL_GPURenderPass *pass,
       SDL_GPUTexture* target, glm::vec2 targetSize,
-      std::vector<StringObject> &strings
+      std::vector<StringObject*> const &strings
     );
     void destroy();
+    TextStats stats;
+    TextMode mode;
+    SDFTextStyle sdfStyle;
   private:
+    // one draw of every visible glyph sampling the same atlas
+    struct AtlasBatch {
+      SDL_GPUTexture *atlas;
+      Uint32 firstIndex;
+      Uint32 indexCount;
+    };
+    bool place(StringObject *str);
+    void repack(std::vector<StringObject*> const &strings);
+    void buildBatches(std::vector<StringObject*> const &strings);
     SDL_GPUDevice *device = NULL;
     SDL_GPUGraphicsPipeline *pipeline = NULL;
     SDL_GPUSampler *sampler = NULL;
-    // glyphs resources
+    // persistent vertex buffer, strings own ranges that are only rewritten when they change.
+    // the index buffer holds absolute indices grouped by atlas and is rewritten when
+    // the set of drawn strings or their layout changes
     SDL_GPUBuffer *vertBuf = NULL;
     SDL_GPUBuffer *indexBuf = NULL;
-    int vertCount = 0;
-    int indexCount = 0;
+    Uint32 vertCapacity = 0;
+    Uint32 indexCapacity = 0;
+    Uint32 vertHead = 0;
+    // bumped when the vertex buffer is repacked, invalidating every slot
+    Uint32 generation = 1;
+    std::vector<AtlasBatch> batches;
+    std::vector<StringObject*> drawn;
   };
 }
\ No newline at end of file
@@ -1,10 +1,13 @@
 #include "util.hpp"
+#include "shaderRegistry.hpp"
+#include "frameArena.hpp"
 
 using namespace App;
 
 #pragma region Pipeline helpers
 
-// utility function from https://github.com/TheSpydog/SDL_gpu_examples/blob/main/Examples/Common.c
+// shader bytecode is resident in the registry, only the first use of a
+// shader missing from the bundle reads from disk
 SDL_GPUShader* App::loadShader(
   SDL_GPUDevice *device,
   const char* filename,
@@ -13,186 +16,155 @@ SDL_GPUShader* App::loadShader(
 	Uint32 storageBufferCount,
 	Uint32 storageTextureCount
 ) {
-  // Auto-detect the shader stage from the file name for convenience
-	SDL_GPUShaderStage stage;
-	if (SDL_strstr(filename, ".vert")) {
-		stage = SDL_GPU_SHADERSTAGE_VERTEX;
-	} else if (SDL_strstr(filename, ".frag")) {
-		stage = SDL_GPU_SHADERSTAGE_FRAGMENT;
-	} else {
-		SDL_Log("Invalid shader stage!");
-		return NULL;
-	}
-
-  char fullPath[256];
-	SDL_GPUShaderFormat backendFormats = SDL_GetGPUShaderFormats(device);
-	SDL_GPUShaderFormat format = SDL_GPU_SHADERFORMAT_INVALID;
-	const char *entrypoint;
-
-  if (backendFormats & SDL_GPU_SHADERFORMAT_SPIRV) {
-		SDL_snprintf(fullPath, sizeof(fullPath), "assets/SPIRV/%s.spv", filename);
-		format = SDL_GPU_SHADERFORMAT_SPIRV;
-		entrypoint = "main";
-	} else if (backendFormats & SDL_GPU_SHADERFORMAT_MSL) {
-		SDL_snprintf(fullPath, sizeof(fullPath), "assets/MSL/%s.msl", filename);
-		format = SDL_GPU_SHADERFORMAT_MSL;
-		entrypoint = "main0";
-	} else if (backendFormats & SDL_GPU_SHADERFORMAT_DXIL) {
-		SDL_snprintf(fullPath, sizeof(fullPath), "assets/DXIL/%s.dxil", filename);
-		format = SDL_GPU_SHADERFORMAT_DXIL;
-		entrypoint = "main";
-	} else {
-		SDL_Log("%s", "Unrecognized backend shader format!");
-		return NULL;
-	}
-
-  size_t codeSize;
-	void* code = SDL_LoadFile(fullPath, &codeSize);
-	if (code == NULL) {
-		SDL_Log("Failed to load shader from disk! %s", fullPath);
-		return NULL;
-	}
-
-	SDL_GPUShaderCreateInfo shaderInfo = {
-    .code_size = codeSize,
-		.code = static_cast<Uint8*>(code),
-		.entrypoint = entrypoint,
-		.format = format,
-		.stage = stage,
-		.num_samplers = samplerCount,
-    .num_storage_textures = storageTextureCount,
-		.num_storage_buffers = storageBufferCount,
-    .num_uniform_buffers = uniformBufferCount
-	};
-  SDL_GPUShader* shader = SDL_CreateGPUShader(device, &shaderInfo);
-	if (shader == NULL) {
-		SDL_Log("Failed to create shader!");
-		SDL_free(code);
-		return NULL;
-	}
-
-	SDL_free(code);
-  return shader;
+	return getShaderRegistry()->createShader(
+		device, filename, samplerCount, uniformBufferCount, storageBufferCount, storageTextureCount
+	);
 }
 
-// create vertex input state corresponding to RenderVertex shape
-SDL_GPUVertexInputState App::createVertexInputState() {
+// create vertex input state corresponding to the layout's vertex shape.
+// descriptions live in the frame arena, create the pipeline before the frame ends
+SDL_GPUVertexInputState App::createVertexInputState(VertexLayout layout) {
 	SDL_GPUVertexInputState state;
 
-	state.vertex_buffer_descriptions = new SDL_GPUVertexBufferDescription {
+	state.vertex_buffer_descriptions = getFrameArena()->make(SDL_GPUVertexBufferDescription {
 		.slot = 0,
-		.pitch = sizeof(RenderVertex),
+		.pitch = vertexStride(layout),
 		.input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
 		.instance_step_rate = 0,
-	};
+	});
 	state.num_vertex_buffers = 1;
-	
-	SDL_GPUVertexAttribute vAttr0 = {
-		.location = 0,
-		.buffer_slot = 0,
-		.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-		.offset = 0,
-	};
-	SDL_GPUVertexAttribute vAttr1 = {
-		.location = 1,
-		.buffer_slot = 0,
-		.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-		.offset = sizeof(float) * 3,
-	};
-	SDL_GPUVertexAttribute vAttr2 = {
-		.location = 2,
-		.buffer_slot = 0,
-		.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-		.offset = sizeof(float) * 5,
-	};
-	SDL_GPUVertexAttribute vAttr3 = {
-		.location = 3,
-		.buffer_slot = 0,
-		.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-		.offset = sizeof(float) * 8,
-	};
-	state.vertex_attributes = new SDL_GPUVertexAttribute[4] {
-		vAttr0, vAttr1, vAttr2, vAttr3
-	};
-	state.num_vertex_attributes = 4;
+
+	SDL_GPUVertexAttribute *attrs = getFrameArena()->allocArray<SDL_GPUVertexAttribute>(3);
+	if (layout == VL_Compact) {
+		attrs[0] = SDL_GPUVertexAttribute {
+			.location = 0,
+			.buffer_slot = 0,
+			.format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
+			.offset = offsetof(CompactVertex, pos),
+		};
+		attrs[1] = SDL_GPUVertexAttribute {
+			.location = 1,
+			.buffer_slot = 0,
+			.format = SDL_GPU_VERTEXELEMENTFORMAT_USHORT2_NORM,
+			.offset = offsetof(CompactVertex, uv),
+		};
+		attrs[2] = SDL_GPUVertexAttribute {
+			.location = 2,
+			.buffer_slot = 0,
+			.format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT2_NORM,
+			.offset = offsetof(CompactVertex, normal),
+		};
+	} else {
+		attrs[0] = SDL_GPUVertexAttribute {
+			.location = 0,
+			.buffer_slot = 0,
+			.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+			.offset = offsetof(RenderVertex, pos),
+		};
+		attrs[1] = SDL_GPUVertexAttribute {
+			.location = 1,
+			.buffer_slot = 0,
+			.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+			.offset = offsetof(RenderVertex, uv),
+		};
+		attrs[2] = SDL_GPUVertexAttribute {
+			.location = 2,
+			.buffer_slot = 0,
+			.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+			.offset = offsetof(RenderVertex, normal),
+		};
+	}
+	state.vertex_attributes = attrs;
+	state.num_vertex_attributes = 3;
 
 	return state;
 }
 
-// generic handler for copying vertex data into buffers
-void App::copyVertexDataIntoBuffer(
-	SDL_GPUDevice *device, SDL_GPUBuffer *vertBuf, SDL_GPUBuffer *indexBuf,
-	std::vector<RenderVertex> *verts, std::vector<Uint16> *indices
-) {
-	Uint32 vSize = sizeof(RenderVertex) * verts->size();
-	Uint32 iSize = sizeof(Uint16) * indices->size();
-
-	// pump vertex data into transfer buffer
-	SDL_GPUTransferBuffer *vertTransferBuf = SDL_CreateGPUTransferBuffer(
-		device,
-		new SDL_GPUTransferBufferCreateInfo {
-			.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-			.size = vSize,
-		}
+Uint32 App::vertexStride(VertexLayout layout) {
+	return layout == VL_Compact ? sizeof(CompactVertex) : sizeof(RenderVertex);
+}
+
+Sint16 App::packSnorm16(float v) {
+	return (Sint16)SDL_roundf(SDL_clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+Uint16 App::packUnorm16(float v) {
+	return (Uint16)SDL_roundf(SDL_clamp(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+Uint8 App::packUnorm8(float v) {
+	return (Uint8)SDL_roundf(SDL_clamp(v, 0.0f, 1.0f) * 255.0f);
+}
+
+// fold the unit sphere onto the [-1, 1] square, decoded in the compact vertex shaders
+static glm::vec2 octEncode(glm::vec3 n) {
+	float l1 = SDL_fabsf(n.x) + SDL_fabsf(n.y) + SDL_fabsf(n.z);
+	if (l1 <= 0.0f) return glm::vec2(0.0f);
+	n /= l1;
+	if (n.z >= 0.0f) return glm::vec2(n.x, n.y);
+	return glm::vec2(
+		(1.0f - SDL_fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - SDL_fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
 	);
-	RenderVertex* vertData = static_cast<RenderVertex*>(SDL_MapGPUTransferBuffer(device, vertTransferBuf, false));
-	for (int i=0; i < verts->size(); i++) {
-		vertData[i] = verts->at(i);
+}
+
+// write count vertices to out in the given layout. compact positions are
+// scaled into a cube around the mesh bounds, the returned quantization undoes it
+VertexQuantization App::packVertices(VertexLayout layout, RenderVertex const *verts, Uint32 count, void *out) {
+	VertexQuantization quant;
+	if (layout == VL_Float) {
+		SDL_memcpy(out, verts, sizeof(RenderVertex) * count);
+		return quant;
 	}
-	SDL_UnmapGPUTransferBuffer(device, vertTransferBuf);
-
-	// pump index data into transfer buffer
-	SDL_GPUTransferBuffer *idxTransferBuf = SDL_CreateGPUTransferBuffer(
-		device,
-		new SDL_GPUTransferBufferCreateInfo {
-			.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-			.size = iSize,
-		}
-	);
-	Uint16* indexData = static_cast<Uint16*>(SDL_MapGPUTransferBuffer(device, idxTransferBuf, false));
-	for (int i=0; i < indices->size(); i++) {
-		indexData[i] = indices->at(i);
+	if (count == 0) return quant;
+	glm::vec3 lo = verts[0].pos;
+	glm::vec3 hi = verts[0].pos;
+	for (Uint32 i=1; i < count; i++) {
+		glm::vec3 p = verts[i].pos;
+		lo = glm::vec3(SDL_min(lo.x, p.x), SDL_min(lo.y, p.y), SDL_min(lo.z, p.z));
+		hi = glm::vec3(SDL_max(hi.x, p.x), SDL_max(hi.y, p.y), SDL_max(hi.z, p.z));
 	}
-	SDL_UnmapGPUTransferBuffer(device, idxTransferBuf);
-
-	// create cmd buffer + copy pass
-	SDL_GPUCommandBuffer *cmdBuf = SDL_AcquireGPUCommandBuffer(device);
-	SDL_GPUCopyPass *copyPass = SDL_BeginGPUCopyPass(cmdBuf);
-
-	SDL_UploadToGPUBuffer(
-		copyPass,
-		new SDL_GPUTransferBufferLocation {
-			.transfer_buffer = vertTransferBuf,
-			.offset = 0,
-		},
-		new SDL_GPUBufferRegion {
-			.buffer = vertBuf,
-			.offset = 0,
-			.size = vSize,
-		},
-		false
-	);
-
-	SDL_UploadToGPUBuffer(
-		copyPass,
-		new SDL_GPUTransferBufferLocation {
-			.transfer_buffer = idxTransferBuf,
-			.offset = 0,
-		},
-		new SDL_GPUBufferRegion {
-			.buffer = indexBuf,
-			.offset = 0,
-			.size = iSize,
-		},
-		false
-	);
+	// one scale for every axis keeps the packed normals valid under the model matrix
+	glm::vec3 half = (hi - lo) * 0.5f;
+	quant.offset = (lo + hi) * 0.5f;
+	quant.scale = SDL_max(SDL_max(half.x, half.y), half.z);
+	if (quant.scale <= 0.0f) quant.scale = 1.0f;
+	float inv = 1.0f / quant.scale;
+
+	CompactVertex *dst = static_cast<CompactVertex*>(out);
+	for (Uint32 i=0; i < count; i++) {
+		RenderVertex const &v = verts[i];
+		glm::vec3 p = (v.pos - quant.offset) * inv;
+		glm::vec2 n = octEncode(v.normal);
+		dst[i] = CompactVertex {
+			.pos = { packSnorm16(p.x), packSnorm16(p.y), packSnorm16(p.z), 0 },
+			.uv = { packUnorm16(v.uv.x), packUnorm16(v.uv.y) },
+			.normal = { packSnorm16(n.x), packSnorm16(n.y) },
+		};
+	}
+	return quant;
+}
 
-	// clean up passes
-	SDL_EndGPUCopyPass(copyPass);
-	SDL_SubmitGPUCommandBuffer(cmdBuf);
-	// clean up transfer buffers
-	SDL_ReleaseGPUTransferBuffer(device, vertTransferBuf);
-	SDL_ReleaseGPUTransferBuffer(device, idxTransferBuf);
+// box around the vertices, sphere around the box center reaching the farthest vertex
+MeshBounds App::computeBounds(RenderVertex const *verts, Uint32 count) {
+	MeshBounds bounds;
+	if (count == 0) return bounds;
+	glm::vec3 lo = verts[0].pos;
+	glm::vec3 hi = verts[0].pos;
+	for (Uint32 i=1; i < count; i++) {
+		glm::vec3 p = verts[i].pos;
+		lo = glm::vec3(SDL_min(lo.x, p.x), SDL_min(lo.y, p.y), SDL_min(lo.z, p.z));
+		hi = glm::vec3(SDL_max(hi.x, p.x), SDL_max(hi.y, p.y), SDL_max(hi.z, p.z));
+	}
+	bounds.center = (lo + hi) * 0.5f;
+	bounds.extents = (hi - lo) * 0.5f;
+	float radius2 = 0.0f;
+	for (Uint32 i=0; i < count; i++) {
+		glm::vec3 d = verts[i].pos - bounds.center;
+		radius2 = SDL_max(radius2, d.x * d.x + d.y * d.y + d.z * d.z);
+	}
+	bounds.radius = SDL_sqrtf(radius2);
+	return bounds;
 }
 
 #pragma endregion Pipeline helpers
@@ -255,74 +227,81 @@ float App::radToDeg(float r) {
 
 #pragma region Primitives
 
+// unit circle points at 2*pi*i/sides for i in [0, sides], computed once per
+// shape and shared by all of its rings
+static std::vector<glm::vec2> circleTable(Uint16 sides) {
+	std::vector<glm::vec2> table(sides + 1);
+	for (int i=0; i <= sides; i++) {
+		float theta = 2.0f * SDL_PI_F * ((float)i / (float)sides);
+		table[i] = glm::vec2(SDL_cosf(theta), SDL_sinf(theta));
+	}
+	return table;
+}
+
 Primitive App::rect2d(float w, float h, float z) {
 	w = w / 2.0f;
   h = h / 2.0f;
-	std::vector<RenderVertex> vertices;
-	vertices.push_back(RenderVertex{ {-w, h, z}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f} });
-	vertices.push_back(RenderVertex{ {-w,-h, z}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f} });
-	vertices.push_back(RenderVertex{ { w,-h, z}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f} });
-	vertices.push_back(RenderVertex{ { w, h, z}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} });
-	std::vector<Uint16> indices = { 0, 1, 2, 0, 2, 3 };
-	return Primitive { vertices, indices, true };
+	std::vector<RenderVertex> vertices = {
+		RenderVertex{ {-w, h, z}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f} },
+		RenderVertex{ {-w,-h, z}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f} },
+		RenderVertex{ { w,-h, z}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f} },
+		RenderVertex{ { w, h, z}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} },
+	};
+	std::vector<Uint32> indices = { 0, 1, 2, 0, 2, 3 };
+	return Primitive { std::move(vertices), std::move(indices), true };
 }
 
 Primitive App::regPolygon2d(float r, Uint16 sides, float z) {
 	std::vector<RenderVertex> vertices;
-	std::vector<Uint16> indices;
-	float da = 2.0f * SDL_PI_F / (float)sides;
-	float x0 = 1.0f; float y0 = 0.0f;
+	std::vector<Uint32> indices;
+	vertices.reserve(3 * sides);
+	std::vector<glm::vec2> circle = circleTable(sides);
 	for (int i=0; i<sides; i++) {
-		float x1 = SDL_cosf(da) * x0 - SDL_sinf(da) * y0;
-		float y1 = SDL_cosf(da) * y0 + SDL_sinf(da) * x0;
+		glm::vec2 c0 = circle[i];
+		glm::vec2 c1 = circle[i + 1];
 		// build slice
-		RenderVertex p1 = RenderVertex {
-			{x0 * r, y0 * r, z},
-			{(1.0f + x0)/2.0f, (1.0f - y0)/2.0f},
+		vertices.push_back(RenderVertex {
+			{c0.x * r, c0.y * r, z},
+			{(1.0f + c0.x)/2.0f, (1.0f - c0.y)/2.0f},
 			{0.0f, 0.0f, 1.0f}
-		};
-		RenderVertex p2 = RenderVertex {
-			{x1 * r, y1 * r, z},
-			{(1.0 + x1)/2.0, (1.0 - y1)/2.0},
+		});
+		vertices.push_back(RenderVertex {
+			{c1.x * r, c1.y * r, z},
+			{(1.0f + c1.x)/2.0f, (1.0f - c1.y)/2.0f},
 			{0.0f, 0.0f, 1.0f}
-		};
-		RenderVertex p3 = RenderVertex {
+		});
+		vertices.push_back(RenderVertex {
 			{0.0f, 0.0f, z}, {0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}
-		};
-		// prepare next slice
-		x0 = x1;
-		y0 = y1;
-		vertices.push_back(p1);
-		vertices.push_back(p2);
-		vertices.push_back(p3);
+		});
 	}
-	return Primitive { vertices, indices, false };
+	return Primitive { std::move(vertices), std::move(indices), false };
 }
 
 Primitive App::torus2d(float outerRadius, float innerRadius, Uint16 sides, float z) {
 	std::vector<RenderVertex> vertices;
-	std::vector<Uint16> indices;
+	std::vector<Uint32> indices;
+	int vertexCount = 2 * sides;
+	vertices.reserve(vertexCount);
+	indices.reserve(3 * vertexCount);
 	float dr = innerRadius / outerRadius;
+	std::vector<glm::vec2> circle = circleTable(sides);
 	// build vertices
 	for (int i=0; i<sides; i++) {
-		float theta = 2.0f * SDL_PI_F * ((float)i / (float)sides);
-		float x = SDL_cosf(theta);
-		float y = SDL_sinf(theta);
-		RenderVertex v1 {
+		float x = circle[i].x;
+		float y = circle[i].y;
+		vertices.push_back(RenderVertex {
 			{x * outerRadius, y * outerRadius, z},
 			{(1.0f + x)/2.0f, (1.0f - y)/2.0f},
 			{0.0f, 0.0f, 1.0f}
-		};
-		RenderVertex v2 {
+		});
+		vertices.push_back(RenderVertex {
 			{x * innerRadius, y * innerRadius, z},
 			{(1.0f + dr * x) / 2.0f, (1.0f - dr * y) / 2.0f},
 			{0.0f, 0.0f, 1.0f}
-		};
-		vertices.push_back(v1);
-		vertices.push_back(v2);
+		});
 	}
 	// build indices
-	for (int i=0; i<vertices.size() - 2; i++) {
+	for (int i=0; i<vertexCount - 2; i++) {
 		if (i % 2 == 0) {
 			indices.push_back(i + 1);
 			indices.push_back(i);
@@ -334,50 +313,50 @@ Primitive App::torus2d(float outerRadius, float innerRadius, Uint16 sides, float
 		}
 	}
 	// join back to first 2 vertices
-	indices.push_back(vertices.size() - 1);
-	indices.push_back(vertices.size() - 2);
+	indices.push_back(vertexCount - 1);
+	indices.push_back(vertexCount - 2);
 	indices.push_back(0);
-	indices.push_back(vertices.size() - 1);
+	indices.push_back(vertexCount - 1);
 	indices.push_back(0);
 	indices.push_back(1);
-	return Primitive { vertices, indices, true };
+	return Primitive { std::move(vertices), std::move(indices), true };
 }
 
 Primitive App::cube(float w, float h, float d) {
-	std::vector<RenderVertex> vertices;
 	w = w / 2.0f; h = h / 2.0f; d = d / 2.0f;
-	// front
-	vertices.push_back(RenderVertex{ {-w, h, d}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f} });
-	vertices.push_back(RenderVertex{ {-w,-h, d}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f} });
-	vertices.push_back(RenderVertex{ { w,-h, d}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f} });
-	vertices.push_back(RenderVertex{ { w, h, d}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} });
-	// back
-	vertices.push_back(RenderVertex{ {-w, h,-d}, {1.0f, 0.0f}, {0.0f, 0.0f,-1.0f} });
-	vertices.push_back(RenderVertex{ {-w,-h,-d}, {1.0f, 1.0f}, {0.0f, 0.0f,-1.0f} });
-	vertices.push_back(RenderVertex{ { w,-h,-d}, {0.0f, 1.0f}, {0.0f, 0.0f,-1.0f} });
-	vertices.push_back(RenderVertex{ { w, h,-d}, {0.0f, 0.0f}, {0.0f, 0.0f,-1.0f} });
-	// top
-	vertices.push_back(RenderVertex{ {-w, h,-d}, {0.0f, 0.0f}, {0.0f, 1.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ { w, h,-d}, {1.0f, 0.0f}, {0.0f, 1.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ {-w, h, d}, {0.0f, 1.0f}, {0.0f, 1.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ { w, h, d}, {1.0f, 1.0f}, {0.0f, 1.0f, 0.0f} });
-	// bottom
-	vertices.push_back(RenderVertex{ {-w,-h,-d}, {0.0f, 1.0f}, {0.0f,-1.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ { w,-h,-d}, {1.0f, 1.0f}, {0.0f,-1.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ {-w,-h, d}, {0.0f, 0.0f}, {0.0f,-1.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ { w,-h, d}, {1.0f, 0.0f}, {0.0f,-1.0f, 0.0f} });
-	// left
-	vertices.push_back(RenderVertex{ {-w,-h,-d}, {0.0f, 1.0f}, {-1.0f, 0.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ {-w, h,-d}, {0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ {-w,-h, d}, {1.0f, 1.0f}, {-1.0f, 0.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ {-w, h, d}, {1.0f, 0.0f}, {-1.0f, 0.0f, 0.0f} });
-	// right
-	vertices.push_back(RenderVertex{ { w,-h,-d}, {1.0f, 1.0f}, {1.0f, 0.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ { w, h,-d}, {1.0f, 0.0f}, {1.0f, 0.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ { w,-h, d}, {0.0f, 1.0f}, {1.0f, 0.0f, 0.0f} });
-	vertices.push_back(RenderVertex{ { w, h, d}, {0.0f, 0.0f}, {1.0f, 0.0f, 0.0f} });
-	
-	std::vector<Uint16> indices = {
+	std::vector<RenderVertex> vertices = {
+		// front
+		RenderVertex{ {-w, h, d}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f} },
+		RenderVertex{ {-w,-h, d}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f} },
+		RenderVertex{ { w,-h, d}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f} },
+		RenderVertex{ { w, h, d}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} },
+		// back
+		RenderVertex{ {-w, h,-d}, {1.0f, 0.0f}, {0.0f, 0.0f,-1.0f} },
+		RenderVertex{ {-w,-h,-d}, {1.0f, 1.0f}, {0.0f, 0.0f,-1.0f} },
+		RenderVertex{ { w,-h,-d}, {0.0f, 1.0f}, {0.0f, 0.0f,-1.0f} },
+		RenderVertex{ { w, h,-d}, {0.0f, 0.0f}, {0.0f, 0.0f,-1.0f} },
+		// top
+		RenderVertex{ {-w, h,-d}, {0.0f, 0.0f}, {0.0f, 1.0f, 0.0f} },
+		RenderVertex{ { w, h,-d}, {1.0f, 0.0f}, {0.0f, 1.0f, 0.0f} },
+		RenderVertex{ {-w, h, d}, {0.0f, 1.0f}, {0.0f, 1.0f, 0.0f} },
+		RenderVertex{ { w, h, d}, {1.0f, 1.0f}, {0.0f, 1.0f, 0.0f} },
+		// bottom
+		RenderVertex{ {-w,-h,-d}, {0.0f, 1.0f}, {0.0f,-1.0f, 0.0f} },
+		RenderVertex{ { w,-h,-d}, {1.0f, 1.0f}, {0.0f,-1.0f, 0.0f} },
+		RenderVertex{ {-w,-h, d}, {0.0f, 0.0f}, {0.0f,-1.0f, 0.0f} },
+		RenderVertex{ { w,-h, d}, {1.0f, 0.0f}, {0.0f,-1.0f, 0.0f} },
+		// left
+		RenderVertex{ {-w,-h,-d}, {0.0f, 1.0f}, {-1.0f, 0.0f, 0.0f} },
+		RenderVertex{ {-w, h,-d}, {0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f} },
+		RenderVertex{ {-w,-h, d}, {1.0f, 1.0f}, {-1.0f, 0.0f, 0.0f} },
+		RenderVertex{ {-w, h, d}, {1.0f, 0.0f}, {-1.0f, 0.0f, 0.0f} },
+		// right
+		RenderVertex{ { w,-h,-d}, {1.0f, 1.0f}, {1.0f, 0.0f, 0.0f} },
+		RenderVertex{ { w, h,-d}, {1.0f, 0.0f}, {1.0f, 0.0f, 0.0f} },
+		RenderVertex{ { w,-h, d}, {0.0f, 1.0f}, {1.0f, 0.0f, 0.0f} },
+		RenderVertex{ { w, h, d}, {0.0f, 0.0f}, {1.0f, 0.0f, 0.0f} },
+	};
+	std::vector<Uint32> indices = {
 		0,1,2, 0,2,3,
 		7,6,5, 7,5,4,
 		8,10,9, 9,10,11,
@@ -385,26 +364,29 @@ Primitive App::cube(float w, float h, float d) {
 		18,19,16, 19,17,16,
 		20,21,22, 21,23,22
 	};
-	return Primitive { vertices, indices, true };
+	return Primitive { std::move(vertices), std::move(indices), true };
 }
 
 Primitive App::cylinder(float r, float h, Uint16 sides) {
 	std::vector<RenderVertex> vertices;
-	std::vector<Uint16> indices;
+	std::vector<Uint32> indices;
+	int capVertices = 2 + 2 * sides;
+	vertices.reserve(capVertices + 2 * (sides + 1));
+	indices.reserve(12 * sides);
+	std::vector<glm::vec2> circle = circleTable(sides);
 	h = h / 2.0f;
 	// center of top/bottom
 	vertices.push_back(RenderVertex{ {0.0f,-h, 0.0f}, {0.5f, 0.5f}, {0.0f,-1.0f, 0.0f} });
 	vertices.push_back(RenderVertex{ {0.0f, h, 0.0f}, {0.5f, 0.5f}, {0.0f, 1.0f, 0.0f} });
 	// build top/bottom faces
 	for (int i=0; i<sides; i++) {
-		float theta = 2.0f * SDL_PI_F * ((float)i / (float)sides);
-		float x = SDL_cosf(theta);
-		float z = SDL_sinf(theta);
+		float x = circle[i].x;
+		float z = circle[i].y;
 		vertices.push_back(RenderVertex{ {x * r,-h, z * r}, {(1.0f + x) / 2.0f, (1.0f + z) / 2.0f}, {0.0f,-1.0f, 0.0f} });
 		vertices.push_back(RenderVertex{ {x * r, h, z * r}, {(1.0f + x) / 2.0f, (1.0f + z) / 2.0f}, {0.0f, 1.0f, 0.0f} });
 	}
 	// build indices for top/bottom faces
-	for (int i=2; i < vertices.size() - 2; i++) {
+	for (int i=2; i < capVertices - 2; i++) {
 		if (i % 2 == 0) {
 			indices.push_back(i); indices.push_back(i + 2); indices.push_back(0);
 		} else {
@@ -412,19 +394,17 @@ Primitive App::cylinder(float r, float h, Uint16 sides) {
 		}
 	}
 	// final 2 tris for top/bottom faces
-	indices.push_back(vertices.size() - 2); indices.push_back(2); indices.push_back(0);
-	indices.push_back(vertices.size() - 1); indices.push_back(1); indices.push_back(3);
+	indices.push_back(capVertices - 2); indices.push_back(2); indices.push_back(0);
+	indices.push_back(capVertices - 1); indices.push_back(1); indices.push_back(3);
 	// build sides
-	float n0 = vertices.size();
 	for (int i=0; i < sides + 1; i++) {
-		float theta = 2.0f * SDL_PI_F * ((float)i / (float)sides);
-		float x = SDL_cosf(theta);
-		float z = SDL_sinf(theta);
+		float x = circle[i].x;
+		float z = circle[i].y;
 		vertices.push_back(RenderVertex{ {x * r,-h, z * r}, {(float)i / (float)sides, 0.0f}, {x,-1.0f, z} });
 		vertices.push_back(RenderVertex{ {x * r, h, z * r}, {(float)i / (float)sides, 1.0f}, {x, 1.0f, z} });
 	}
 	// build side indices
-	for (int i=n0; i < vertices.size() - 2; i++) {
+	for (int i=capVertices; i < vertices.size() - 2; i++) {
 		if (i % 2 == 0) {
 			indices.push_back(i + 1); indices.push_back(i + 2); indices.push_back(i);
 		} else {
@@ -432,21 +412,23 @@ Primitive App::cylinder(float r, float h, Uint16 sides) {
 		}
 	}
 
-	return Primitive { vertices, indices, true };
+	return Primitive { std::move(vertices), std::move(indices), true };
 }
 
 Primitive App::tube(float outerRadius, float innerRadius, float h, Uint16 sides) {
 	std::vector<RenderVertex> vertices;
-	std::vector<Uint16> indices;
+	std::vector<Uint32> indices;
+	vertices.reserve(4 * sides + 4 * (sides + 1));
+	indices.reserve(24 * sides);
+	std::vector<glm::vec2> circle = circleTable(sides);
 
 	float dr = innerRadius / outerRadius;
 	h = h / 2.0f;
 
 	// build top/bottom
 	for (int i=0; i < sides; i++) {
-		float theta = 2.0f * SDL_PI_F * (float)i / (float)sides;
-		float x = SDL_cosf(theta);
-		float z = SDL_sinf(theta);
+		float x = circle[i].x;
+		float z = circle[i].y;
 		vertices.push_back(RenderVertex{
 			{x * outerRadius, h, z * outerRadius},
 			{(1.0f + x)/2.0f, (1.0f + z)/2.0f},
@@ -469,7 +451,8 @@ Primitive App::tube(float outerRadius, float innerRadius, float h, Uint16 sides)
 		});
 	}
 	// index top/bottom
-	for (int i=0; i < vertices.size() - 5; i += 2) {
+	int vs = vertices.size();
+	for (int i=0; i < vs - 5; i += 2) {
 		if (i % 4 == 0) {
 			indices.push_back(i); indices.push_back(i + 2); indices.push_back(i + 4);
 			indices.push_back(i + 3); indices.push_back(i + 1); indices.push_back(i + 5);
@@ -479,7 +462,6 @@ Primitive App::tube(float outerRadius, float innerRadius, float h, Uint16 sides)
 		}
 	}
 	// join back to first 2 vertices
-	int vs = vertices.size();
 	indices.push_back(vs - 4); indices.push_back(vs - 2); indices.push_back(0);
 	indices.push_back(0); indices.push_back(vs - 2); indices.push_back(2);
 	indices.push_back(vs - 1); indices.push_back(vs - 3); indices.push_back(1);
@@ -487,9 +469,8 @@ Primitive App::tube(float outerRadius, float innerRadius, float h, Uint16 sides)
 
 	// build sides
 	for (int i=0; i < sides + 1; i++) {
-		float theta = 2.0f * SDL_PI_F * (float)i / (float)sides;
-		float x = SDL_cosf(theta);
-		float z = SDL_sinf(theta);
+		float x = circle[i].x;
+		float z = circle[i].y;
 		vertices.push_back(RenderVertex{
 			{x * outerRadius, h, z * outerRadius},
 			{(float)i/(float)sides, 1.0f},
@@ -522,23 +503,26 @@ Primitive App::tube(float outerRadius, float innerRadius, float h, Uint16 sides)
 		}
 	}
 
-	return Primitive { vertices, indices, true };
+	return Primitive { std::move(vertices), std::move(indices), true };
 }
 
 Primitive App::sphere(float r, Uint16 sides, Uint16 slices) {
 	std::vector<RenderVertex> vertices;
-	std::vector<Uint16> indices;
+	std::vector<Uint32> indices;
+	vertices.reserve(2 + sides * (slices - 1));
+	indices.reserve(6 * sides * (slices - 1));
+	std::vector<glm::vec2> circle = circleTable(sides);
 
 	// top point
 	vertices.push_back(RenderVertex{ {0.0f, r, 0.0f}, {0.5f, 0.5f}, {0.0f, 1.0f, 0.0f} });
 	// add points for each slice
 	for (int i=0; i < slices - 1; i++) {
 		float phi = SDL_PI_F * (float)(i + 1) / (float)slices;
+		float ringRadius = SDL_sinf(phi);
+		float y = SDL_cosf(phi);
 		for (int j=0; j < sides; j++) {
-			float theta = 2.0f * SDL_PI_F * (float)j / (float)sides;
-			float x = SDL_sinf(phi) * SDL_cosf(theta);
-			float y = SDL_cosf(phi);
-			float z = SDL_sinf(phi) * SDL_sinf(theta);
+			float x = ringRadius * circle[j].x;
+			float z = ringRadius * circle[j].y;
 			vertices.push_back(RenderVertex{
 				{x * r, y * r, z * r},
 				{(1.0f + x)/2.0f, (1.0f + z)/2.0f},
@@ -550,8 +534,8 @@ Primitive App::sphere(float r, Uint16 sides, Uint16 slices) {
 	vertices.push_back(RenderVertex{ {0.0f,-r, 0.0f}, {0.5f, 0.5f}, {0.0f,-1.0f, 0.0f} });
 	// top/bottom indices
 	for (int i=0; i < sides; i++) {
-		Uint16 i0 = i + 1;
-		Uint16 i1 = (i + 1) % sides + 1;
+		Uint32 i0 = i + 1;
+		Uint32 i1 = (i + 1) % sides + 1;
 		indices.push_back(0); indices.push_back(i1); indices.push_back(i0);
 		i0 = i + sides * (slices - 2) + 1;
     i1 = (i + 1) % sides + sides * (slices - 2) + 1;
@@ -559,35 +543,38 @@ Primitive App::sphere(float r, Uint16 sides, Uint16 slices) {
 	}
 	// slice indices
 	for (int j=0; j < slices - 2; j++) {
-		Uint16 j0 = j * sides + 1;
-		Uint16 j1 = (j + 1) * sides + 1;
+		Uint32 j0 = j * sides + 1;
+		Uint32 j1 = (j + 1) * sides + 1;
 		for (int i=0; i < sides; i++) {
-			Uint16 i0 = j0 + i;
-			Uint16 i1 = j0 + (i + 1) % sides;
-			Uint16 i2 = j1 + (i + 1) % sides;
-			Uint16 i3 = j1 + i;
+			Uint32 i0 = j0 + i;
+			Uint32 i1 = j0 + (i + 1) % sides;
+			Uint32 i2 = j1 + (i + 1) % sides;
+			Uint32 i3 = j1 + i;
 			indices.push_back(i0); indices.push_back(i1); indices.push_back(i2);
 			indices.push_back(i2); indices.push_back(i3); indices.push_back(i0);
 		}
 	}
 
-	return Primitive { vertices, indices, true };
+	return Primitive { std::move(vertices), std::move(indices), true };
 }
 
 Primitive App::hemisphere(float r, Uint16 sides, Uint16 slices) {
 	std::vector<RenderVertex> vertices;
-	std::vector<Uint16> indices;
+	std::vector<Uint32> indices;
+	vertices.reserve(2 + sides * (slices + 1));
+	indices.reserve(6 * sides * slices);
+	std::vector<glm::vec2> circle = circleTable(sides);
 
 	// top point
 	vertices.push_back(RenderVertex{ {0.0f, r, 0.0f}, {0.5f, 0.5f}, {0.0f, 1.0f, 0.0f} });
 	// points per slice
 	for (int i=0; i<slices; i++) {
 		float phi = SDL_PI_F * (float)(i + 1) / (float)(2 * slices);
+		float ringRadius = SDL_sinf(phi);
+		float y = SDL_cosf(phi);
 		for (int  j=0; j<sides; j++) {
-			float theta = 2.0f * SDL_PI_F * (float)j / (float)sides;
-			float x = SDL_sinf(phi) * SDL_cosf(theta);
-			float y = SDL_cosf(phi);
-			float z = SDL_sinf(phi) * SDL_sinf(theta);
+			float x = ringRadius * circle[j].x;
+			float z = ringRadius * circle[j].y;
 			vertices.push_back(RenderVertex{
 				{x * r, y * r, z * r},
 				{(1.0f + x) / 2.0f, (1.0f + z) / 2.0f},
@@ -597,19 +584,19 @@ Primitive App::hemisphere(float r, Uint16 sides, Uint16 slices) {
 	}
 	// top face index
 	for (int i=0; i<sides; i++) {
-		Uint16 i0 = i + 1;
-		Uint16 i1 = (i + 1) % sides + 1;
+		Uint32 i0 = i + 1;
+		Uint32 i1 = (i + 1) % sides + 1;
 		indices.push_back(0); indices.push_back(i1); indices.push_back(i0);
 	}
 	// slice indices
 	for (int j=0; j < slices-1; j++) {
-		Uint16 j0 = j * sides + 1;
-		Uint16 j1 = (j + 1) * sides + 1;
+		Uint32 j0 = j * sides + 1;
+		Uint32 j1 = (j + 1) * sides + 1;
 		for (int i=0; i < sides; i++) {
-			Uint16 i0 = j0 + i;
-			Uint16 i1 = j0 + (i + 1) % sides;
-			Uint16 i2 = j1 + (i + 1) % sides;
-			Uint16 i3 = j1 + i;
+			Uint32 i0 = j0 + i;
+			Uint32 i1 = j0 + (i + 1) % sides;
+			Uint32 i2 = j1 + (i + 1) % sides;
+			Uint32 i3 = j1 + i;
 			indices.push_back(i0); indices.push_back(i1); indices.push_back(i2);
 			indices.push_back(i2); indices.push_back(i3); indices.push_back(i0);
 		}
@@ -617,12 +604,11 @@ Primitive App::hemisphere(float r, Uint16 sides, Uint16 slices) {
 	// generate bottom face
 	int new0 = vertices.size();
 	for (int i=0; i < sides; i++) {
-		float theta = 2.0f * SDL_PI_F * (float)i / (float)sides;
-		float x = SDL_cosf(theta);
-		float z = SDL_sinf(theta);
+		float x = circle[i].x;
+		float z = circle[i].y;
 		vertices.push_back(RenderVertex{
 			{x * r, 0.0f, z * r},
-			{(1.0 + x) / 2.0f, (1.0 - z) / 2.0f},
+			{(1.0f + x) / 2.0f, (1.0f - z) / 2.0f},
 			{0.0f, -1.0f, 0.0f}
 		});
 	}
@@ -635,7 +621,7 @@ Primitive App::hemisphere(float r, Uint16 sides, Uint16 slices) {
 	}
 	indices.push_back(c); indices.push_back(c - 1); indices.push_back(new0);
 
-	return Primitive { vertices, indices, true };
+	return Primitive { std::move(vertices), std::move(indices), true };
 }
 
 #pragma endregion Primitives
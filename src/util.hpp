@@ -4,6 +4,7 @@
 #include <SDL3/SDL.h>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
+#include "gpuResources.hpp"
 
 namespace App {
   // GPU helpers
@@ -13,13 +14,38 @@ namespace App {
     glm::vec2 uv;
     glm::vec3 normal;
   };
+  // vertex layouts a pipeline can ask for. meshes are built as RenderVertex
+  // and packed into the pipeline's layout on upload
+  enum VertexLayout { VL_Float, VL_Compact };
+  // VL_Compact, 16 bytes: snorm16 position inside the mesh bounds (w unused),
+  // unorm16 uv clamped to [0, 1] and an octahedral snorm16 normal
+  struct CompactVertex {
+    Sint16 pos[4];
+    Uint16 uv[2];
+    Sint16 normal[2];
+  };
+  // maps packed positions back to mesh space, pos = offset + p * scale
+  struct VertexQuantization {
+    glm::vec3 offset = glm::vec3(0.0f);
+    float scale = 1.0f;
+  };
+  // mesh space bounds from the vertices on upload
+  struct MeshBounds {
+    glm::vec3 center = glm::vec3(0.0f);
+    // half size of the axis aligned box around center
+    glm::vec3 extents = glm::vec3(0.0f);
+    float radius = 0.0f;
+  };
   struct RenderObject {
     int id = -1;
+    int meshId = -1; // object that owns the gpu buffers, differs from id for instances
     bool visible = true;
     SDL_GPUBuffer *vertexBuffer = NULL;
     SDL_GPUBuffer *indexBuffer = NULL;
     int vertexCount = 0;
     int indexCount = 0;
+    // picked per mesh on upload, 32 bit only when the vertices don't fit in 16
+    SDL_GPUIndexElementSize indexSize = SDL_GPU_INDEXELEMENTSIZE_16BIT;
     SDL_GPUSampler *sampler = NULL;
     SDL_GPUTexture *texture = NULL;
     glm::vec3 pos = glm::vec3(0.0f);
@@ -27,6 +53,18 @@ namespace App {
     glm::vec3 rotAxis = glm::vec3(0.0f, 0.0f, 1.0f);
     float rotAngleRad = 0.0f;
     SDL_FColor albedo {0.5f, 0.5f, 0.5f, 1.0f};
+    // identity unless the mesh was packed as VL_Compact
+    VertexQuantization quant;
+    // detail level the buffers above belong to, picked by ObjectPipeline::prepare
+    Uint8 lod = 0;
+    // of the finest level, coarser levels stay inside it
+    MeshBounds bounds;
+    // references this object holds in the device's GPUResourceRegistry, instances
+    // hold their own. the buffers are the finest level's whatever lod is drawn
+    GPUHandle vertexHandle;
+    GPUHandle indexHandle;
+    GPUHandle samplerHandle;
+    GPUHandle textureHandle;
   };
   struct RenderCamera {
     glm::vec3 pos = glm::vec3(0.0f, 0.0f, 500.0f);
@@ -43,11 +81,14 @@ namespace App {
     SDL_GPUDevice *device, const char* filename, Uint32 samplerCount,
     Uint32 uniformBufferCount, Uint32 storageBufferCount, Uint32 storageTextureCount
   );
-  void copyVertexDataIntoBuffer(
-    SDL_GPUDevice *device, SDL_GPUBuffer *vertBuf, SDL_GPUBuffer *indexBuf,
-    std::vector<RenderVertex> *verts, std::vector<Uint16> *indices
-  );
-  SDL_GPUVertexInputState createVertexInputState();
+  SDL_GPUVertexInputState createVertexInputState(VertexLayout layout = VL_Float);
+  Uint32 vertexStride(VertexLayout layout);
+  VertexQuantization packVertices(VertexLayout layout, RenderVertex const *verts, Uint32 count, void *out);
+  MeshBounds computeBounds(RenderVertex const *verts, Uint32 count);
+  // normalized integer packing
+  Sint16 packSnorm16(float v);
+  Uint16 packUnorm16(float v);
+  Uint8 packUnorm8(float v);
   // color
   SDL_FColor rgba(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
   SDL_FColor rgb(Uint8 r, Uint8 g, Uint8 b);
@@ -72,8 +113,11 @@ namespace App {
   // primitives
   struct Primitive {
     std::vector<RenderVertex> vertices;
-    std::vector<Uint16> indices;
+    // narrowed to 16 bit on upload when the mesh is small enough
+    std::vector<Uint32> indices;
     bool useIndices = true;
+    // set by MeshFactory so identical shapes share gpu buffers, 0 if unknown
+    Uint64 key = 0;
   };
   Primitive rect2d(float w, float h, float z);
   Primitive regPolygon2d(float radius, Uint16 sides, float z);